@@ -0,0 +1,55 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
+#include "benchmark.h"
+#include "../code/buffer/buffer.h"
+#include "../code/buffer/chainbuffer.h"
+
+static void bm_buffer_append(BenchState& state) {
+    Buffer buffer;
+    std::vector<char> data(state.arg(), 'x');
+    while(state.keep_running()) {
+        buffer.append(data.data(), data.size());
+        if(buffer.readable_bytes() >= (1 << 20)) buffer.retrieve_all();
+    }
+    state.set_bytes_processed(state.iterations() * data.size());
+}
+BENCHMARK_ARGS(bm_buffer_append, 64, 1024, 16384);
+
+static void bm_chainbuffer_append(BenchState& state) {
+    ChainBuffer buffer;
+    std::vector<char> data(state.arg(), 'x');
+    while(state.keep_running()) {
+        buffer.append(data.data(), data.size());
+        if(buffer.readable_bytes() >= (1 << 20)) buffer.retrieve_all();
+    }
+    state.set_bytes_processed(state.iterations() * data.size());
+}
+BENCHMARK_ARGS(bm_chainbuffer_append, 64, 1024, 16384);
+
+// 每轮先向管道写入 arg 字节（不计时），再测一次 read_fd
+template<typename B>
+static void read_fd_case(BenchState& state) {
+    int fds[2];
+    if(pipe2(fds, O_NONBLOCK) < 0) return;
+    fcntl(fds[1], F_SETPIPE_SZ, 1 << 20);
+    std::vector<char> data(state.arg(), 'x');
+    B buffer;
+    int err = 0;
+    while(state.keep_running()) {
+        state.pause_timing();
+        [[maybe_unused]] ssize_t w = write(fds[1], data.data(), data.size());
+        state.resume_timing();
+        buffer.read_fd(fds[0], &err);
+        buffer.retrieve_all();
+    }
+    state.set_bytes_processed(state.iterations() * data.size());
+    close(fds[0]);
+    close(fds[1]);
+}
+
+static void bm_buffer_read_fd(BenchState& state) { read_fd_case<Buffer>(state); }
+BENCHMARK_ARGS(bm_buffer_read_fd, 512, 4096, 65536);
+
+static void bm_chainbuffer_read_fd(BenchState& state) { read_fd_case<ChainBuffer>(state); }
+BENCHMARK_ARGS(bm_chainbuffer_read_fd, 512, 4096, 65536);
@@ -0,0 +1,30 @@
+#include <thread>
+#include <vector>
+#include "benchmark.h"
+#include "../code/log/log.h"
+
+// arg 个线程并发写日志，总条数等于迭代次数，使用与服务器相同的异步队列配置
+static void bm_log_write(BenchState& state) {
+    static bool inited = [] {
+        Log::instance()->init(1, "/tmp/webserver_bench_log", ".log", 1024);
+        return true;
+    }();
+    do_not_optimize(inited);
+
+    const int threads = state.arg();
+    const uint64_t total = state.iterations();
+    std::vector<std::thread> workers;
+    state.start_timing();
+    for(int t = 0; t < threads; ++t) {
+        const uint64_t lines = total / threads + (static_cast<uint64_t>(t) < total % threads ? 1 : 0);
+        workers.emplace_back([t, lines] {
+            for(uint64_t i = 0; i < lines; ++i) {
+                LOG_INFO("Client[%d](127.0.0.1:%d) in, user_count:%d", t, 40000 + t, (int)i);
+            }
+        });
+    }
+    for(auto& w : workers) w.join();
+    state.stop_timing();
+    state.set_items_processed(total);
+}
+BENCHMARK_ARGS(bm_log_write, 1, 2, 4, 8, 16, 32);
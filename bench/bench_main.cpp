@@ -0,0 +1,118 @@
+/*
+ * 微基准入口
+ * 用法: ./microbench [--filter=子串] [--min_time=秒] [--format=console|json] [--out=文件]
+ * 在仓库根目录下运行，资源和请求样本按相对路径 resources/、bench/corpus/ 查找
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <unistd.h>
+#include "benchmark.h"
+
+struct Result {
+    std::string name;
+    uint64_t iterations;
+    double ns_per_op;
+    double items_per_second;
+    double bytes_per_second;
+    std::string label;
+};
+
+static Result run_case(const BenchCase& bc, int64_t arg, bool has_arg, double min_time) {
+    uint64_t iters = 1;
+    for(;;) {
+        BenchState state(iters, arg);
+        bc.fn(state);
+        const double ns = state.elapsed_ns();
+        if(ns >= min_time * 1e9 || iters >= 1000000000ull) {
+            Result r;
+            r.name = has_arg ? bc.name + "/" + std::to_string(arg) : bc.name;
+            r.iterations = iters;
+            r.ns_per_op = ns / iters;
+            r.items_per_second = state.items() ? state.items() / (ns / 1e9) : 0;
+            r.bytes_per_second = state.bytes() ? state.bytes() / (ns / 1e9) : 0;
+            r.label = state.label();
+            return r;
+        }
+        // 按已测耗时估算下一轮迭代数，留 40% 余量，最多放大 100 倍
+        double scale = ns > 0 ? min_time * 1e9 * 1.4 / ns : 100.0;
+        scale = std::min(std::max(scale, 2.0), 100.0);
+        iters = static_cast<uint64_t>(iters * scale);
+    }
+}
+
+static void print_json(FILE* out, const std::vector<Result>& results) {
+    char host[256] = "unknown";
+    gethostname(host, sizeof(host) - 1);
+    char date[64];
+    time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+
+    fprintf(out, "{\n  \"context\": {\"date\": \"%s\", \"host\": \"%s\", \"num_cpus\": %ld},\n",
+            date, host, sysconf(_SC_NPROCESSORS_ONLN));
+    fprintf(out, "  \"benchmarks\": [\n");
+    for(size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        fprintf(out, "    {\"name\": \"%s\", \"iterations\": %lu, \"real_time\": %.3f, \"time_unit\": \"ns\"",
+                r.name.c_str(), r.iterations, r.ns_per_op);
+        if(r.items_per_second > 0) fprintf(out, ", \"items_per_second\": %.1f", r.items_per_second);
+        if(r.bytes_per_second > 0) fprintf(out, ", \"bytes_per_second\": %.1f", r.bytes_per_second);
+        if(!r.label.empty()) fprintf(out, ", \"label\": \"%s\"", r.label.c_str());
+        fprintf(out, "}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+static void print_row(FILE* out, const Result& r) {
+    fprintf(out, "%-48s %12.1f ns %12lu", r.name.c_str(), r.ns_per_op, r.iterations);
+    if(r.items_per_second > 0) fprintf(out, " %12.3fM items/s", r.items_per_second / 1e6);
+    if(r.bytes_per_second > 0) fprintf(out, " %10.1f MB/s", r.bytes_per_second / (1 << 20));
+    if(!r.label.empty()) fprintf(out, " %s", r.label.c_str());
+    fprintf(out, "\n");
+    fflush(out);
+}
+
+int main(int argc, char* argv[]) {
+    std::string filter;
+    std::string format = "console";
+    std::string out_path;
+    double min_time = 0.5;
+    for(int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        if(strncmp(a, "--filter=", 9) == 0) filter = a + 9;
+        else if(strncmp(a, "--min_time=", 11) == 0) min_time = atof(a + 11);
+        else if(strncmp(a, "--format=", 9) == 0) format = a + 9;
+        else if(strncmp(a, "--out=", 6) == 0) out_path = a + 6;
+        else {
+            fprintf(stderr, "usage: %s [--filter=substr] [--min_time=s] [--format=console|json] [--out=file]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<Result> results;
+    for(const auto& bc : bench_registry()) {
+        std::vector<int64_t> args = bc.args;
+        const bool has_arg = !args.empty();
+        if(!has_arg) args.push_back(0);
+        for(int64_t arg : args) {
+            std::string name = has_arg ? bc.name + "/" + std::to_string(arg) : bc.name;
+            if(!filter.empty() && name.find(filter) == std::string::npos) continue;
+            results.push_back(run_case(bc, arg, has_arg, min_time));
+            if(format == "console") print_row(stdout, results.back());
+            else fprintf(stderr, "%s done\n", name.c_str());
+        }
+    }
+
+    if(format == "json") {
+        FILE* out = out_path.empty() ? stdout : fopen(out_path.c_str(), "w");
+        if(!out) {
+            perror("fopen");
+            return 1;
+        }
+        print_json(out, results);
+        if(out != stdout) fclose(out);
+    }
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include <random>
+#include <vector>
+#include "benchmark.h"
+#include "../code/limiter/ratelimiter.h"
+
+static RateLimiter* make_limiter(size_t capacity) {
+    RateLimiter::Options options;
+    options.capacity = capacity;
+    options.max_conns = 1u << 30;
+    options.rules[static_cast<size_t>(RateLimiter::RouteClass::static_file)] = {1000000, 1000000};
+    RateLimiter* limiter = RateLimiter::instance();
+    limiter->init(options);
+    return limiter;
+}
+
+// 同一地址反复请求，表项常驻缓存
+static void bm_ratelimit_hot(BenchState& state) {
+    RateLimiter* limiter = make_limiter(1 << 20);
+    uint64_t now = 1000000000;
+    while(state.keep_running()) {
+        do_not_optimize(limiter->allow(0x0100007f, RateLimiter::RouteClass::static_file, now += 1000));
+    }
+    state.set_items_processed(state.iterations());
+}
+BENCHMARK(bm_ratelimit_hot);
+
+// arg 个不同地址轮流请求，表容量 1M 槽；地址数超过容量后每次都要淘汰
+static void bm_ratelimit_spread(BenchState& state) {
+    RateLimiter* limiter = make_limiter(1 << 20);
+    std::mt19937 rng(42);
+    std::vector<uint32_t> ips(state.arg());
+    for(auto& ip : ips) ip = rng() | 1;
+    uint64_t now = 1000000000;
+    size_t i = 0;
+    while(state.keep_running()) {
+        do_not_optimize(limiter->allow(ips[i], RateLimiter::RouteClass::static_file, now += 1000));
+        if(++i == ips.size()) i = 0;
+    }
+    state.set_items_processed(state.iterations());
+}
+BENCHMARK_ARGS(bm_ratelimit_spread, 1000, 1000000, 4000000);
+
+// accept 路径：连接计数加一再减一
+static void bm_ratelimit_conn(BenchState& state) {
+    RateLimiter* limiter = make_limiter(1 << 20);
+    bool counted = false;
+    while(state.keep_running()) {
+        do_not_optimize(limiter->acquire_conn(0x0100007f, &counted));
+        if(counted) limiter->release_conn(0x0100007f);
+    }
+    state.set_items_processed(state.iterations());
+}
+BENCHMARK(bm_ratelimit_conn);
@@ -0,0 +1,110 @@
+#include <dirent.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "benchmark.h"
+#include "../code/http/httprequest.h"
+#include "../code/http/urlpath.h"
+
+// bench/corpus 下抓取的原始请求，文件以 LF 保存，加载时头部转换为 CRLF
+static const std::vector<std::string>& corpus() {
+    static std::vector<std::string> requests = [] {
+        std::vector<std::string> res;
+        const char* dir_path = "bench/corpus";
+        DIR* dir = opendir(dir_path);
+        if(!dir) return res;
+        while(dirent* ent = readdir(dir)) {
+            if(ent->d_name[0] == '.') continue;
+            std::ifstream in(std::string(dir_path) + "/" + ent->d_name);
+            std::stringstream ss;
+            ss << in.rdbuf();
+            std::string raw = ss.str();
+            size_t split = raw.find("\n\n");
+            std::string head = raw.substr(0, split == std::string::npos ? raw.size() : split + 2);
+            std::string body = split == std::string::npos ? "" : raw.substr(split + 2);
+            if(!body.empty() && body.back() == '\n') body.pop_back();
+            std::string req;
+            for(char c : head) {
+                if(c == '\n') req += '\r';
+                req += c;
+            }
+            res.push_back(req + body);
+        }
+        closedir(dir);
+        return res;
+    }();
+    return requests;
+}
+
+static void bm_request_parse(BenchState& state) {
+    const auto& requests = corpus();
+    if(requests.empty()) {
+        state.set_label("bench/corpus not found, run from repo root");
+        while(state.keep_running()) {}
+        return;
+    }
+    Buffer buffer;
+    HttpRequest request;
+    uint64_t bytes = 0;
+    size_t i = 0;
+    while(state.keep_running()) {
+        const std::string& raw = requests[i];
+        i = (i + 1) % requests.size();
+        buffer.append(raw.data(), raw.size());
+        request.init();
+        do_not_optimize(request.parse(buffer));
+        buffer.retrieve_all();
+        bytes += raw.size();
+    }
+    state.set_items_processed(state.iterations());
+    state.set_bytes_processed(bytes);
+}
+BENCHMARK(bm_request_parse);
+
+// 64K 的 chunked 正文（4K 一块）按 1500 字节一次到达，测增量解析跨读取续接的开销
+static void bm_request_chunked(BenchState& state) {
+    std::string raw = "POST /upload HTTP/1.1\r\nHost: 127.0.0.1\r\nTransfer-Encoding: chunked\r\n\r\n";
+    const std::string chunk(4096, 'x');
+    for(int i = 0; i < 16; ++i) {
+        raw += "1000\r\n" + chunk + "\r\n";
+    }
+    raw += "0\r\n\r\n";
+    constexpr size_t kSegment = 1500;
+    Buffer buffer;
+    HttpRequest request;
+    uint64_t bytes = 0;
+    while(state.keep_running()) {
+        request.init();
+        for(size_t pos = 0; pos < raw.size(); pos += kSegment) {
+            buffer.append(raw.data() + pos, std::min(kSegment, raw.size() - pos));
+            do_not_optimize(request.parse(buffer));
+        }
+        buffer.retrieve_all();
+        bytes += raw.size();
+    }
+    state.set_items_processed(state.iterations());
+    state.set_bytes_processed(bytes);
+}
+BENCHMARK(bm_request_chunked);
+
+// 路径规范化：干净的路径、带编码字符和查询串的、带 . 和 .. 段的；拷贝进预留好容量的字符串，不分配
+static void bm_normalize_path(BenchState& state) {
+    const std::string_view paths[] = {
+        "/images/profile-image.jpg", "/docs/%E6%96%87%E6%A1%A3/read%20me.md?lang=zh&v=2",
+        "//static/./css/../js//app.min.js",
+    };
+    std::string path;
+    path.reserve(128);
+    uint64_t bytes = 0;
+    while(state.keep_running()) {
+        for(std::string_view p : paths) {
+            path.assign(p);
+            do_not_optimize(normalize_path(path));
+            bytes += p.size();
+        }
+    }
+    state.set_items_processed(state.iterations() * std::size(paths));
+    state.set_bytes_processed(bytes);
+}
+BENCHMARK(bm_normalize_path);
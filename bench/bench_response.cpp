@@ -0,0 +1,79 @@
+#include <charconv>
+#include <string>
+#include "benchmark.h"
+#include "../code/http/httpresponse.h"
+#include "../code/http/responsewriter.h"
+
+// make_response 的开销：不缓存时为 stat/open/mmap，缓存命中时只查一次表；路径不同时 MIME 与状态码也不同
+static int register_response_cases() {
+    const char* paths[] = {
+        "/index.html", "/css/style.css", "/images/profile-image.jpg", "/nothere.html",
+    };
+    for(const char* path : paths) {
+        for(bool cached : {false, true}) {
+            for(bool keep_alive : {false, true}) {
+                std::string name = std::string("bm_make_response") + path + (cached ? "/cached" : "") +
+                                   (keep_alive ? "/keep-alive" : "/close");
+                register_benchmark(name, [path, cached, keep_alive](BenchState& state) {
+                    VhostConfig config;
+                    config.file_cache = cached ? config.file_cache : 0;
+                    const VirtualHost host(config, "resources");
+                    HttpResponse response;
+                    ChainBuffer buffer;
+                    while(state.keep_running()) {
+                        std::string p = path;
+                        response.init(host, p, keep_alive, 200);
+                        response.make_response(buffer);
+                        buffer.retrieve_all();
+                        response.unmap_file();
+                    }
+                    state.set_items_processed(state.iterations());
+                });
+            }
+        }
+    }
+    return 0;
+}
+static int response_cases = register_response_cases();
+
+// 流式响应：4096 行数字直接格式化进写缓冲区的 chunked 块，对比先拼 std::string 再追加
+static void bm_response_writer(BenchState& state) {
+    ChainBuffer buffer;
+    ResponseWriter writer(buffer);
+    uint64_t bytes = 0;
+    while(state.keep_running()) {
+        writer.reset(true, true);
+        writer.begin(200, "text/plain");
+        for(int i = 0; i < 4096; ++i) {
+            char* p = writer.prepare(24);
+            char* end = std::to_chars(p, p + 24, 1000000 + i).ptr;
+            *end++ = '\n';
+            writer.commit(end - p);
+        }
+        writer.end();
+        bytes += buffer.readable_bytes();
+        buffer.retrieve_all();
+    }
+    state.set_items_processed(state.iterations());
+    state.set_bytes_processed(bytes);
+}
+BENCHMARK(bm_response_writer);
+
+static void bm_response_string(BenchState& state) {
+    ChainBuffer buffer;
+    uint64_t bytes = 0;
+    while(state.keep_running()) {
+        std::string body;
+        for(int i = 0; i < 4096; ++i) {
+            body += std::to_string(1000000 + i);
+            body += '\n';
+        }
+        buffer.append("HTTP/1.1 200 OK\r\nContent-length: " + std::to_string(body.size()) + "\r\n\r\n");
+        buffer.append(body);
+        bytes += buffer.readable_bytes();
+        buffer.retrieve_all();
+    }
+    state.set_items_processed(state.iterations());
+    state.set_bytes_processed(bytes);
+}
+BENCHMARK(bm_response_string);
@@ -0,0 +1,45 @@
+#include <string>
+#include "benchmark.h"
+#include "../code/http/httprequest.h"
+#include "../code/http/router.h"
+
+// 与服务器相同的页面路由，加上几条带参数的接口和一个挂载目录
+static Router* bench_router() {
+    static Router* router = [] {
+        Router* r = Router::instance();
+        r->add("GET", "/", Router::rewrite("/index.html"));
+        for(std::string_view page : DEFAULT_HTML) {
+            r->add("GET", page, Router::rewrite(std::string(page) + ".html"));
+        }
+        auto none = [](HttpRequest&, const RouteParams&) -> std::unique_ptr<ResponseStream> { return nullptr; };
+        r->add("POST", "/login", none);
+        r->add("POST", "/register", none);
+        r->add("GET", "/api/users/:id", none);
+        r->add("GET", "/api/users/:id/posts/:post", none);
+        r->add("DELETE", "/api/users/:id", none);
+        r->add("GET", "/api/status", none);
+        r->mount("/", "resources/");
+        r->freeze();
+        return r;
+    }();
+    return router;
+}
+
+// 每轮依次匹配静态页、参数路由、挂载目录下的文件和 405
+static void bm_router_dispatch(BenchState& state) {
+    Router* router = bench_router();
+    const char* paths[][2] = {
+        { "GET", "/" }, { "GET", "/login" }, { "GET", "/api/users/42/posts/7?full=1" },
+        { "GET", "/css/style.css" }, { "GET", "/images/profile-image.jpg" }, { "PUT", "/api/status" },
+    };
+    HttpRequest request;
+    while(state.keep_running()) {
+        for(const auto& [method, path] : paths) {
+            request.assign(method, path, {}, {});
+            const Router::Result result = router->dispatch(request);
+            do_not_optimize(result.status);
+        }
+    }
+    state.set_items_processed(state.iterations() * std::size(paths));
+}
+BENCHMARK(bm_router_dispatch);
@@ -0,0 +1,60 @@
+#include <random>
+#include <vector>
+#include "benchmark.h"
+#include "../code/timer/heaptimer.h"
+
+static std::vector<int> random_timeouts(size_t n) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> dist(1000, 60000);
+    std::vector<int> res(n);
+    for(auto& t : res) t = dist(rng);
+    return res;
+}
+
+// 每轮向空堆中加入 arg 个定时器
+static void bm_timer_add(BenchState& state) {
+    const auto timeouts = random_timeouts(state.arg());
+    while(state.keep_running()) {
+        state.pause_timing();
+        HeapTimer timer;
+        state.resume_timing();
+        for(int i = 0; i < state.arg(); ++i) {
+            timer.add(i, timeouts[i], [] {});
+        }
+        state.pause_timing();
+        timer.clear();
+        state.resume_timing();
+    }
+    state.set_items_processed(state.iterations() * state.arg());
+}
+BENCHMARK_ARGS(bm_timer_add, 1000, 10000, 100000);
+
+// 在 arg 个定时器的堆上反复延长随机连接的超时，对应每次读写时的 extend_time
+static void bm_timer_adjust(BenchState& state) {
+    const int n = state.arg();
+    const auto timeouts = random_timeouts(n);
+    HeapTimer timer;
+    for(int i = 0; i < n; ++i) timer.add(i, timeouts[i], [] {});
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> pick(0, n - 1);
+    while(state.keep_running()) {
+        timer.adjust(pick(rng), 60000);
+    }
+    state.set_items_processed(state.iterations());
+}
+BENCHMARK_ARGS(bm_timer_adjust, 1000, 10000, 100000);
+
+// 每轮让 arg 个已到期的定时器在一次 tick 中全部触发
+static void bm_timer_tick(BenchState& state) {
+    HeapTimer timer;
+    uint64_t fired = 0;
+    while(state.keep_running()) {
+        state.pause_timing();
+        for(int i = 0; i < state.arg(); ++i) timer.add(i, 0, [&fired] { ++fired; });
+        state.resume_timing();
+        timer.tick();
+    }
+    do_not_optimize(fired);
+    state.set_items_processed(state.iterations() * state.arg());
+}
+BENCHMARK_ARGS(bm_timer_tick, 1000, 10000, 100000);
@@ -0,0 +1,36 @@
+#include <string>
+#include "benchmark.h"
+#include "../code/http/vhost.h"
+
+// 32 个站点各带一个 www 别名，都指向 resources/
+static const VhostTable* bench_vhosts() {
+    static const VhostTable* table = [] {
+        std::vector<VhostConfig> vhosts(32);
+        for(size_t i = 0; i < vhosts.size(); ++i) {
+            vhosts[i].name = "site" + std::to_string(i) + ".example.com";
+            vhosts[i].aliases = "www." + vhosts[i].name;
+            vhosts[i].root = "resources";
+        }
+        VhostTable* t = VhostTable::instance();
+        std::string error;
+        t->init(VhostConfig(), vhosts, error);
+        return t;
+    }();
+    return table;
+}
+
+// 每轮依次查带端口的、大小写混合的、别名、末尾带点的和不存在的主机名
+static void bm_vhost_find(BenchState& state) {
+    const VhostTable* table = bench_vhosts();
+    const std::string_view hosts[] = {
+        "site7.example.com:2316", "SITE19.Example.COM", "www.site3.example.com",
+        "site31.example.com.", "unknown.example.org", "127.0.0.1:2316",
+    };
+    while(state.keep_running()) {
+        for(std::string_view host : hosts) {
+            do_not_optimize(&table->find(host));
+        }
+    }
+    state.set_items_processed(state.iterations() * std::size(hosts));
+}
+BENCHMARK(bm_vhost_find);
@@ -0,0 +1,52 @@
+#include <string>
+#include <vector>
+#include "benchmark.h"
+#include "../code/http/websocket.h"
+
+// 客户端帧负载去掩码，arg 为负载字节数
+static void bm_ws_unmask(BenchState& state) {
+    std::vector<char> payload(state.arg(), 'x');
+    const uint8_t mask[4] = { 0x12, 0x34, 0x56, 0x78 };
+    while(state.keep_running()) {
+        WebSocket::unmask(payload.data(), payload.size(), mask);
+        do_not_optimize(payload.data());
+    }
+    state.set_bytes_processed(state.iterations() * payload.size());
+}
+BENCHMARK_ARGS(bm_ws_unmask, 16, 125, 4096, 65536);
+
+// 逐字节去掩码，作为对照
+static void bm_ws_unmask_bytewise(BenchState& state) {
+    std::vector<char> payload(state.arg(), 'x');
+    const uint8_t mask[4] = { 0x12, 0x34, 0x56, 0x78 };
+    while(state.keep_running()) {
+        for(size_t i = 0; i < payload.size(); ++i) payload[i] ^= mask[i & 3];
+        do_not_optimize(payload.data());
+    }
+    state.set_bytes_processed(state.iterations() * payload.size());
+}
+BENCHMARK_ARGS(bm_ws_unmask_bytewise, 16, 125, 4096, 65536);
+
+// 解析一批带掩码的小帧（聊天、行情推送的典型大小）
+static void bm_ws_parse(BenchState& state) {
+    std::string frames;
+    const std::string msg(state.arg(), 'm');
+    for(int i = 0; i < 64; ++i) {
+        std::string f = WebSocket::frame(WebSocket::TEXT, msg);
+        f[1] |= 0x80;
+        f.insert(f.size() - msg.size(), "\0\0\0\0", 4);
+        frames += f;
+    }
+    Buffer in;
+    ChainBuffer out;
+    std::vector<WebSocket::Message> messages;
+    WebSocket ws("/bench");
+    while(state.keep_running()) {
+        in.append(frames);
+        ws.on_read(in, out, messages);
+        do_not_optimize(messages.data());
+        messages.clear();
+    }
+    state.set_items_processed(state.iterations() * 64);
+}
+BENCHMARK_ARGS(bm_ws_parse, 32, 512);
@@ -0,0 +1,99 @@
+#pragma once
+
+/*
+ * 自包含的微基准框架，接口仿照 Google Benchmark 的常用子集：
+ *     static void bm_xxx(BenchState& state) { while(state.keep_running()) {...} }
+ *     BENCHMARK(bm_xxx);
+ *     BENCHMARK_ARGS(bm_yyy, 1, 8, 32);
+ * 迭代次数自动标定到 --min_time，结果可输出为 JSON 供不同提交之间比较
+ */
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+class BenchState {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    BenchState(uint64_t iterations, int64_t arg) : iterations_(iterations), arg_(arg) {}
+
+    bool keep_running() {
+        if(count_ == 0) start_ = Clock::now();
+        if(count_ < iterations_) {
+            ++count_;
+            return true;
+        }
+        stop_ = Clock::now();
+        return false;
+    }
+
+    uint64_t iterations() const { return iterations_; }
+    int64_t arg() const { return arg_; }
+
+    // 多线程用例自行分配迭代次数时，不走 keep_running，而用这两个函数手动计时
+    void start_timing() { start_ = Clock::now(); }
+    void stop_timing() { stop_ = Clock::now(); }
+
+    void pause_timing() { pause_ = Clock::now(); }
+    void resume_timing() { paused_ += Clock::now() - pause_; }
+
+    void set_items_processed(uint64_t items) { items_ = items; }
+    void set_bytes_processed(uint64_t bytes) { bytes_ = bytes; }
+    void set_label(std::string label) { label_ = std::move(label); }
+
+    double elapsed_ns() const {
+        return std::chrono::duration<double, std::nano>(stop_ - start_ - paused_).count();
+    }
+    uint64_t items() const { return items_; }
+    uint64_t bytes() const { return bytes_; }
+    const std::string& label() const { return label_; }
+
+private:
+    uint64_t iterations_;
+    uint64_t count_ = 0;
+    int64_t arg_;
+    uint64_t items_ = 0;
+    uint64_t bytes_ = 0;
+    std::string label_;
+    Clock::time_point start_;
+    Clock::time_point stop_;
+    Clock::time_point pause_;
+    Clock::duration paused_{0};
+};
+
+struct BenchCase {
+    std::string name;
+    std::function<void(BenchState&)> fn;
+    std::vector<int64_t> args;
+};
+
+inline std::vector<BenchCase>& bench_registry() {
+    static std::vector<BenchCase> cases;
+    return cases;
+}
+
+inline int register_benchmark(std::string name, std::function<void(BenchState&)> fn,
+                              std::vector<int64_t> args = {}) {
+    bench_registry().push_back({std::move(name), std::move(fn), std::move(args)});
+    return 0;
+}
+
+#define BENCH_CONCAT_(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_(a, b)
+#define BENCHMARK(fn) \
+    static int BENCH_CONCAT(bench_reg_, __LINE__) = register_benchmark(#fn, fn)
+#define BENCHMARK_ARGS(fn, ...) \
+    static int BENCH_CONCAT(bench_reg_, __LINE__) = register_benchmark(#fn, fn, {__VA_ARGS__})
+
+// 防止被测表达式被编译器优化掉
+template<typename T>
+inline void do_not_optimize(T const& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void clobber_memory() {
+    asm volatile("" : : : "memory");
+}
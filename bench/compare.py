@@ -0,0 +1,38 @@
+#!/usr/bin/env python3
+"""比较两次 microbench --format=json 的结果，耗时增加超过阈值的用例视为回归。
+
+用法: bench/compare.py base.json new.json [阈值百分比，默认 10]
+"""
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        return {b["name"]: b["real_time"] for b in json.load(f)["benchmarks"]}
+
+
+def main():
+    if len(sys.argv) < 3:
+        print(__doc__)
+        return 2
+    base, new = load(sys.argv[1]), load(sys.argv[2])
+    threshold = float(sys.argv[3]) if len(sys.argv) > 3 else 10.0
+    regressions = 0
+    print(f"{'benchmark':<48} {'base ns':>12} {'new ns':>12} {'change':>9}")
+    for name in sorted(base.keys() & new.keys()):
+        change = (new[name] - base[name]) / base[name] * 100 if base[name] else 0.0
+        mark = ""
+        if change > threshold:
+            mark = "  REGRESSION"
+            regressions += 1
+        print(f"{name:<48} {base[name]:>12.1f} {new[name]:>12.1f} {change:>+8.1f}%{mark}")
+    for name in sorted(base.keys() - new.keys()):
+        print(f"{name:<48} removed")
+    for name in sorted(new.keys() - base.keys()):
+        print(f"{name:<48} added")
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
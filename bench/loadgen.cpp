@@ -0,0 +1,636 @@
+/*
+ * loadgen: 基于 epoll 的多线程 HTTP/1.1 压测工具，替代 webbench
+ * 支持 keep-alive、流水线深度、恒定速率开环压测（按计划发送时间计延迟，修正协调遗漏）
+ * 以及 HDR 直方图的 p50/p99/p999 延迟统计
+ *
+ * 用法: ./loadgen [-a 地址] [-p 端口] [-c 连接数] [-t 线程数] [-d 秒] [-P 流水线深度]
+ *                 [-R 总速率 req/s，0 为闭环] [-s 场景文件] [-T 超时ms] [-k 0|1] [-j]
+ */
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "../code/metrics/histogram.h"
+
+static uint64_t now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+struct Options {
+    std::string addr = "127.0.0.1";
+    int port = 2316;
+    int connections = 64;
+    int threads = 4;
+    int duration = 10;
+    int pipeline = 1;
+    double rate = 0;
+    int timeout_ms = 5000;
+    bool keep_alive = true;
+    bool json = false;
+    std::string scenario;
+};
+
+// 场景：带权重的请求集合，每行 "权重 方法 路径 [Content-Type 请求体]"
+struct Scenario {
+    std::vector<std::string> requests;
+    std::vector<uint32_t> cumulative;
+
+    bool load(const Options& opt) {
+        std::vector<std::string> lines;
+        if(opt.scenario.empty()) {
+            lines.push_back("1 GET /");
+        }
+        else {
+            std::ifstream in(opt.scenario);
+            if(!in) {
+                fprintf(stderr, "cannot open scenario %s\n", opt.scenario.c_str());
+                return false;
+            }
+            for(std::string line; std::getline(in, line);) {
+                if(line.empty() || line[0] == '#') continue;
+                lines.push_back(line);
+            }
+        }
+        uint32_t total = 0;
+        for(const auto& line : lines) {
+            std::istringstream ss(line);
+            uint32_t weight = 0;
+            std::string method, path, type, body;
+            if(!(ss >> weight >> method >> path) || weight == 0) {
+                fprintf(stderr, "bad scenario line: %s\n", line.c_str());
+                return false;
+            }
+            ss >> type;
+            std::getline(ss >> std::ws, body);
+
+            std::string req = method + " " + path + " HTTP/1.1\r\n";
+            req += "Host: " + opt.addr + ":" + std::to_string(opt.port) + "\r\n";
+            req += opt.keep_alive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+            if(!type.empty()) {
+                req += "Content-Type: " + type + "\r\n";
+                req += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+            }
+            req += "\r\n" + body;
+            requests.push_back(std::move(req));
+            total += weight;
+            cumulative.push_back(total);
+        }
+        return !requests.empty();
+    }
+
+    const std::string& pick(uint64_t& seed) const {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        uint32_t r = seed % cumulative.back();
+        size_t i = std::upper_bound(cumulative.begin(), cumulative.end(), r) - cumulative.begin();
+        return requests[i];
+    }
+};
+
+// 增量式响应解析，支持 Content-Length、chunked 和以关闭连接结束的响应体
+class ResponseParser {
+public:
+    struct Result {
+        int status;
+        bool keep_alive;
+    };
+
+    // 返回 false 表示协议错误；每解析完一个响应调用一次 done
+    template<typename F>
+    bool feed(const char* data, size_t len, F&& done) {
+        size_t i = 0;
+        while(i < len) {
+            switch(state_) {
+            case State::BODY: {
+                size_t n = std::min<uint64_t>(remaining_, len - i);
+                i += n;
+                remaining_ -= n;
+                if(remaining_ == 0) finish(done);
+                break;
+            }
+            case State::CHUNK_DATA: {
+                size_t n = std::min<uint64_t>(remaining_, len - i);
+                i += n;
+                remaining_ -= n;
+                if(remaining_ == 0) state_ = State::CHUNK_END;
+                break;
+            }
+            case State::UNTIL_CLOSE:
+                i = len;
+                break;
+            default: {
+                const char* nl = static_cast<const char*>(memchr(data + i, '\n', len - i));
+                size_t end = nl ? nl - data : len;
+                line_.append(data + i, end - i);
+                i = end;
+                if(!nl) {
+                    if(line_.size() > 16384) return false;
+                    break;
+                }
+                ++i;
+                if(!line_.empty() && line_.back() == '\r') line_.pop_back();
+                if(!on_line(done)) return false;
+                line_.clear();
+                break;
+            }
+            }
+        }
+        return true;
+    }
+
+    // 对端关闭时，以关闭为结束的响应体视为完成
+    template<typename F>
+    bool on_eof(F&& done) {
+        if(state_ == State::UNTIL_CLOSE) {
+            keep_alive_ = false;
+            finish(done);
+            return true;
+        }
+        return state_ == State::STATUS && line_.empty();
+    }
+
+    void reset() {
+        state_ = State::STATUS;
+        line_.clear();
+    }
+
+private:
+    enum class State { STATUS, HEADERS, BODY, CHUNK_SIZE, CHUNK_DATA, CHUNK_END, TRAILERS, UNTIL_CLOSE };
+
+    static bool iequals(std::string_view a, std::string_view b) {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(),
+            [](char x, char y) { return tolower(x) == tolower(y); });
+    }
+
+    template<typename F>
+    void finish(F&& done) {
+        state_ = State::STATUS;
+        done(Result{status_, keep_alive_});
+    }
+
+    template<typename F>
+    bool on_line(F&& done) {
+        std::string_view line = line_;
+        switch(state_) {
+        case State::STATUS:
+            if(line.empty()) return true;
+            if(line.size() < 12 || line.substr(0, 5) != "HTTP/") return false;
+            status_ = atoi(line.data() + 9);
+            keep_alive_ = line.substr(5, 3) == "1.1";
+            chunked_ = false;
+            remaining_ = -1;
+            state_ = State::HEADERS;
+            return true;
+        case State::HEADERS: {
+            if(line.empty()) {
+                if(chunked_) state_ = State::CHUNK_SIZE;
+                else if(remaining_ > 0) state_ = State::BODY;
+                else if(remaining_ == 0 || status_ == 204 || status_ == 304 || status_ < 200) finish(done);
+                else state_ = State::UNTIL_CLOSE;
+                return true;
+            }
+            size_t colon = line.find(':');
+            if(colon == std::string_view::npos) return false;
+            std::string_view name = line.substr(0, colon);
+            std::string_view value = line.substr(colon + 1);
+            while(!value.empty() && value.front() == ' ') value.remove_prefix(1);
+            if(iequals(name, "Content-Length")) {
+                remaining_ = strtoll(std::string(value).c_str(), nullptr, 10);
+            }
+            else if(iequals(name, "Transfer-Encoding")) {
+                chunked_ = iequals(value, "chunked");
+            }
+            else if(iequals(name, "Connection")) {
+                if(iequals(value, "close")) keep_alive_ = false;
+                else if(iequals(value, "keep-alive")) keep_alive_ = true;
+            }
+            return true;
+        }
+        case State::CHUNK_SIZE:
+            remaining_ = strtoll(std::string(line).c_str(), nullptr, 16);
+            state_ = remaining_ == 0 ? State::TRAILERS : State::CHUNK_DATA;
+            return true;
+        case State::CHUNK_END:
+            state_ = State::CHUNK_SIZE;
+            return line.empty();
+        case State::TRAILERS:
+            if(line.empty()) finish(done);
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    State state_ = State::STATUS;
+    std::string line_;
+    int status_ = 0;
+    bool keep_alive_ = true;
+    bool chunked_ = false;
+    int64_t remaining_ = -1;
+};
+
+struct Stats {
+    Histogram latency;
+    uint64_t requests = 0;
+    uint64_t responses = 0;
+    uint64_t bytes = 0;
+    uint64_t connects = 0;
+    uint64_t connect_errors = 0;
+    uint64_t read_errors = 0;
+    uint64_t timeouts = 0;
+    uint64_t status[6] = {};
+
+    void merge(const Stats& o) {
+        latency.merge(o.latency);
+        requests += o.requests;
+        responses += o.responses;
+        bytes += o.bytes;
+        connects += o.connects;
+        connect_errors += o.connect_errors;
+        read_errors += o.read_errors;
+        timeouts += o.timeouts;
+        for(int i = 0; i < 6; i++) status[i] += o.status[i];
+    }
+};
+
+class Worker {
+public:
+    Worker(const Options& opt, const Scenario& scenario, int connections, double rate, int id)
+        : opt_(opt), scenario_(scenario), conns_(connections), rate_(rate),
+          seed_(0x9E3779B97F4A7C15ull * (id + 1)) {}
+
+    void run(uint64_t start, uint64_t end);
+    const Stats& stats() const { return stats_; }
+
+private:
+    struct Conn {
+        int fd = -1;
+        bool connecting = false;
+        bool closing = false;
+        uint32_t events = 0;
+        std::string out;
+        size_t out_off = 0;
+        std::deque<uint64_t> inflight;      // 每个在途请求的计划开始时间
+        ResponseParser parser;
+    };
+
+    void connect_(Conn& c);
+    void close_(Conn& c, bool error);
+    void update_events_(Conn& c);
+    void send_(Conn& c, uint64_t intended);
+    void flush_(Conn& c);
+    void on_readable_(Conn& c);
+    void on_response_(Conn& c, const ResponseParser::Result& res);
+    void dispatch_pending_();
+    void check_timeouts_(uint64_t now);
+    size_t slots_(const Conn& c) const;
+
+    const Options& opt_;
+    const Scenario& scenario_;
+    std::vector<Conn> conns_;
+    double rate_;
+    uint64_t seed_;
+    int epfd_ = -1;
+    bool running_ = true;
+    std::deque<uint64_t> pending_;          // 开环模式下已到计划时间、尚未发出的请求
+    Stats stats_;
+};
+
+size_t Worker::slots_(const Conn& c) const {
+    if(c.fd < 0 || c.connecting || c.closing) return 0;
+    size_t depth = opt_.keep_alive ? opt_.pipeline : 1;
+    return c.inflight.size() < depth ? depth - c.inflight.size() : 0;
+}
+
+void Worker::connect_(Conn& c) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(opt_.port);
+    inet_pton(AF_INET, opt_.addr.c_str(), &addr.sin_addr);
+
+    c.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int one = 1;
+    setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    c.connecting = true;
+    c.closing = false;
+    c.out.clear();
+    c.out_off = 0;
+    c.parser.reset();
+    if(connect(c.fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 && errno != EINPROGRESS) {
+        stats_.connect_errors++;
+    }
+    epoll_event ev{};
+    ev.events = c.events = EPOLLOUT | EPOLLIN | EPOLLRDHUP;
+    ev.data.ptr = &c;
+    epoll_ctl(epfd_, EPOLL_CTL_ADD, c.fd, &ev);
+}
+
+void Worker::close_(Conn& c, bool error) {
+    if(error) {
+        stats_.read_errors += c.inflight.empty() ? 0 : 1;
+    }
+    // 开环模式下未完成的请求重新排队，其延迟仍从计划时间算起
+    if(rate_ > 0) {
+        for(auto it = c.inflight.rbegin(); it != c.inflight.rend(); ++it) {
+            pending_.push_front(*it);
+        }
+    }
+    c.inflight.clear();
+    epoll_ctl(epfd_, EPOLL_CTL_DEL, c.fd, nullptr);
+    ::close(c.fd);
+    c.fd = -1;
+    if(running_) connect_(c);
+}
+
+void Worker::update_events_(Conn& c) {
+    uint32_t events = EPOLLIN | EPOLLRDHUP;
+    if(c.connecting || c.out_off < c.out.size()) events |= EPOLLOUT;
+    if(events == c.events) return;
+    epoll_event ev{};
+    ev.events = c.events = events;
+    ev.data.ptr = &c;
+    epoll_ctl(epfd_, EPOLL_CTL_MOD, c.fd, &ev);
+}
+
+void Worker::send_(Conn& c, uint64_t intended) {
+    c.out += scenario_.pick(seed_);
+    c.inflight.push_back(intended);
+    stats_.requests++;
+    if(!opt_.keep_alive) c.closing = true;
+}
+
+void Worker::flush_(Conn& c) {
+    while(c.out_off < c.out.size()) {
+        ssize_t n = ::send(c.fd, c.out.data() + c.out_off, c.out.size() - c.out_off, MSG_NOSIGNAL);
+        if(n < 0) {
+            if(errno != EAGAIN) close_(c, true);
+            break;
+        }
+        c.out_off += n;
+    }
+    if(c.fd >= 0 && c.out_off == c.out.size()) {
+        c.out.clear();
+        c.out_off = 0;
+    }
+    if(c.fd >= 0) update_events_(c);
+}
+
+void Worker::on_response_(Conn& c, const ResponseParser::Result& res) {
+    if(c.inflight.empty()) return;
+    const uint64_t now = now_ns();
+    stats_.latency.record(now - c.inflight.front());
+    c.inflight.pop_front();
+    stats_.responses++;
+    int cls = res.status / 100;
+    stats_.status[(cls >= 1 && cls <= 5) ? cls : 0]++;
+    if(!res.keep_alive) c.closing = true;
+    else if(rate_ <= 0 && running_) send_(c, now);
+}
+
+void Worker::on_readable_(Conn& c) {
+    static thread_local char buf[65536];
+    for(;;) {
+        ssize_t n = ::recv(c.fd, buf, sizeof(buf), 0);
+        if(n > 0) {
+            stats_.bytes += n;
+            bool ok = c.parser.feed(buf, n, [&](const ResponseParser::Result& res) { on_response_(c, res); });
+            if(!ok) {
+                close_(c, true);
+                return;
+            }
+            continue;
+        }
+        if(n < 0 && errno == EAGAIN) break;
+        bool clean = c.parser.on_eof([&](const ResponseParser::Result& res) { on_response_(c, res); });
+        close_(c, !clean || !c.inflight.empty());
+        return;
+    }
+    if(c.closing && c.inflight.empty()) {
+        close_(c, false);
+        return;
+    }
+    flush_(c);
+}
+
+void Worker::dispatch_pending_() {
+    size_t cursor = 0;
+    while(!pending_.empty()) {
+        size_t tried = 0;
+        while(tried < conns_.size() && slots_(conns_[cursor]) == 0) {
+            cursor = (cursor + 1) % conns_.size();
+            ++tried;
+        }
+        if(tried == conns_.size()) break;
+        Conn& c = conns_[cursor];
+        while(slots_(c) > 0 && !pending_.empty()) {
+            send_(c, pending_.front());
+            pending_.pop_front();
+        }
+        flush_(c);
+    }
+}
+
+void Worker::check_timeouts_(uint64_t now) {
+    const uint64_t limit = opt_.timeout_ms * 1000000ull;
+    for(auto& c : conns_) {
+        if(c.fd >= 0 && !c.inflight.empty() && now - c.inflight.front() > limit) {
+            stats_.timeouts++;
+            if(rate_ > 0) {
+                stats_.latency.record(now - c.inflight.front());
+                c.inflight.pop_front();
+            }
+            close_(c, false);
+        }
+    }
+}
+
+void Worker::run(uint64_t start, uint64_t end) {
+    epfd_ = epoll_create1(EPOLL_CLOEXEC);
+    int tfd = -1;
+    uint64_t interval = 0;
+    uint64_t next_send = start;
+    if(rate_ > 0) {
+        interval = static_cast<uint64_t>(1e9 / rate_);
+        tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.ptr = nullptr;
+        epoll_ctl(epfd_, EPOLL_CTL_ADD, tfd, &ev);
+    }
+    for(auto& c : conns_) connect_(c);
+
+    epoll_event events[256];
+    uint64_t last_check = start;
+    for(uint64_t now = now_ns(); now < end; now = now_ns()) {
+        if(rate_ > 0) {
+            // 按计划时间排队，之后的延迟都以计划时间为起点
+            while(next_send <= now) {
+                pending_.push_back(next_send);
+                next_send += interval;
+            }
+            dispatch_pending_();
+            itimerspec its{};
+            uint64_t at = std::min(next_send, end);
+            its.it_value.tv_sec = at / 1000000000ull;
+            its.it_value.tv_nsec = at % 1000000000ull;
+            timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, nullptr);
+        }
+
+        int timeout = static_cast<int>(std::min<uint64_t>((end - now) / 1000000 + 1, 100));
+        int n = epoll_wait(epfd_, events, 256, timeout);
+        for(int i = 0; i < n; i++) {
+            if(events[i].data.ptr == nullptr) {
+                uint64_t expirations;
+                [[maybe_unused]] ssize_t r = ::read(tfd, &expirations, sizeof(expirations));
+                continue;
+            }
+            Conn& c = *static_cast<Conn*>(events[i].data.ptr);
+            if(c.fd < 0) continue;
+            if(c.connecting) {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+                if(err != 0 || (events[i].events & (EPOLLERR | EPOLLHUP))) {
+                    stats_.connect_errors++;
+                    close_(c, false);
+                    continue;
+                }
+                c.connecting = false;
+                stats_.connects++;
+                if(rate_ <= 0) {
+                    for(size_t k = slots_(c); k > 0; --k) send_(c, now_ns());
+                }
+                flush_(c);
+                continue;
+            }
+            if(events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                on_readable_(c);
+                if(c.fd < 0) continue;
+            }
+            if(events[i].events & EPOLLOUT) flush_(c);
+        }
+        now = now_ns();
+        if(now - last_check > 100000000ull) {
+            check_timeouts_(now);
+            last_check = now;
+        }
+    }
+
+    running_ = false;
+    for(auto& c : conns_) {
+        if(c.fd >= 0) {
+            epoll_ctl(epfd_, EPOLL_CTL_DEL, c.fd, nullptr);
+            ::close(c.fd);
+        }
+    }
+    if(tfd >= 0) ::close(tfd);
+    ::close(epfd_);
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+        "usage: %s [-a addr] [-p port] [-c connections] [-t threads] [-d seconds]\n"
+        "          [-P pipeline] [-R rate] [-s scenario] [-T timeout_ms] [-k 0|1] [-j]\n", prog);
+}
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    int ch;
+    while((ch = getopt(argc, argv, "a:p:c:t:d:P:R:s:T:k:jh")) != -1) {
+        switch(ch) {
+        case 'a': opt.addr = optarg; break;
+        case 'p': opt.port = atoi(optarg); break;
+        case 'c': opt.connections = atoi(optarg); break;
+        case 't': opt.threads = atoi(optarg); break;
+        case 'd': opt.duration = atoi(optarg); break;
+        case 'P': opt.pipeline = std::max(1, atoi(optarg)); break;
+        case 'R': opt.rate = atof(optarg); break;
+        case 's': opt.scenario = optarg; break;
+        case 'T': opt.timeout_ms = atoi(optarg); break;
+        case 'k': opt.keep_alive = atoi(optarg) != 0; break;
+        case 'j': opt.json = true; break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    opt.threads = std::clamp(opt.threads, 1, std::max(1, opt.connections));
+
+    Scenario scenario;
+    if(!scenario.load(opt)) return 1;
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    for(int i = 0; i < opt.threads; i++) {
+        int conns = opt.connections / opt.threads + (i < opt.connections % opt.threads ? 1 : 0);
+        workers.push_back(std::make_unique<Worker>(opt, scenario, conns, opt.rate / opt.threads, i));
+    }
+
+    const uint64_t start = now_ns();
+    const uint64_t end = start + opt.duration * 1000000000ull;
+    std::vector<std::thread> threads;
+    for(auto& w : workers) {
+        threads.emplace_back([&w, start, end] { w->run(start, end); });
+    }
+    for(auto& t : threads) t.join();
+    const double elapsed = (now_ns() - start) / 1e9;
+
+    Stats total;
+    for(auto& w : workers) total.merge(w->stats());
+    const Histogram& h = total.latency;
+    const double pcts[] = {50, 75, 90, 99, 99.9, 99.99};
+
+    if(opt.json) {
+        printf("{\"addr\":\"%s:%d\",\"scenario\":\"%s\",\"threads\":%d,\"connections\":%d,"
+               "\"pipeline\":%d,\"rate\":%.0f,\"duration_s\":%.3f,\"requests\":%lu,\"responses\":%lu,"
+               "\"rps\":%.1f,\"bytes_per_s\":%.1f,\"status\":{\"1xx\":%lu,\"2xx\":%lu,\"3xx\":%lu,"
+               "\"4xx\":%lu,\"5xx\":%lu,\"other\":%lu},\"errors\":{\"connect\":%lu,\"read\":%lu,"
+               "\"timeout\":%lu},\"latency_us\":{\"min\":%.1f,\"mean\":%.1f,\"max\":%.1f",
+               opt.addr.c_str(), opt.port, opt.scenario.c_str(), opt.threads, opt.connections,
+               opt.pipeline, opt.rate, elapsed, total.requests, total.responses,
+               total.responses / elapsed, total.bytes / elapsed, total.status[1], total.status[2],
+               total.status[3], total.status[4], total.status[5], total.status[0],
+               total.connect_errors, total.read_errors, total.timeouts,
+               h.min() / 1e3, h.mean() / 1e3, h.max() / 1e3);
+        for(double p : pcts) printf(",\"p%g\":%.1f", p, h.percentile(p) / 1e3);
+        printf("}}\n");
+        return 0;
+    }
+
+    printf("Running %ds test @ %s:%d%s%s\n", opt.duration, opt.addr.c_str(), opt.port,
+           opt.scenario.empty() ? "" : " scenario ", opt.scenario.c_str());
+    printf("  %d threads, %d connections, pipeline %d, %s, %s\n", opt.threads, opt.connections,
+           opt.pipeline, opt.keep_alive ? "keep-alive" : "close",
+           opt.rate > 0 ? ("open-loop " + std::to_string((long)opt.rate) + " req/s").c_str() : "closed-loop");
+    printf("  Requests: %lu sent, %lu completed in %.2fs, %.1f req/s, %.2f MB/s\n",
+           total.requests, total.responses, elapsed, total.responses / elapsed,
+           total.bytes / elapsed / (1 << 20));
+    printf("  Status:   1xx %lu, 2xx %lu, 3xx %lu, 4xx %lu, 5xx %lu, other %lu\n",
+           total.status[1], total.status[2], total.status[3], total.status[4],
+           total.status[5], total.status[0]);
+    printf("  Errors:   connect %lu, read %lu, timeout %lu\n",
+           total.connect_errors, total.read_errors, total.timeouts);
+    printf("  Latency (us): min %.1f, mean %.1f, max %.1f\n", h.min() / 1e3, h.mean() / 1e3, h.max() / 1e3);
+    for(double p : pcts) {
+        printf("    p%-6g %10.1f\n", p, h.percentile(p) / 1e3);
+    }
+    return 0;
+}
@@ -1,7 +1,9 @@
 #include "buffer.h"
+#include <cstddef>
 
 ssize_t Buffer::read_fd(int fd, int* saved_errno) noexcept {
-    alignas(alignof(std::max_align_t)) char extra_buffer[kExtraSize];
+    // 额外空间放在线程本地，不占栈、也不经过块池；读进来的数据最终仍拷回 buffer_，读侧保持连续
+    alignas(alignof(std::max_align_t)) static thread_local char extra_buffer[kExtraSize];
 
     iovec vec[2];
     const size_t writable = writable_bytes();
@@ -11,7 +13,8 @@ ssize_t Buffer::read_fd(int fd, int* saved_errno) noexcept {
     vec[1].iov_base = extra_buffer;
     vec[1].iov_len = sizeof(extra_buffer);
 
-    const ssize_t n = readv(fd, vec, 2);
+    // 剩余空间已经够大时只读进 buffer_
+    const ssize_t n = readv(fd, vec, writable < sizeof(extra_buffer) ? 2 : 1);
     if(n < 0) {
         *saved_errno = errno;
     }
@@ -34,4 +37,4 @@ ssize_t Buffer::write_fd(int fd, int* saved_errno) noexcept {
     }
     read_pos_ += n;
     return n;
-}
\ No newline at end of file
+}
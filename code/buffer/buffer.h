@@ -6,14 +6,14 @@
 #include <span>
 #include <concepts>
 #include <cstring>
-#include <atomic>
 #include <sys/uio.h>
+#include "chainbuffer.h"
 
 class Buffer {
 public:
     static constexpr size_t kInitialSize = 1024;
     static constexpr size_t kMaxSize = 64 * 1024 * 1024; 
-    static constexpr size_t kExtraSize = 65536; 
+    static constexpr size_t kExtraSize = 64 * 1024;
 
     explicit Buffer(size_t initsize = kInitialSize): buffer_(initsize){}
 
@@ -37,6 +37,10 @@ public:
         return read_pos_;
     }
 
+    size_t capacity() const noexcept {
+        return buffer_.size();
+    }
+
     template<typename T>
     void append(const T* data, size_t len) {
         assert(data);
@@ -45,9 +49,9 @@ public:
         has_written(len);
     }
 
-    void append(const std::string& str) {
+    void append(std::string_view str) {
         append(str.data(), str.length());
-    }   
+    }
 
     void retrieve(size_t len) noexcept {
         read_pos_ += len;
@@ -121,6 +125,6 @@ private:
     }
 
     std::vector<char> buffer_;
-    std::atomic<std::size_t> read_pos_{0};
-    std::atomic<std::size_t> write_pos_{0};
+    std::size_t read_pos_ = 0;
+    std::size_t write_pos_ = 0;
 };
@@ -0,0 +1,202 @@
+#include "chainbuffer.h"
+#include <algorithm>
+#include <cerrno>
+#include <unistd.h>
+
+#include "../config/runtime.h"
+
+BlockPool::~BlockPool() {
+    for(char* block : free_) {
+        delete[] block;
+    }
+}
+
+char* BlockPool::acquire() {
+    in_use_.fetch_add(1, std::memory_order_relaxed);
+    if(free_.empty()) {
+        return new char[kBlockSize];
+    }
+    char* block = free_.back();
+    free_.pop_back();
+    return block;
+}
+
+void BlockPool::release(char* block) noexcept {
+    in_use_.fetch_sub(1, std::memory_order_relaxed);
+    if(free_.size() < RuntimeConfig::local().block_cache) {
+        free_.push_back(block);
+    }
+    else {
+        delete[] block;
+    }
+}
+
+ChainBuffer::Segment& ChainBuffer::tail_block() {
+    if(segments_.empty() || segments_.back().writable() == 0) {
+        Segment seg;
+        seg.block = BlockPool::local().acquire();
+        seg.data = seg.block;
+        segments_.push_back(std::move(seg));
+    }
+    return segments_.back();
+}
+
+char* ChainBuffer::prepare(size_t len) {
+    assert(len <= BlockPool::kBlockSize);
+    // 尾块剩余不够时直接换新块，剩下的一点空间不再使用
+    if(segments_.empty() || segments_.back().writable() < std::max<size_t>(len, 1)) {
+        Segment seg;
+        seg.block = BlockPool::local().acquire();
+        seg.data = seg.block;
+        segments_.push_back(std::move(seg));
+    }
+    Segment& seg = segments_.back();
+    return seg.block + seg.end;
+}
+
+void ChainBuffer::release(Segment& seg) noexcept {
+    if(seg.block) {
+        BlockPool::local().release(seg.block);
+        seg.block = nullptr;
+    }
+    seg.shared.reset();
+}
+
+void ChainBuffer::append(const char* data, size_t len) {
+    assert(data || len == 0);
+    while(len > 0) {
+        Segment& seg = tail_block();
+        const size_t n = std::min(len, seg.writable());
+        std::memcpy(seg.block + seg.end, data, n);
+        seg.end += n;
+        readable_ += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void ChainBuffer::append_ref(SharedBlock block, const char* data, size_t len) {
+    if(len == 0) return;
+    if(len < kCopyThreshold) {
+        append(data, len);
+        return;
+    }
+    Segment seg;
+    seg.shared = std::move(block);
+    seg.data = data;
+    seg.end = len;
+    segments_.push_back(std::move(seg));
+    readable_ += len;
+    shared_ += len;
+}
+
+void ChainBuffer::retrieve(size_t len) noexcept {
+    assert(len <= readable_);
+    len = std::min(len, readable_);
+    readable_ -= len;
+    while(len > 0) {
+        Segment& seg = segments_.front();
+        const size_t n = std::min(len, seg.size());
+        seg.begin += n;
+        len -= n;
+        if(!seg.block) shared_ -= n;
+        if(seg.begin == seg.end) {
+            release(seg);
+            segments_.pop_front();
+        }
+    }
+}
+
+void ChainBuffer::retrieve_all() noexcept {
+    for(auto& seg : segments_) {
+        release(seg);
+    }
+    segments_.clear();
+    readable_ = 0;
+    shared_ = 0;
+}
+
+std::string ChainBuffer::retrieve_allstring() {
+    std::string res;
+    res.reserve(readable_);
+    for(const auto& seg : segments_) {
+        res.append(seg.data + seg.begin, seg.size());
+    }
+    retrieve_all();
+    return res;
+}
+
+int ChainBuffer::as_iovecs(iovec* vec, int max_count, size_t max_bytes) const noexcept {
+    int count = 0;
+    for(const auto& seg : segments_) {
+        if(count >= max_count || max_bytes == 0) break;
+        if(seg.size() == 0) continue;
+        vec[count].iov_base = const_cast<char*>(seg.data + seg.begin);
+        vec[count].iov_len = std::min(seg.size(), max_bytes);
+        max_bytes -= vec[count].iov_len;
+        ++count;
+    }
+    return count;
+}
+
+ssize_t ChainBuffer::read_fd(int fd, int* saved_errno) {
+    BlockPool& pool = BlockPool::local();
+    iovec vec[kReadBlocks + 1];
+    char* fresh[kReadBlocks];
+    int count = 0;
+
+    // 先填满尾块剩余空间，再直接读入新取出的空闲块
+    Segment* tail = nullptr;
+    if(!segments_.empty() && segments_.back().writable() > 0) {
+        tail = &segments_.back();
+        vec[count].iov_base = tail->block + tail->end;
+        vec[count].iov_len = tail->writable();
+        ++count;
+    }
+    for(int i = 0; i < kReadBlocks; ++i) {
+        fresh[i] = pool.acquire();
+        vec[count].iov_base = fresh[i];
+        vec[count].iov_len = BlockPool::kBlockSize;
+        ++count;
+    }
+
+    const ssize_t n = readv(fd, vec, count);
+    if(n < 0) {
+        *saved_errno = errno;
+    }
+
+    size_t left = n > 0 ? static_cast<size_t>(n) : 0;
+    readable_ += left;
+    if(tail) {
+        const size_t k = std::min(left, tail->writable());
+        tail->end += k;
+        left -= k;
+    }
+    for(int i = 0; i < kReadBlocks; ++i) {
+        if(left == 0) {
+            pool.release(fresh[i]);
+            continue;
+        }
+        Segment seg;
+        seg.block = fresh[i];
+        seg.data = fresh[i];
+        seg.end = std::min(left, BlockPool::kBlockSize);
+        left -= seg.end;
+        segments_.push_back(std::move(seg));
+    }
+    return n;
+}
+
+ssize_t ChainBuffer::write_fd(int fd, int* saved_errno, size_t max_bytes) noexcept {
+    iovec vec[kMaxIovecs];
+    const int count = as_iovecs(vec, kMaxIovecs, max_bytes);
+    if(count == 0) return 0;
+
+    const ssize_t n = writev(fd, vec, count);
+    if(n < 0) {
+        *saved_errno = errno;
+        return n;
+    }
+    retrieve(n);
+    return n;
+}
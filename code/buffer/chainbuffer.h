@@ -0,0 +1,121 @@
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+// 固定大小内存块的线程本地缓存，每个 EventLoop 线程各自持有一份，无需加锁；缓存的块数上限为 http.block_cache
+// 另有一个全局计数记录所有线程借出未还的块，即写缓冲区实际占用的内存，供 http.output_budget 判断
+class BlockPool {
+public:
+    static constexpr size_t kBlockSize = 16 * 1024;
+
+    static BlockPool& local() {
+        thread_local BlockPool pool;
+        return pool;
+    }
+
+    ~BlockPool();
+
+    BlockPool(const BlockPool&) = delete;
+    BlockPool& operator=(const BlockPool&) = delete;
+
+    char* acquire();
+    void release(char* block) noexcept;
+
+    size_t cached() const noexcept { return free_.size(); }
+
+    // 所有线程借出未还的字节数
+    static size_t in_use() noexcept { return in_use_.load(std::memory_order_relaxed) * kBlockSize; }
+
+private:
+    BlockPool() = default;
+
+    std::vector<char*> free_;
+    static inline std::atomic<size_t> in_use_{0};
+};
+
+// 分段缓冲区：由池化的定长块和共享只读块组成的链表
+// 读写游标只属于单个连接所在的线程，因此不使用原子变量
+class ChainBuffer {
+public:
+    // 共享只读块（缓存的响应头、mmap 的文件内容），按引用追加，不拷贝
+    using SharedBlock = std::shared_ptr<const char>;
+
+    static constexpr size_t kCopyThreshold = 512;
+    static constexpr int kReadBlocks = 4;
+    static constexpr int kMaxIovecs = 64;
+
+    ChainBuffer() = default;
+    ~ChainBuffer() { retrieve_all(); }
+
+    ChainBuffer(const ChainBuffer&) = delete;
+    ChainBuffer& operator=(const ChainBuffer&) = delete;
+
+    size_t readable_bytes() const noexcept { return readable_; }
+    bool empty() const noexcept { return readable_ == 0; }
+    // 池化块中的字节数，即占用的内存；共享块（mmap 的文件）不计
+    size_t owned_bytes() const noexcept { return readable_ - shared_; }
+
+    void append(const char* data, size_t len);
+
+    void append(std::string_view str) {
+        append(str.data(), str.size());
+    }
+
+    // 追加共享块的一段，较小的片段直接拷贝，避免 iovec 过碎
+    void append_ref(SharedBlock block, const char* data, size_t len);
+
+    void append_ref(SharedBlock block, size_t len) {
+        const char* data = block.get();
+        append_ref(std::move(block), data, len);
+    }
+
+    // 直接写入尾部的池化块：prepare 返回至少 len 字节的连续可写空间（len 不超过一个块），
+    // 写完后 commit 实际写入的字节数；commit 之前不能再追加
+    char* prepare(size_t len);
+    void commit(size_t len) noexcept {
+        assert(!segments_.empty() && len <= segments_.back().writable());
+        segments_.back().end += len;
+        readable_ += len;
+    }
+
+    void retrieve(size_t len) noexcept;
+    void retrieve_all() noexcept;
+    std::string retrieve_allstring();
+
+    // 填充 iovec 数组用于 writev，返回使用的个数；总长不超过 max_bytes
+    int as_iovecs(iovec* vec, int max_count, size_t max_bytes = SIZE_MAX) const noexcept;
+
+    ssize_t read_fd(int fd, int* saved_errno);
+    // 一次最多写 max_bytes，大文件不会一次把整个发送缓冲区填满
+    ssize_t write_fd(int fd, int* saved_errno, size_t max_bytes = SIZE_MAX) noexcept;
+
+private:
+    struct Segment {
+        char* block = nullptr;      // 池化块，可写
+        SharedBlock shared;         // 共享块，只读
+        const char* data = nullptr;
+        size_t begin = 0;
+        size_t end = 0;
+
+        size_t size() const noexcept { return end - begin; }
+        size_t writable() const noexcept {
+            return block ? BlockPool::kBlockSize - end : 0;
+        }
+    };
+
+    Segment& tail_block();
+    void release(Segment& seg) noexcept;
+
+    std::deque<Segment> segments_;
+    size_t readable_ = 0;
+    size_t shared_ = 0;
+};
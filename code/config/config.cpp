@@ -0,0 +1,451 @@
+#include "config.h"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <variant>
+
+#include "../event/affinity.h"
+#include "../http/httptables.h"
+
+using std::string;
+using std::string_view;
+
+namespace {
+
+using Field = std::variant<int*, uint32_t*, size_t*, bool*, string*, DispatchPolicy*,
+                           ConcurrencyLimiter::Algorithm*>;
+
+struct Option {
+    string_view key;
+    bool reloadable;
+    Field (*field)(ServerConfig&);
+    long long min = 0;
+    long long max = INT_MAX;
+};
+
+#define FIELD(member) [](ServerConfig& c) -> Field { return &c.member; }
+
+// [vhost.<主机名>] 中的键，默认站点的同名键在 [http] 中
+struct VhostOption {
+    string_view key;
+    Field (*field)(VhostConfig&);
+    long long min = 0;
+    long long max = INT_MAX;
+};
+
+#define VHOST_FIELD(member) [](VhostConfig& v) -> Field { return &v.member; }
+
+const VhostOption kVhostOptions[] = {
+    { "root",                       VHOST_FIELD(root) },
+    { "aliases",                    VHOST_FIELD(aliases) },
+    { "mime",                       VHOST_FIELD(mime) },
+    { "cache_control",              VHOST_FIELD(cache_control) },
+    { "file_cache",                 VHOST_FIELD(file_cache), 0, LLONG_MAX },
+    { "file_cache_max_file",        VHOST_FIELD(file_cache_max_file), 0, LLONG_MAX },
+};
+
+#undef VHOST_FIELD
+
+const Option kOptions[] = {
+    { "server.port",                false, FIELD(port), 1024, 65535 },
+    { "server.trig_mode",           false, FIELD(trig_mode), 0, 3 },
+    { "server.linger",              false, FIELD(linger) },
+    { "server.backlog",             false, FIELD(backlog), 1 },
+    { "server.threads",             false, FIELD(threads), 1, 1024 },
+    { "server.dispatch",            false, FIELD(dispatch) },
+    { "server.stall_ms",            false, FIELD(stall_ms) },
+    { "server.main_cpus",           false, FIELD(main_cpus) },
+    { "server.io_cpus",             false, FIELD(io_cpus) },
+    { "server.log_cpus",            false, FIELD(log_cpus) },
+    { "server.incoming_cpu",        false, FIELD(incoming_cpu) },
+    { "server.timeout_ms",          true,  FIELD(runtime.timeout_ms) },
+    { "server.io_budget",           true,  FIELD(runtime.io_budget), 4096, LLONG_MAX },
+    { "mysql.host",                 false, FIELD(sql_host) },
+    { "mysql.port",                 false, FIELD(sql_port), 1, 65535 },
+    { "mysql.user",                 false, FIELD(sql_user) },
+    { "mysql.password",             false, FIELD(sql_password) },
+    { "mysql.database",             false, FIELD(sql_database) },
+    { "mysql.pool_size",            false, FIELD(sql_pool), 1, 1024 },
+    { "log.enable",                 false, FIELD(log_enable) },
+    { "log.dir",                    false, FIELD(log_dir) },
+    { "log.queue_size",             false, FIELD(log_queue), 0, 1 << 20 },
+    { "log.level",                  true,  FIELD(runtime.log_level), 0, 3 },
+    { "http.max_body_size",         true,  FIELD(runtime.max_body_size), 0, LLONG_MAX },
+    { "http.read_high_water",       true,  FIELD(runtime.read_high_water), 4096, LLONG_MAX },
+    { "http.write_high_water",      true,  FIELD(runtime.write_high_water), 4096, LLONG_MAX },
+    { "http.write_low_water",       true,  FIELD(runtime.write_low_water), 4096, LLONG_MAX },
+    { "http.output_budget",         true,  FIELD(runtime.output_budget), 0, LLONG_MAX },
+    { "http.block_cache",           true,  FIELD(runtime.block_cache), 0, LLONG_MAX },
+    { "http.keepalive_timeout_ms",  true,  FIELD(runtime.keepalive_timeout_ms), 1 },
+    { "http.keepalive_requests",    true,  FIELD(runtime.keepalive_requests), 0, UINT32_MAX },
+    { "http.first_byte_timeout_ms", true,  FIELD(runtime.first_byte_timeout_ms), 0 },
+    { "http.header_timeout_ms",     true,  FIELD(runtime.header_timeout_ms), 0 },
+    { "http.body_timeout_ms",       true,  FIELD(runtime.body_timeout_ms), 0 },
+    { "http.min_body_rate",         true,  FIELD(runtime.min_body_rate), 0, UINT32_MAX },
+    { "http.upload_prefix",         false, FIELD(upload_prefix) },
+    { "http.upload_dir",            false, FIELD(upload_dir) },
+    { "http.upload_limit",          false, FIELD(upload_limit), 0, LLONG_MAX },
+    { "http.root",                  false, FIELD(default_host.root) },
+    { "http.mime",                  false, FIELD(default_host.mime) },
+    { "http.cache_control",         false, FIELD(default_host.cache_control) },
+    { "http.file_cache",            false, FIELD(default_host.file_cache), 0, LLONG_MAX },
+    { "http.file_cache_max_file",   false, FIELD(default_host.file_cache_max_file), 0, LLONG_MAX },
+    { "limit.capacity",             false, FIELD(limit_capacity), 8, 1ll << 32 },
+    { "limit.max_conns",            true,  FIELD(runtime.max_conns), 0, UINT32_MAX },
+    { "limit.static_rate",          true,  FIELD(runtime.static_rate), 0, UINT32_MAX },
+    { "limit.static_burst",         true,  FIELD(runtime.static_burst), 1, UINT32_MAX },
+    { "limit.dynamic_rate",         true,  FIELD(runtime.dynamic_rate), 0, UINT32_MAX },
+    { "limit.dynamic_burst",        true,  FIELD(runtime.dynamic_burst), 1, UINT32_MAX },
+    { "limit.concurrency",          false, FIELD(concurrency) },
+    { "limit.min_concurrency",      false, FIELD(min_concurrency), 1 },
+    { "limit.max_concurrency",      false, FIELD(max_concurrency), 1 },
+    { "limit.initial_concurrency",  false, FIELD(initial_concurrency), 1 },
+    { "tls.cert_file",              false, FIELD(tls_cert) },
+    { "tls.key_file",               false, FIELD(tls_key) },
+    { "tls.ticket_key_file",        false, FIELD(tls_ticket_key) },
+};
+
+#undef FIELD
+
+const Option* find_option(string_view key) {
+    for(const Option& option : kOptions) {
+        if(option.key == key) return &option;
+    }
+    return nullptr;
+}
+
+string_view trim(string_view s) {
+    const size_t begin = s.find_first_not_of(" \t\r");
+    if(begin == string_view::npos) return {};
+    return s.substr(begin, s.find_last_not_of(" \t\r") - begin + 1);
+}
+
+// 整数可带 K/M/G 后缀（1024 进制），用于缓冲区和正文大小
+bool parse_number(string_view value, long long& out) {
+    long long n = 0;
+    const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), n);
+    if(ec != std::errc() || end == value.data()) return false;
+    string_view suffix(end, value.data() + value.size() - end);
+    int shift = 0;
+    if(suffix == "K" || suffix == "k") shift = 10;
+    else if(suffix == "M" || suffix == "m") shift = 20;
+    else if(suffix == "G" || suffix == "g") shift = 30;
+    else if(!suffix.empty()) return false;
+    if(n > (LLONG_MAX >> shift) || n < (LLONG_MIN >> shift)) return false;
+    out = n * (1ll << shift);
+    return true;
+}
+
+bool parse_bool(string_view value, bool& out) {
+    if(value == "true" || value == "on" || value == "yes" || value == "1") out = true;
+    else if(value == "false" || value == "off" || value == "no" || value == "0") out = false;
+    else return false;
+    return true;
+}
+
+bool set_field(Field field, long long min, long long max, string_view key, string_view value, string& error) {
+    bool ok = std::visit([&](auto* field) {
+        using T = std::remove_pointer_t<decltype(field)>;
+        if constexpr(std::is_same_v<T, string>) {
+            *field = value;
+            return true;
+        } else if constexpr(std::is_same_v<T, bool>) {
+            return parse_bool(value, *field);
+        } else if constexpr(std::is_same_v<T, DispatchPolicy>) {
+            *field = parse_dispatch_policy(value);
+            return value == dispatch_policy_name(*field);
+        } else if constexpr(std::is_same_v<T, ConcurrencyLimiter::Algorithm>) {
+            if(value == "gradient") *field = ConcurrencyLimiter::Algorithm::gradient;
+            else if(value == "aimd") *field = ConcurrencyLimiter::Algorithm::aimd;
+            else return false;
+            return true;
+        } else {
+            long long n = 0;
+            if(!parse_number(value, n) || n < min || n > max) return false;
+            *field = static_cast<T>(n);
+            return true;
+        }
+    }, field);
+    if(!ok) {
+        error = "invalid value '" + string(value) + "' for " + string(key);
+    }
+    return ok;
+}
+
+// vhost.<主机名>.<键>：主机名中可以有点，取最后一个点之后的部分为键
+bool set_vhost_option(ServerConfig& config, string_view key, string_view value, string& error) {
+    const string_view rest = key.substr(6);
+    const size_t dot = rest.rfind('.');
+    const VhostOption* option = nullptr;
+    if(dot != string_view::npos && dot > 0) {
+        for(const VhostOption& candidate : kVhostOptions) {
+            if(candidate.key == rest.substr(dot + 1)) option = &candidate;
+        }
+    }
+    if(!option) {
+        error = "unknown key " + string(key);
+        return false;
+    }
+    string name(rest.substr(0, dot));
+    for(char& c : name) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    auto it = std::find_if(config.vhosts.begin(), config.vhosts.end(),
+                           [&name](const VhostConfig& vhost) { return vhost.name == name; });
+    if(it == config.vhosts.end()) {
+        config.vhosts.emplace_back().name = std::move(name);
+        it = config.vhosts.end() - 1;
+    }
+    return set_field(option->field(*it), option->min, option->max, key, value, error);
+}
+
+bool set_option(ServerConfig& config, string_view key, string_view value, string& error) {
+    if(key.starts_with("vhost.")) {
+        return set_vhost_option(config, key, value, error);
+    }
+    const Option* option = find_option(key);
+    if(!option) {
+        error = "unknown key " + string(key);
+        return false;
+    }
+    return set_field(option->field(config), option->min, option->max, key, value, error);
+}
+
+string format_field(Field field, string_view key) {
+    return std::visit([&](auto* field) -> string {
+        using T = std::remove_pointer_t<decltype(field)>;
+        if constexpr(std::is_same_v<T, string>) {
+            // 日志里不出现密码
+            return key.ends_with("password") && !field->empty() ? "***" : *field;
+        } else if constexpr(std::is_same_v<T, bool>) {
+            return *field ? "true" : "false";
+        } else if constexpr(std::is_same_v<T, DispatchPolicy>) {
+            return dispatch_policy_name(*field);
+        } else if constexpr(std::is_same_v<T, ConcurrencyLimiter::Algorithm>) {
+            return *field == ConcurrencyLimiter::Algorithm::aimd ? "aimd" : "gradient";
+        } else {
+            return std::to_string(*field);
+        }
+    }, field);
+}
+
+string format_option(const Option& option, ServerConfig& config) {
+    return format_field(option.field(config), option.key);
+}
+
+// 一个虚拟主机的全部设置写成一行，用于比较和日志
+string format_vhost(VhostConfig vhost) {
+    string out;
+    for(const VhostOption& option : kVhostOptions) {
+        if(!out.empty()) out += ' ';
+        out += option.key;
+        out += '=';
+        out += format_field(option.field(vhost), option.key);
+    }
+    return out;
+}
+
+// 类型映射写作 .后缀=类型，以空白分隔；后缀不区分大小写，长度不超过 kMaxSuffix
+bool valid_mime_list(string_view list) {
+    size_t pos = 0;
+    while((pos = list.find_first_not_of(" \t", pos)) != string_view::npos) {
+        const size_t end = std::min(list.find_first_of(" \t", pos), list.size());
+        const string_view item = list.substr(pos, end - pos);
+        const size_t eq = item.find('=');
+        if(item[0] != '.' || eq == string_view::npos || eq < 2 || eq > kMaxSuffix || eq + 1 == item.size()) {
+            return false;
+        }
+        pos = end;
+    }
+    return true;
+}
+
+bool read_file(ServerConfig& config, const string& path, string& error) {
+    std::ifstream in(path);
+    if(!in) {
+        error = path + ": " + strerror(errno);
+        return false;
+    }
+    string line;
+    string section;
+    for(int lineno = 1; std::getline(in, line); ++lineno) {
+        const string where = path + ":" + std::to_string(lineno) + ": ";
+        string_view s = trim(line);
+        if(s.empty() || s[0] == '#' || s[0] == ';') continue;
+        if(s[0] == '[') {
+            if(s.back() != ']') {
+                error = where + "unterminated section";
+                return false;
+            }
+            section = trim(s.substr(1, s.size() - 2));
+            continue;
+        }
+        const size_t eq = s.find('=');
+        if(eq == string_view::npos) {
+            error = where + "expected key = value";
+            return false;
+        }
+        string key = section.empty() ? string() : section + ".";
+        key += trim(s.substr(0, eq));
+        string_view value = trim(s.substr(eq + 1));
+        if(!value.empty() && value[0] == '"') {
+            // 带引号的值原样保留，其中可以有 # 和空格
+            const size_t close = value.find('"', 1);
+            const string_view rest = close == string_view::npos ? string_view() : trim(value.substr(close + 1));
+            if(close == string_view::npos || !(rest.empty() || rest[0] == '#' || rest[0] == ';')) {
+                error = where + "bad quoted value";
+                return false;
+            }
+            value = value.substr(1, close - 1);
+        } else {
+            // 行尾注释前面要有空白
+            const size_t comment = value.find_first_of("#;");
+            if(comment != string_view::npos && comment > 0 && (value[comment - 1] == ' ' || value[comment - 1] == '\t')) {
+                value = trim(value.substr(0, comment));
+            }
+        }
+        if(!set_option(config, key, value, error)) {
+            error = where + error;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool validate(const ServerConfig& config, string& error) {
+    for(const string* cpus : { &config.main_cpus, &config.io_cpus, &config.log_cpus }) {
+        if(!cpus->empty() && parse_cpu_list(*cpus).empty()) {
+            error = "invalid cpu list '" + *cpus + "'";
+            return false;
+        }
+    }
+    if(config.min_concurrency > config.max_concurrency ||
+       config.initial_concurrency < config.min_concurrency || config.initial_concurrency > config.max_concurrency) {
+        error = "limit.initial_concurrency must be within [min_concurrency, max_concurrency]";
+        return false;
+    }
+    if(!config.upload_prefix.empty() && (config.upload_prefix.front() != '/' || config.upload_prefix.back() != '/')) {
+        error = "http.upload_prefix must start and end with /";
+        return false;
+    }
+    if(config.tls_cert.empty() != config.tls_key.empty()) {
+        error = "tls.cert_file and tls.key_file must be set together";
+        return false;
+    }
+    if(!valid_mime_list(config.default_host.mime)) {
+        error = "http.mime must be a list of .suffix=type";
+        return false;
+    }
+    for(const VhostConfig& vhost : config.vhosts) {
+        if(vhost.root.empty()) {
+            error = "vhost." + vhost.name + ".root is required";
+            return false;
+        }
+        if(!valid_mime_list(vhost.mime)) {
+            error = "vhost." + vhost.name + ".mime must be a list of .suffix=type";
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+bool parse_config_args(int argc, char* argv[], ServerConfig& config, std::string& error) {
+    config.args.assign(argv, argv + argc);
+    config.file.clear();
+    config.overrides.clear();
+    for(int i = 1; i < argc; ++i) {
+        const string_view arg = argv[i];
+        if(arg == "-c") {
+            if(i + 1 == argc) {
+                error = "-c requires a file";
+                return false;
+            }
+            config.file = argv[++i];
+        } else if(arg.starts_with("--") && arg.find('=') != string_view::npos) {
+            config.overrides.emplace_back(arg.substr(2));
+        } else {
+            error = "unknown argument " + string(arg);
+            return false;
+        }
+    }
+    return load_config(config, error);
+}
+
+bool load_config(ServerConfig& config, std::string& error) {
+    ServerConfig fresh;
+    fresh.file = config.file;
+    fresh.overrides = config.overrides;
+    fresh.args = config.args;
+    if(!fresh.file.empty() && !read_file(fresh, fresh.file, error)) {
+        return false;
+    }
+    for(const string& item : fresh.overrides) {
+        const size_t eq = item.find('=');
+        if(!set_option(fresh, string_view(item).substr(0, eq), string_view(item).substr(eq + 1), error)) {
+            error = "--" + item + ": " + error;
+            return false;
+        }
+    }
+    if(!validate(fresh, error)) {
+        return false;
+    }
+    config = std::move(fresh);
+    return true;
+}
+
+std::vector<ConfigChange> diff_config(const ServerConfig& from, const ServerConfig& to) {
+    // 取值只读，拷贝一份以便复用按非 const 引用取成员的表
+    ServerConfig a = from;
+    ServerConfig b = to;
+    std::vector<ConfigChange> changes;
+    for(const Option& option : kOptions) {
+        string old_value = format_option(option, a);
+        string new_value = format_option(option, b);
+        // 密码都显示为 ***，直接比较原值
+        const bool changed = old_value != new_value ||
+            (option.key.ends_with("password") && *std::get<string*>(option.field(a)) != *std::get<string*>(option.field(b)));
+        if(changed) {
+            changes.push_back({ string(option.key), std::move(old_value), std::move(new_value), option.reloadable });
+        }
+    }
+    // 虚拟主机只在启动时读取，按主机名比较整节
+    auto describe = [](const std::vector<VhostConfig>& vhosts, const string& name) {
+        for(const VhostConfig& vhost : vhosts) {
+            if(vhost.name == name) return format_vhost(vhost);
+        }
+        return string("(none)");
+    };
+    std::vector<string> names;
+    for(const auto* vhosts : { &from.vhosts, &to.vhosts }) {
+        for(const VhostConfig& vhost : *vhosts) {
+            if(std::find(names.begin(), names.end(), vhost.name) == names.end()) names.push_back(vhost.name);
+        }
+    }
+    for(const string& name : names) {
+        string old_value = describe(from.vhosts, name);
+        string new_value = describe(to.vhosts, name);
+        if(old_value != new_value) {
+            changes.push_back({ "vhost." + name, std::move(old_value), std::move(new_value), false });
+        }
+    }
+    return changes;
+}
+
+void print_config_usage(FILE* out, const char* program) {
+    fprintf(out, "usage: %s [-c config.ini] [--section.key=value ...]\n\n", program);
+    fprintf(out, "keys (default, * = reloaded on SIGHUP):\n");
+    ServerConfig defaults;
+    for(const Option& option : kOptions) {
+        fprintf(out, "  %c %-28.*s %s\n", option.reloadable ? '*' : ' ', static_cast<int>(option.key.size()),
+                option.key.data(), format_option(option, defaults).c_str());
+    }
+    fprintf(out, "\nvirtual hosts, one [vhost.<host>] section each (root is required):\n");
+    VhostConfig vhost;
+    for(const VhostOption& option : kVhostOptions) {
+        const string key = "vhost.<host>." + string(option.key);
+        fprintf(out, "    %-32s %s\n", key.c_str(), format_field(option.field(vhost), option.key).c_str());
+    }
+}
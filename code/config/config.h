@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../event/loopbalancer.h"
+#include "../limiter/concurrencylimiter.h"
+#include "runtime.h"
+
+// 一个站点的设置。[http] 中的同名键为默认站点，Host 头不匹配任何虚拟主机时使用；
+// 虚拟主机写作 [vhost.<主机名>] 一节（命令行 --vhost.<主机名>.<键>=值），root 必填
+struct VhostConfig {
+    std::string name;                       // 主机名，小写，不含端口；默认站点为空
+    std::string aliases;                    // 其他主机名，空格分隔
+    std::string root;                       // 文档根目录；默认站点为空时取 ./resources/
+    std::string mime;                       // 追加或覆盖的类型，如 ".md=text/markdown .wasm=application/wasm"
+    std::string cache_control;              // 静态文件 200 响应的 Cache-Control 值，为空不发
+    size_t file_cache = 16 << 20;           // 本站点文件缓存的内存上限，0 不缓存
+    size_t file_cache_max_file = 256 << 10; // 超过该大小的文件不进缓存
+};
+
+// 服务器的全部设置，默认值即不带配置文件启动时的行为
+// 配置文件为 INI 格式，键名为 节.键（如 [server] 下的 port 即 server.port），命令行的 --节.键=值 覆盖文件
+// runtime 中的设置在收到 SIGHUP 时重新读取并生效，其余只在启动（或 SIGUSR2 热重启）时读取
+struct ServerConfig {
+    // [server]
+    int port = 2316;
+    int trig_mode = 3;                      // 0 都是 LT，1 连接 ET，2 监听 ET，3 都是 ET
+    bool linger = false;                    // 关闭连接时等待未发送的数据
+    int backlog = 1024;                     // listen 的全连接队列长度
+    int threads = 6;                        // IO 循环数
+    DispatchPolicy dispatch = DispatchPolicy::p2c;
+    int stall_ms = 200;                     // 事件循环单轮超过该毫秒数视为卡顿，0 关闭看门狗
+    std::string main_cpus;                  // 绑核，写法同 taskset -c，为空不绑定
+    std::string io_cpus;
+    std::string log_cpus;
+    bool incoming_cpu = false;
+
+    // [mysql]
+    std::string sql_host = "localhost";
+    int sql_port = 3306;
+    std::string sql_user = "root";
+    std::string sql_password = "root";
+    std::string sql_database = "webserver";
+    int sql_pool = 12;
+
+    // [log]
+    bool log_enable = true;
+    std::string log_dir = "./log";
+    int log_queue = 1024;                   // 异步队列容量，0 为同步写
+
+    // [http]
+    std::string upload_prefix;              // 为空不开放上传，如 /upload/
+    std::string upload_dir = "./upload/";
+    size_t upload_limit = 1ull << 30;
+    VhostConfig default_host;
+    std::vector<VhostConfig> vhosts;        // 按配置中首次出现的顺序
+
+    // [limit]
+    size_t limit_capacity = 1 << 20;        // 限流表的槽数
+    ConcurrencyLimiter::Algorithm concurrency = ConcurrencyLimiter::Algorithm::gradient;
+    int min_concurrency = 8;
+    int max_concurrency = 1000;
+    int initial_concurrency = 100;
+
+    // [tls]
+    std::string tls_cert;
+    std::string tls_key;
+    std::string tls_ticket_key;
+
+    RuntimeConfig runtime;
+
+    // 来源：重新加载时再读一遍同一个文件、再应用同样的覆盖
+    std::string file;
+    std::vector<std::string> overrides;     // 节.键=值
+    std::vector<std::string> args;          // 原始命令行，热重启时原样传给新进程
+};
+
+struct ConfigChange {
+    std::string key;
+    std::string from;
+    std::string to;
+    bool reloadable;
+};
+
+// 解析命令行：-c 文件、--节.键=值；出错时返回 false，error 中为原因
+bool parse_config_args(int argc, char* argv[], ServerConfig& config, std::string& error);
+
+// 从默认值开始，按 config.file 和 config.overrides 重新读取
+bool load_config(ServerConfig& config, std::string& error);
+
+// 取值不同的键，按配置项的顺序
+std::vector<ConfigChange> diff_config(const ServerConfig& from, const ServerConfig& to);
+
+// 列出所有键及其默认值
+void print_config_usage(FILE* out, const char* program);
@@ -0,0 +1,41 @@
+#include "runtime.h"
+#include <atomic>
+#include <mutex>
+
+namespace {
+
+std::mutex g_mutex;
+std::shared_ptr<const RuntimeConfig> g_current = std::make_shared<const RuntimeConfig>();
+std::atomic<uint64_t> g_generation{1};
+
+struct LocalSnapshot {
+    std::shared_ptr<const RuntimeConfig> config;
+    uint64_t generation = 0;
+};
+
+thread_local LocalSnapshot t_local;
+
+}  // namespace
+
+void RuntimeConfig::publish(std::shared_ptr<const RuntimeConfig> config) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_current = std::move(config);
+    g_generation.fetch_add(1, std::memory_order_release);
+}
+
+const RuntimeConfig& RuntimeConfig::local() {
+    if(!t_local.config) {
+        refresh();
+    }
+    return *t_local.config;
+}
+
+void RuntimeConfig::refresh() {
+    if(g_generation.load(std::memory_order_acquire) == t_local.generation) {
+        return;
+    }
+    // 只有发布之后的第一次 refresh 才加锁，旧快照的引用计数在这里减掉
+    std::lock_guard<std::mutex> lock(g_mutex);
+    t_local.config = g_current;
+    t_local.generation = g_generation.load(std::memory_order_relaxed);
+}
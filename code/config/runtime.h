@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// 运行中可以重新加载（SIGHUP）的设置，发布后只读
+// 读写方式类似 RCU：新快照整体替换旧快照，每个线程持有自己读到的那一份，
+// 事件循环每轮开始时 refresh 一次，一轮之内读到的值不会变；旧快照在最后一个线程切换后释放
+struct RuntimeConfig {
+    int log_level = 1;
+    int timeout_ms = 60000;                 // 连接空闲超时，0 表示不超时（各阶段的时限仍按各自的设置）
+    size_t io_budget = 256 << 10;           // ET 下每个连接每轮事件循环最多读、写的字节数
+    size_t max_body_size = 1 << 20;         // 缓存在内存中的请求正文上限，超过回 413
+    size_t read_high_water = 256 << 10;     // 读缓冲区积压到该值时停止读取
+    size_t write_high_water = 256 << 10;    // 待发送的数据到该值时停止读取、暂停流式响应
+    size_t write_low_water = 64 << 10;      // 降到该值时恢复
+    size_t output_budget = 512 << 20;       // 所有连接的写缓冲块合计上限，超过时流式响应收缩到低水位、驱逐不读的客户端；0 表示不限
+    size_t block_cache = 1024;              // 每个线程缓存的空闲 16K 块数
+    int keepalive_timeout_ms = 15000;       // 两个请求之间的空闲超时，timeout_ms 为 0 时不生效
+    uint32_t keepalive_requests = 1000;     // 一条连接上最多处理的请求数，0 表示不限
+    // 按阶段的时限，0 表示该阶段也按 timeout_ms 计空闲；与 timeout_ms 都为 0 时该阶段不限时
+    int first_byte_timeout_ms = 10000;      // 建立连接（含 TLS 握手）到第一个请求的首字节
+    int header_timeout_ms = 20000;          // 请求首字节到头部收完，不因收到数据而顺延
+    int body_timeout_ms = 20000;            // 正文两次到达之间的最长间隔
+    uint32_t min_body_rate = 500;           // 正文的最低平均速率（字节/秒），按正文开始时刻加 body_timeout_ms 起算；0 不限
+
+    // 按客户端地址限流，见 RateLimiter；0 表示不限
+    uint32_t max_conns = 1024;
+    uint32_t static_rate = 0;
+    uint32_t static_burst = 1;
+    uint32_t dynamic_rate = 20;
+    uint32_t dynamic_burst = 40;
+
+    // 有任何一项连接时限，连接建立时就挂上定时器；全为 0 时不挂，运行中在两者间切换需要重启
+    bool timed() const {
+        return timeout_ms > 0 || first_byte_timeout_ms > 0 || header_timeout_ms > 0 || body_timeout_ms > 0;
+    }
+
+    // 发布新的快照，各线程在下一次 refresh 时切换
+    static void publish(std::shared_ptr<const RuntimeConfig> config);
+
+    // 当前线程持有的快照；第一次调用时取最新发布的一份
+    static const RuntimeConfig& local();
+
+    // 切换到最新发布的快照；没有新发布时只是一次原子读
+    // 之后不能再使用之前 local() 返回的引用，只在事件循环的两轮之间调用
+    static void refresh();
+};
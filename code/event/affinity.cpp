@@ -0,0 +1,69 @@
+#include "affinity.h"
+#include <charconv>
+#include <cstdio>
+#include <sched.h>
+#include <sys/socket.h>
+
+std::vector<int> parse_cpu_list(std::string_view list) {
+    std::vector<int> cpus;
+    while(!list.empty()) {
+        size_t comma = list.find(',');
+        std::string_view item = list.substr(0, comma);
+        list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+
+        int first = -1, last = -1;
+        auto [p, ec] = std::from_chars(item.data(), item.data() + item.size(), first);
+        if(ec != std::errc() || first < 0) continue;
+        last = first;
+        if(p < item.data() + item.size() && *p == '-') {
+            auto res = std::from_chars(p + 1, item.data() + item.size(), last);
+            if(res.ec != std::errc() || last < first) continue;
+        }
+        for(int cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+std::string format_cpu_list(const std::vector<int>& cpus) {
+    std::string res;
+    for(int cpu : cpus) {
+        if(!res.empty()) res += ',';
+        res += std::to_string(cpu);
+    }
+    return res.empty() ? "-" : res;
+}
+
+bool pin_thread(pthread_t thread, const std::vector<int>& cpus) {
+    if(cpus.empty()) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for(int cpu : cpus) CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+}
+
+int cpu_node(int cpu) {
+    // /sys/devices/system/cpu/cpuN/ 下有一个 nodeM 链接；这里读 node 的 cpulist 反查，避免遍历目录
+    for(int node = 0; node < 64; ++node) {
+        char path[96];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        FILE* fp = fopen(path, "r");
+        if(!fp) break;
+        char buf[256] = {0};
+        size_t n = fread(buf, 1, sizeof(buf) - 1, fp);
+        fclose(fp);
+        while(n > 0 && (buf[n - 1] == '\n' || buf[n - 1] == ' ')) --n;
+        for(int c : parse_cpu_list(std::string_view(buf, n))) {
+            if(c == cpu) return node;
+        }
+    }
+    return 0;
+}
+
+int incoming_cpu(int fd) {
+    int cpu = -1;
+    socklen_t len = sizeof(cpu);
+    if(getsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) < 0) return -1;
+    return cpu;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <pthread.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 线程绑核配置，CPU 列表写法与 taskset -c 相同，如 "0-3,8,10-11"；列表为空表示不绑定
+struct CpuPlacement {
+    std::vector<int> main_cpus;     // 主循环（accept、定时器）
+    std::vector<int> io_cpus;       // IO 循环，第 i 个循环绑到 io_cpus[i % n] 上的单个核
+    std::vector<int> log_cpus;      // 异步日志写线程
+    bool incoming_cpu = false;      // 按 SO_INCOMING_CPU 把连接交给处理其网卡队列的核上的 IO 循环
+};
+
+std::vector<int> parse_cpu_list(std::string_view list);
+std::string format_cpu_list(const std::vector<int>& cpus);
+
+// 绑定成功返回 true；列表为空时什么也不做，返回 false
+bool pin_thread(pthread_t thread, const std::vector<int>& cpus);
+
+// CPU 所在的 NUMA 节点，读不到 sysfs 时返回 0
+int cpu_node(int cpu);
+
+// 连接最近一次被哪个核的软中断处理，取不到时返回 -1
+int incoming_cpu(int fd);
@@ -12,28 +12,32 @@ void Channel::remove() {
     loop_->remove_channel(this);
 }
 
+void Channel::queue_ready(uint32_t revents) {
+    loop_->queue_ready(fd_, revents);
+}
+
 void Channel::handle_event() {
-    if ((events_ & EPOLLHUP) && !(events_ & EPOLLIN)) {
+    // 按就绪的事件分派，而不是按注册的事件：同时关注读写时，只可读不会去调写回调
+    const uint32_t revents = revents_;
+    if ((revents & EPOLLHUP) && !(revents & EPOLLIN)) {
         if(close_callback_) close_callback_();
-        events_ = 0;
         return;
     }
-    if (events_ & EPOLLERR) {
+    if (revents & EPOLLERR) {
         if(error_callback_) error_callback_();
-        events_ = 0;
         return;
     } 
     //触发可读事件 | 高优先级可读 | 对端（客户端）关闭连接
-    if (events_ & (EPOLLIN | EPOLLPRI | EPOLLRDHUP)) 
+    if (revents & (EPOLLIN | EPOLLPRI | EPOLLRDHUP)) 
         if(read_callback_) 
             read_callback_();
-    if (events_ & EPOLLOUT) 
+    if (revents & EPOLLOUT) 
         if(write_callback_) 
             write_callback_();
 
     if(update_callback_) 
         update_callback_();
-    LOG_DEBUG("Handle event on %d", events_);
+    LOG_DEBUG("Handle event on %d", revents);
 }
 
     
\ No newline at end of file
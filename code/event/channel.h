@@ -29,6 +29,8 @@ public:
     
     int& events() { return events_; }
     void set_events(int events) { events_ = events; }
+    // epoll_wait 返回的就绪事件，handle_event 按它分派
+    void set_revents(uint32_t revents) { revents_ = revents; }
     
     void update();
     void remove(); 
@@ -36,11 +38,18 @@ public:
     void disable_all() { events_ = 0; update(); }
     void enable_reading() { events_ |= EPOLLIN; update(); }
     void enable_writing() { events_ |= EPOLLOUT; update(); }
+    void disable_reading() { events_ &= ~EPOLLIN; update(); }
+    void disable_writing() { events_ &= ~EPOLLOUT; update(); }
+    bool is_reading() const { return events_ & EPOLLIN; }
+
+    // 放进所属循环的就绪队列，本轮 epoll 事件处理完后按 revents 再分派一次；只在所属循环的线程中调用
+    void queue_ready(uint32_t revents);
 
 private:
     EventLoop* loop_;
     int fd_;
     int events_;
+    uint32_t revents_ = 0;
     
     EventCallback read_callback_;
     EventCallback write_callback_;
@@ -1,7 +1,7 @@
 //epoller.cpp
 #include "epoller.h"
 
-Epoller::Epoller(int max_events) : epoll_fd_(epoll_create(512)), events_(max_events) {}
+Epoller::Epoller(int max_events) : epoll_fd_(epoll_create1(EPOLL_CLOEXEC)), events_(max_events) {}
 
 Epoller::~Epoller() {
     close(epoll_fd_);
@@ -4,8 +4,16 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <iostream>
+#include <cassert>
+#include "../config/runtime.h"
 
 
+static thread_local EventLoop* t_loop_in_this_thread = nullptr;
+
+EventLoop* EventLoop::current() {
+    return t_loop_in_this_thread;
+}
+
 // 创建eventfd用于线程间通知
 int EventLoop::create_eventfd() {
     return eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
@@ -18,8 +26,13 @@ EventLoop::EventLoop()
       wakeup_channel_(new Channel(this, wakeup_fd_)),
       quit_(false),
       thread_id_(std::this_thread::get_id()),
-      calling_pending_functors_(false){
+      calling_pending_functors_(false),
+      metrics_(Metrics::instance()->register_loop()) {
     
+    // EventLoop 总在其所属线程中构造，此后该线程上的计数都记到本循环名下
+    LoopMetrics::bind(metrics_);
+    t_loop_in_this_thread = this;
+
     // 设置唤醒通道的回调
     wakeup_channel_->set_events(EPOLLIN | EPOLLET);
     wakeup_channel_->set_read_callback(std::bind(&EventLoop::handle_wakeup, this));
@@ -29,28 +42,98 @@ EventLoop::EventLoop()
 
 EventLoop::~EventLoop() {
     quit_ = true;
+    if (t_loop_in_this_thread == this) t_loop_in_this_thread = nullptr;
     close(wakeup_fd_);
 }
 
-void EventLoop::loop(HeapTimer* timer, int timeout) {
+void EventLoop::loop(int timeout) {
     quit_ = false;
+    LoopMetrics::bind(metrics_);
     int time_ms = -1;
+    uint64_t now = metrics_now_ns();
+    uint64_t window_busy = 0, window_total = 0;
     while (!quit_) {
-        if(timer != nullptr) time_ms = timer->get_next_tick();
-        else time_ms = timeout;
-        int num_events = epoller_->wait(time_ms);
+        // 每轮的耗时拆成 定时器 / epoll_wait / 回调 / 待处理任务 四段，
+        // 不在 epoll_wait 中时 busy_since 非零，供 watchdog 发现卡住的循环
+        const uint64_t start = now;
+        metrics_->busy_since.store(start, std::memory_order_relaxed);
+        // 两轮之间没有回调持有配置快照的引用，在这里切换到 SIGHUP 后发布的新快照
+        RuntimeConfig::refresh();
+        metrics_->mark(TraceStage::timer, -1);
+        time_ms = timer_.get_next_tick();
+        if(time_ms < 0 || time_ms > timeout) time_ms = timeout;
+        now = metrics_now_ns();
+        metrics_->timer_ns.add(now - start);
+        metrics_->note_callback(now - start);
+
+        metrics_->mark(TraceStage::idle, -1);
+        metrics_->busy_since.store(0, std::memory_order_relaxed);
+        const uint64_t wait_start = now;
+        int num_events = epoller_->wait(ready_.empty() ? time_ms : 0);
+        now = metrics_now_ns();
+        const uint64_t polled = now - wait_start;
+        metrics_->busy_since.store(now, std::memory_order_relaxed);
+        metrics_->poll_ns.add(polled);
+        metrics_->wakeups.add();
+        if (num_events > 0) metrics_->epoll_events.add(num_events);
         
         for (int i = 0; i < num_events; ++i) {
-            int fd = epoller_->get_event_fd(i);
-            std::lock_guard<std::mutex> lock(mutex_);            
-            auto it = channels_.find(fd);
-            if (it != channels_.end()) {
-                it->second->handle_event();
+            if (Channel* channel = find_channel_(epoller_->get_event_fd(i))) {
+                dispatch_(channel, epoller_->get_events(i), now);
             }
         }
+        // 上一轮和本轮事件中用完预算的连接排在新事件之后，每轮最多再得到一份预算
+        run_ready_(now);
         
         do_pending_functors();
+        now = metrics_now_ns();
+        metrics_->busy.record(now - start - polled);
+
+        // 每 10ms 更新一次忙碌度，按 1/4 的权重平滑
+        window_busy += now - start - polled;
+        window_total += now - start;
+        if (window_total >= 10000000) {
+            const uint32_t sample = window_busy * 1000 / window_total;
+            const uint32_t prev = load_.busy_permille.load(std::memory_order_relaxed);
+            load_.busy_permille.store((prev * 3 + sample) / 4, std::memory_order_relaxed);
+            window_busy = window_total = 0;
+        }
+    }
+    metrics_->busy_since.store(0, std::memory_order_relaxed);
+}
+
+Channel* EventLoop::find_channel_(int fd) {
+    // 回调里可能 queue_in_loop，不能持有任务队列的锁
+    std::lock_guard<std::mutex> lock(mutex_channel_);
+    auto it = channels_.find(fd);
+    return it != channels_.end() ? it->second : nullptr;
+}
+
+void EventLoop::dispatch_(Channel* channel, uint32_t revents, uint64_t& now) {
+    metrics_->mark(TraceStage::event, channel->fd());
+    channel->set_revents(revents);
+    channel->handle_event();
+    const uint64_t end = metrics_now_ns();
+    metrics_->callback_ns.add(end - now);
+    metrics_->note_callback(end - now);
+    now = end;
+}
+
+void EventLoop::queue_ready(int fd, uint32_t revents) {
+    assert(is_in_loop_thread());
+    metrics_->requeued.add();
+    ready_.emplace_back(fd, revents);
+}
+
+void EventLoop::run_ready_(uint64_t& now) {
+    // 分派中再次入队的留到下一轮
+    running_ready_.swap(ready_);
+    for (const auto& [fd, revents] : running_ready_) {
+        if (Channel* channel = find_channel_(fd)) {
+            dispatch_(channel, revents, now);
+        }
     }
+    running_ready_.clear();
 }
 
 void EventLoop::quit() {
@@ -105,8 +188,16 @@ void EventLoop::do_pending_functors() {
         functors.swap(pending_functors_);
     }
     
+    metrics_->functor_depth.set(functors.size());
+    metrics_->functors.add(functors.size());
+    uint64_t now = metrics_now_ns();
     for (const auto& functor : functors) {
+        metrics_->mark(TraceStage::functor, -1);
         functor();
+        const uint64_t end = metrics_now_ns();
+        metrics_->functor_ns.add(end - now);
+        metrics_->note_callback(end - now);
+        now = end;
     }
     
     calling_pending_functors_ = false;
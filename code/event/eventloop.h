@@ -10,6 +10,8 @@
 #include <unordered_map>
 #include "channel.h"
 #include "../timer/heaptimer.h"
+#include "../metrics/metrics.h"
+#include "loopbalancer.h"
 
 struct Channel;
 
@@ -19,7 +21,8 @@ public:
     EventLoop();
     ~EventLoop();
     
-    void loop(HeapTimer* timer = nullptr, int timeout_ms = 10000);
+    // 没有定时器到期时 epoll_wait 最多等 timeout_ms
+    void loop(int timeout_ms = 10000);
     void quit();
     
     bool is_in_loop_thread() const { 
@@ -38,6 +41,19 @@ public:
     void remove_channel(Channel* channel);
     void modify_channel(Channel* channel);
 
+    // 就绪队列：ET 下因预算用完而没读到、没写到 EAGAIN 的连接不会再收到新的边沿通知，
+    // 放在这里等本轮的 epoll 事件都处理完后再分派一次；队列非空时 epoll_wait 不阻塞
+    void queue_ready(int fd, uint32_t revents);
+
+    // 本循环的定时器，只能在循环线程中使用；每轮开始时处理到期的
+    HeapTimer& timer() { return timer_; }
+
+    LoopMetrics* metrics() const { return metrics_; }
+    LoopLoad& load() { return load_; }
+
+    // 当前线程所属的 EventLoop，没有则为 nullptr
+    static EventLoop* current();
+
 private:
     static int create_eventfd();
     // 处理唤醒事件
@@ -46,6 +62,10 @@ private:
     
     // 执行待处理任务
     void do_pending_functors();
+
+    Channel* find_channel_(int fd);
+    void dispatch_(Channel* channel, uint32_t revents, uint64_t& now);
+    void run_ready_(uint64_t& now);
     
     std::unique_ptr<Epoller> epoller_;            // IO复用
     int wakeup_fd_;                              // 唤醒fd
@@ -61,5 +81,15 @@ private:
     
     // 通道映射表
     std::unordered_map<int, Channel*> channels_;
+
+    // 按 fd 记录，分派时再查通道，期间被移除的自然跳过
+    std::vector<std::pair<int, uint32_t>> ready_;
+    std::vector<std::pair<int, uint32_t>> running_ready_;
+
+    HeapTimer timer_;
+
+    LoopMetrics* metrics_;                       // 本循环的运行指标
+    LoopLoad load_;                              // 供 acceptor 分配连接时参考的负载
+
 };
 
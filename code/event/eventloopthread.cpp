@@ -1,5 +1,6 @@
 //eventloopthread.cpp
 #include "eventloopthread.h"
+#include "affinity.h"
 
 EventLoopThread::EventLoopThread()
     : loop_(nullptr),
@@ -16,8 +17,8 @@ EventLoopThread::~EventLoopThread() {
     }
 }
 
-EventLoop* EventLoopThread::start_loop() {
-    thread_ = std::thread(&EventLoopThread::work, this);
+EventLoop* EventLoopThread::start_loop(int cpu) {
+    thread_ = std::thread(&EventLoopThread::work, this, cpu);
     {
         std::unique_lock<std::mutex> lock(mutex_);
         while (loop_ == nullptr) {
@@ -28,7 +29,10 @@ EventLoop* EventLoopThread::start_loop() {
     return loop_;
 }
 
-void EventLoopThread::work() {
+void EventLoopThread::work(int cpu) {
+    // 先绑核：此后本线程首次写入的页（EventLoop、epoll 事件数组、BlockPool 的缓冲块）
+    // 按默认的首次访问策略分配在该核所在的 NUMA 节点上
+    if(cpu >= 0) pin_thread(pthread_self(), {cpu});
     EventLoop loop;
     
     {
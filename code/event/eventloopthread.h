@@ -7,12 +7,12 @@ public:
     EventLoopThread();
     ~EventLoopThread();
     
-    // 启动事件循环线程
-    EventLoop* start_loop();
+    // 启动事件循环线程，cpu >= 0 时先绑核再构造 EventLoop
+    EventLoop* start_loop(int cpu = -1);
 
 private:
     // 线程函数
-    void work();
+    void work(int cpu);
     
     EventLoop* loop_;        // 事件循环
     bool exiting_;           // 是否退出
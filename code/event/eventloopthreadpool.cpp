@@ -1,11 +1,17 @@
 //eventloopthreadpoo.cpp
 #include "eventloopthreadpool.h"
+#include "affinity.h"
+#include <algorithm>
+#include <unistd.h>
 
-EventLoopThreadPool::EventLoopThreadPool(EventLoop* base_loop, int thread_num)
+EventLoopThreadPool::EventLoopThreadPool(EventLoop* base_loop, int thread_num, std::vector<int> cpus,
+                                         DispatchPolicy policy)
     : base_loop_(base_loop),
       started_(false),
       thread_num_(thread_num),
-      next_loop_(0) {
+      next_loop_(0),
+      cpus_(std::move(cpus)),
+      policy_(policy) {
         threads_.reserve(thread_num);
         loops_.reserve(thread_num);
 }
@@ -15,9 +21,35 @@ void EventLoopThreadPool::start() {
     
     for (int i = 0; i < thread_num_; ++i) {
         auto t = std::make_unique<EventLoopThread>();
-        loops_.push_back(t->start_loop());
+        int cpu = cpus_.empty() ? -1 : cpus_[i % cpus_.size()];
+        loops_.push_back(t->start_loop(cpu));
         threads_.push_back(std::move(t));
     }
+
+    std::vector<const LoopLoad*> loads;
+    for (EventLoop* loop : loops_) loads.push_back(&loop->load());
+    if (loads.empty()) loads.push_back(&base_loop_->load());
+    balancer_ = std::make_unique<LoopBalancer>(policy_, std::move(loads));
+
+    if (cpus_.empty() || loops_.empty()) return;
+    // 预先算好每个核就近的循环：同核优先，其次同一 NUMA 节点
+    const int max_cpu = *std::max_element(cpus_.begin(), cpus_.end());
+    loops_by_cpu_.resize(std::max<int>(max_cpu + 1, sysconf(_SC_NPROCESSORS_CONF)));
+    std::vector<int> loop_node(thread_num_);
+    for (int i = 0; i < thread_num_; ++i) {
+        loop_node[i] = cpu_node(cpus_[i % cpus_.size()]);
+    }
+    for (int cpu = 0; cpu < static_cast<int>(loops_by_cpu_.size()); ++cpu) {
+        auto& near = loops_by_cpu_[cpu];
+        for (int i = 0; i < thread_num_; ++i) {
+            if (cpus_[i % cpus_.size()] == cpu) near.push_back(i);
+        }
+        if (!near.empty()) continue;
+        const int node = cpu_node(cpu);
+        for (int i = 0; i < thread_num_; ++i) {
+            if (loop_node[i] == node) near.push_back(i);
+        }
+    }
 }
 
 EventLoop* EventLoopThreadPool::get_next_loop() {
@@ -29,4 +61,18 @@ EventLoop* EventLoopThreadPool::get_next_loop() {
     }
     
     return loop;
-}
\ No newline at end of file
+}
+
+EventLoop* EventLoopThreadPool::get_loop(uint32_t client_ip) {
+    if (loops_.empty()) return base_loop_;
+    return loops_[balancer_->pick(client_ip)];
+}
+
+EventLoop* EventLoopThreadPool::get_loop_for_cpu(int cpu) {
+    if (cpu < 0 || cpu >= static_cast<int>(loops_by_cpu_.size()) || loops_by_cpu_[cpu].empty()) {
+        return get_next_loop();
+    }
+    const auto& near = loops_by_cpu_[cpu];
+    next_loop_ = (next_loop_ + 1) % thread_num_;
+    return loops_[near[next_loop_ % near.size()]];
+}
@@ -4,16 +4,26 @@
 #include <memory>
 #include <vector>
 #include "eventloopthread.h"
+#include "loopbalancer.h"
 
 struct EventLoopThreadPool {
 public:
-    EventLoopThreadPool(EventLoop* base_loop, int thread_num);
+    EventLoopThreadPool(EventLoop* base_loop, int thread_num, std::vector<int> cpus = {},
+                        DispatchPolicy policy = DispatchPolicy::round_robin);
     ~EventLoopThreadPool() = default;
     
     void start();
     
     EventLoop* get_next_loop();
 
+    // 按分配策略为新连接选一个循环，client_ip 为网络字节序
+    EventLoop* get_loop(uint32_t client_ip);
+
+    // 选绑在该核上的循环，没有则选同一 NUMA 节点上的循环，都没有时退回轮询
+    EventLoop* get_loop_for_cpu(int cpu);
+
+    const std::vector<EventLoop*>& loops() const { return loops_; }
+
 private:
     EventLoop* base_loop_;   // 主事件循环
     bool started_;           // 是否已启动
@@ -22,5 +32,8 @@ private:
     
     std::vector<std::unique_ptr<EventLoopThread>> threads_; // 线程池
     std::vector<EventLoop*> loops_;                         // 事件循环池
+    std::vector<int> cpus_;                                 // IO 循环绑定的核，为空则不绑定
+    std::vector<std::vector<int>> loops_by_cpu_;            // 核 -> 就近的循环下标
+    DispatchPolicy policy_;
+    std::unique_ptr<LoopBalancer> balancer_;
 };
-
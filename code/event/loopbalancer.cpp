@@ -0,0 +1,95 @@
+#include "loopbalancer.h"
+#include <algorithm>
+#include <cassert>
+
+static uint32_t mix32(uint32_t x) {
+    // murmur3 的 fmix32，IP 地址低位分布很差，先打散再上环
+    x ^= x >> 16;
+    x *= 0x85ebca6b;
+    x ^= x >> 13;
+    x *= 0xc2b2ae35;
+    x ^= x >> 16;
+    return x;
+}
+
+DispatchPolicy parse_dispatch_policy(std::string_view name) {
+    if(name == "least_conn") return DispatchPolicy::least_conn;
+    if(name == "p2c") return DispatchPolicy::p2c;
+    if(name == "ip_hash") return DispatchPolicy::ip_hash;
+    return DispatchPolicy::round_robin;
+}
+
+const char* dispatch_policy_name(DispatchPolicy policy) {
+    switch(policy) {
+        case DispatchPolicy::least_conn: return "least_conn";
+        case DispatchPolicy::p2c: return "p2c";
+        case DispatchPolicy::ip_hash: return "ip_hash";
+        default: return "round_robin";
+    }
+}
+
+LoopBalancer::LoopBalancer(DispatchPolicy policy, std::vector<const LoopLoad*> loads)
+    : policy_(policy), loads_(std::move(loads)) {
+    assert(!loads_.empty());
+    if(policy_ != DispatchPolicy::ip_hash) return;
+    ring_.reserve(loads_.size() * kVirtualNodes);
+    for(size_t i = 0; i < loads_.size(); ++i) {
+        for(int v = 0; v < kVirtualNodes; ++v) {
+            ring_.emplace_back(mix32(static_cast<uint32_t>(i * kVirtualNodes + v) * 0x9E3779B1u), i);
+        }
+    }
+    std::sort(ring_.begin(), ring_.end());
+}
+
+int LoopBalancer::pick(uint32_t client_ip) {
+    switch(policy_) {
+        case DispatchPolicy::least_conn: return least_conn_();
+        case DispatchPolicy::p2c: return p2c_();
+        case DispatchPolicy::ip_hash: return ip_hash_(client_ip);
+        default: {
+            int idx = next_;
+            next_ = (next_ + 1) % loads_.size();
+            return idx;
+        }
+    }
+}
+
+int LoopBalancer::least_conn_() {
+    // 从轮询位置开始比较，连接数相同时不总是落在第 0 个循环上
+    int best = next_;
+    int best_conn = loads_[best]->connections.load(std::memory_order_relaxed);
+    for(size_t k = 1; k < loads_.size(); ++k) {
+        int i = (next_ + k) % loads_.size();
+        int conn = loads_[i]->connections.load(std::memory_order_relaxed);
+        if(conn < best_conn) {
+            best = i;
+            best_conn = conn;
+        }
+    }
+    next_ = (next_ + 1) % loads_.size();
+    return best;
+}
+
+int LoopBalancer::p2c_() {
+    const size_t n = loads_.size();
+    if(n == 1) return 0;
+    const uint64_t r = next_random_();
+    const int a = r % n;
+    const int b = (a + 1 + (r >> 32) % (n - 1)) % n;
+    return loads_[a]->score() <= loads_[b]->score() ? a : b;
+}
+
+int LoopBalancer::ip_hash_(uint32_t client_ip) const {
+    const uint32_t h = mix32(client_ip);
+    auto it = std::lower_bound(ring_.begin(), ring_.end(), std::make_pair(h, 0));
+    if(it == ring_.end()) it = ring_.begin();
+    return it->second;
+}
+
+uint64_t LoopBalancer::next_random_() {
+    // xorshift64*，只在 acceptor 线程使用，不需要加锁
+    rng_ ^= rng_ >> 12;
+    rng_ ^= rng_ << 25;
+    rng_ ^= rng_ >> 27;
+    return rng_ * 0x2545F4914F6CDD1Dull;
+}
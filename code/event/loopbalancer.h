@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// IO 循环对外发布的负载，acceptor 只做 relaxed 读取
+struct alignas(64) LoopLoad {
+    std::atomic<int> connections{0};          // 分配到该循环的连接数，acceptor 加、关闭时减
+    std::atomic<int64_t> pending_bytes{0};    // 写缓冲区中尚未发出的字节
+    std::atomic<uint32_t> busy_permille{0};   // 循环忙碌度（非 epoll_wait 时间占比）的滑动平均
+
+    // 每个连接计 1 分，每 64KB 待发送数据计 1 分，忙碌度每 1% 计 1 分
+    uint64_t score() const {
+        const int64_t pending = pending_bytes.load(std::memory_order_relaxed);
+        return static_cast<uint64_t>(std::max(connections.load(std::memory_order_relaxed), 0))
+             + static_cast<uint64_t>(std::max<int64_t>(pending, 0) >> 16)
+             + busy_permille.load(std::memory_order_relaxed) / 10;
+    }
+};
+
+enum class DispatchPolicy {
+    round_robin,
+    least_conn,         // 连接数最少
+    p2c,                // 随机取两个，选负载分低的（power of two choices）
+    ip_hash,            // 按客户端 IP 一致性哈希，同一客户端落在同一循环上
+};
+
+// 未识别的名字返回 round_robin
+DispatchPolicy parse_dispatch_policy(std::string_view name);
+const char* dispatch_policy_name(DispatchPolicy policy);
+
+// 新连接的分配策略，只在 acceptor 线程调用
+class LoopBalancer {
+public:
+    LoopBalancer(DispatchPolicy policy, std::vector<const LoopLoad*> loads);
+
+    // 返回选中的循环下标；client_ip 为网络字节序的 IPv4 地址，仅 ip_hash 使用
+    int pick(uint32_t client_ip);
+
+    DispatchPolicy policy() const { return policy_; }
+
+private:
+    static constexpr int kVirtualNodes = 64;  // 每个循环在哈希环上的虚拟节点数
+
+    int least_conn_();
+    int p2c_();
+    int ip_hash_(uint32_t client_ip) const;
+    uint64_t next_random_();
+
+    DispatchPolicy policy_;
+    std::vector<const LoopLoad*> loads_;
+    size_t next_ = 0;
+    uint64_t rng_ = 0x9E3779B97F4A7C15ull;
+    std::vector<std::pair<uint32_t, int>> ring_;   // (哈希值, 循环下标)，按哈希值排序
+};
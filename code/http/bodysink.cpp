@@ -0,0 +1,83 @@
+#include "bodysink.h"
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../log/log.h"
+
+ssize_t BodySink::splice_from(int, size_t, int* saved_errno) {
+    *saved_errno = EOPNOTSUPP;
+    return -1;
+}
+
+FileSink::FileSink(std::string path, size_t limit)
+    : path_(std::move(path)), part_(path_ + ".part"), limit_(limit) {}
+
+FileSink::~FileSink() {
+    if(pipe_[0] >= 0) {
+        ::close(pipe_[0]);
+        ::close(pipe_[1]);
+    }
+    if(fd_ >= 0) {
+        // 没有走到 finish：正文不完整，不留半个文件
+        ::close(fd_);
+        unlink(part_.c_str());
+    }
+}
+
+bool FileSink::open() {
+    // O_EXCL：同名文件的两个上传同时进行时，后到的失败而不是交错写入
+    fd_ = ::open(part_.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if(fd_ < 0) {
+        LOG_ERROR("Upload open %s failed: %d", part_.c_str(), errno);
+        return false;
+    }
+    return true;
+}
+
+bool FileSink::write(std::string_view data) {
+    while(!data.empty()) {
+        const ssize_t n = ::write(fd_, data.data(), data.size());
+        if(n < 0) {
+            if(errno == EINTR) continue;
+            LOG_ERROR("Upload write %s failed: %d", part_.c_str(), errno);
+            return false;
+        }
+        data.remove_prefix(n);
+    }
+    return true;
+}
+
+ssize_t FileSink::splice_from(int fd, size_t len, int* saved_errno) {
+    if(pipe_[0] < 0 && pipe2(pipe_, O_NONBLOCK | O_CLOEXEC) < 0) {
+        *saved_errno = errno;
+        return -1;
+    }
+    // 每次最多搬一管道（默认 64K），管道清空后才返回，不在两次调用之间留数据
+    const ssize_t in = splice(fd, nullptr, pipe_[1], nullptr, len, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if(in <= 0) {
+        if(in < 0) *saved_errno = errno;
+        return in;
+    }
+    for(ssize_t left = in; left > 0;) {
+        const ssize_t out = splice(pipe_[0], nullptr, fd_, nullptr, left, SPLICE_F_MOVE);
+        if(out <= 0) {
+            LOG_ERROR("Upload splice %s failed: %d", part_.c_str(), errno);
+            *saved_errno = out < 0 ? errno : EIO;
+            return -1;
+        }
+        left -= out;
+    }
+    return in;
+}
+
+int FileSink::finish() {
+    const bool ok = ::close(fd_) == 0 && rename(part_.c_str(), path_.c_str()) == 0;
+    fd_ = -1;
+    if(!ok) {
+        LOG_ERROR("Upload finish %s failed: %d", path_.c_str(), errno);
+        unlink(part_.c_str());
+        return 500;
+    }
+    return 201;
+}
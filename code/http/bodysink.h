@@ -0,0 +1,53 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+
+// 请求正文的流式接收方：正文按到达顺序分段交给它，不在内存里攒成一整块
+// 由 HttpRequest::body_handler 在头部解析完之后按请求创建
+class BodySink {
+public:
+    virtual ~BodySink() = default;
+
+    // 正文总长上限，超过时回 413
+    virtual size_t limit() const = 0;
+
+    // 写入一段正文，失败时请求以 500 结束
+    virtual bool write(std::string_view data) = 0;
+
+    // 支持时正文由 splice_from 直接从 socket 搬运（仅明文连接、Content-Length 正文）
+    virtual bool can_splice() const { return false; }
+    // 最多搬运 len 字节；返回值同 read_fd：>0 为字节数，0 为对端关闭，-1 时 errno 为 EAGAIN 表示需要等待
+    virtual ssize_t splice_from(int fd, size_t len, int* saved_errno);
+
+    // 正文接收完毕，返回响应状态码
+    virtual int finish() = 0;
+};
+
+// 写入文件：先写到同目录的 <path>.part，完整接收后改名，连接中途断开时删除
+// 明文连接上的 Content-Length 正文经管道 splice 落盘，不经过用户态
+class FileSink : public BodySink {
+public:
+    FileSink(std::string path, size_t limit);
+    ~FileSink() override;
+
+    FileSink(const FileSink&) = delete;
+    FileSink& operator=(const FileSink&) = delete;
+
+    bool open();
+
+    size_t limit() const override { return limit_; }
+    bool write(std::string_view data) override;
+    bool can_splice() const override { return true; }
+    ssize_t splice_from(int fd, size_t len, int* saved_errno) override;
+    int finish() override;
+
+private:
+    std::string path_;
+    std::string part_;
+    size_t limit_;
+    int fd_ = -1;
+    int pipe_[2] = { -1, -1 };          // socket -> 管道 -> 文件，首次 splice 时创建
+};
@@ -0,0 +1,239 @@
+#include "filecache.h"
+#include <fcntl.h>
+#include <linux/openat2.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <vector>
+
+#include "../log/log.h"
+#include "../metrics/metrics.h"
+
+using std::string;
+using std::string_view;
+
+namespace {
+
+bool same_file(const struct stat& a, const struct stat& b) {
+    return a.st_ino == b.st_ino && a.st_dev == b.st_dev && a.st_size == b.st_size &&
+           a.st_mtim.tv_sec == b.st_mtim.tv_sec && a.st_mtim.tv_nsec == b.st_mtim.tv_nsec;
+}
+
+// 整个文件读进一块内存；读到的长度与 stat 不符（正在被改写）时放弃
+ChainBuffer::SharedBlock read_file(int fd, size_t size) {
+    char* data = new char[size + 1];
+    size_t done = 0;
+    while(done < size) {
+        const ssize_t n = pread(fd, data + done, size - done, done);
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) break;
+        done += n;
+    }
+    if(done != size) {
+        delete[] data;
+        return nullptr;
+    }
+    return ChainBuffer::SharedBlock(data, std::default_delete<const char[]>());
+}
+
+std::atomic<bool> g_no_openat2{false};
+
+std::atomic<size_t> g_next_cache_id{0};
+
+// O_NONBLOCK：目录中的 FIFO 不会卡住 IO 线程
+constexpr int kOpenFlags = O_RDONLY | O_CLOEXEC | O_NOCTTY | O_NONBLOCK;
+
+int openat2_beneath(int dir_fd, const char* path) {
+    struct open_how how = {};
+    how.flags = kOpenFlags;
+    how.resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS;
+    return syscall(SYS_openat2, dir_fd, path, &how, sizeof(how));
+}
+
+// openat2 本身不会因权限返回 EPERM（没有权限是 EACCES），EPERM 只来自 seccomp 等过滤
+inline bool openat2_unsupported(int err) {
+    return err == ENOSYS || err == EPERM;
+}
+
+}  // namespace
+
+bool probe_openat2(int dir_fd) {
+    const int fd = openat2_beneath(dir_fd, ".");
+    if(fd >= 0) {
+        close(fd);
+        return true;
+    }
+    if(!openat2_unsupported(errno)) return true;
+    g_no_openat2.store(true, std::memory_order_relaxed);
+    return false;
+}
+
+bool openat2_available() {
+    return !g_no_openat2.load(std::memory_order_relaxed);
+}
+
+int open_beneath(int dir_fd, const char* path) {
+    if(*path == '\0') path = ".";
+    if(!g_no_openat2.load(std::memory_order_relaxed)) {
+        const int fd = openat2_beneath(dir_fd, path);
+        if(fd >= 0 || !openat2_unsupported(errno)) return fd;
+        // 启动时探测通过、运行中才被拦截（如之后加载的 seccomp 过滤）
+        if(!g_no_openat2.exchange(true, std::memory_order_relaxed)) {
+            LOG_WARN("openat2 unavailable, falling back to openat: symlinks may escape the document root");
+        }
+    }
+    return openat(dir_fd, path, kOpenFlags);
+}
+
+FileCache::FileCache(int dir_fd, size_t capacity, size_t max_file)
+    : dir_fd_(dir_fd), capacity_(capacity), max_file_(max_file),
+      id_(g_next_cache_id.fetch_add(1, std::memory_order_relaxed)),
+      snapshot_(std::make_shared<const Index>()) {}
+
+size_t FileCache::bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+}
+
+const FileCache::Index& FileCache::local_index_() {
+    thread_local std::vector<LocalSnapshot> snapshots;
+    if(snapshots.size() <= id_) snapshots.resize(id_ + 1);
+    LocalSnapshot& local = snapshots[id_];
+    if(local.version != version_.load(std::memory_order_acquire)) {
+        // 只有发布之后的第一次查找才加锁，旧快照的引用计数在这里减掉
+        std::lock_guard<std::mutex> lock(mutex_);
+        local.index = snapshot_;
+        local.version = version_.load(std::memory_order_relaxed);
+    }
+    return *local.index;
+}
+
+bool FileCache::hit_(Entry& entry, uint64_t now, struct stat& st, ChainBuffer::SharedBlock& data) {
+    if(now - entry.checked_ns.load(std::memory_order_relaxed) >= kRevalidateNs) return false;
+    // 淘汰只需要粗略的先后，不必每次命中都写共享的缓存行
+    if(now - entry.used_ns.load(std::memory_order_relaxed) >= kTouchNs) {
+        entry.used_ns.store(now, std::memory_order_relaxed);
+    }
+    st = entry.st;
+    data = entry.data;
+    return true;
+}
+
+bool FileCache::lookup(const char* path, struct stat& st, ChainBuffer::SharedBlock& data, int& fd) {
+    data.reset();
+    fd = -1;
+    LoopMetrics& metrics = LoopMetrics::local();
+    const string_view key(path);
+    const uint64_t now = metrics_now_ns();
+    EntryPtr cached;
+    if(capacity_ > 0) {
+        const Index& snapshot = local_index_();
+        auto it = snapshot.find(key);
+        if(it != snapshot.end() && hit_(*it->second, now, st, data)) {
+            metrics.file_cache_hits.add();
+            return true;
+        }
+        // 快照中没有或需要复查：主索引中可能已有发布之后插入或重新读入的条目
+        std::lock_guard<std::mutex> lock(mutex_);
+        publish_(now);
+        auto master = index_.find(key);
+        if(master != index_.end()) {
+            if(hit_(*master->second, now, st, data)) {
+                metrics.file_cache_hits.add();
+                return true;
+            }
+            cached = master->second;
+        }
+    }
+
+    fd = open_beneath(dir_fd_, path);
+    if(fd >= 0 && fstat(fd, &st) < 0) {
+        close(fd);
+        fd = -1;
+    }
+    if(cached && fd >= 0 && same_file(st, cached->st)) {
+        close(fd);
+        fd = -1;
+        cached->checked_ns.store(now, std::memory_order_relaxed);
+        cached->used_ns.store(now, std::memory_order_relaxed);
+        data = cached->data;
+        metrics.file_cache_hits.add();
+        return true;
+    }
+    if(capacity_ == 0) {
+        return fd >= 0;
+    }
+    metrics.file_cache_misses.add();
+    if(cached) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        erase_(cached);
+        publish_(now);
+    }
+    if(fd < 0) {
+        return false;
+    }
+    if(cacheable_(st) && (data = read_file(fd, st.st_size))) {
+        close(fd);
+        fd = -1;
+        insert_(key, st, data, now);
+    }
+    return true;
+}
+
+bool FileCache::cacheable_(const struct stat& st) const {
+    const size_t size = st.st_size;
+    return S_ISREG(st.st_mode) && (st.st_mode & S_IROTH) && size <= max_file_ && size <= capacity_;
+}
+
+void FileCache::insert_(string_view path, const struct stat& st, ChainBuffer::SharedBlock data, uint64_t now) {
+    auto entry = std::make_shared<Entry>();
+    entry->path.assign(path);
+    entry->st = st;
+    entry->data = std::move(data);
+    entry->checked_ns.store(now, std::memory_order_relaxed);
+    entry->used_ns.store(now, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // 另一个线程可能同时读了同一个文件，以后插入的为准
+    auto it = index_.find(path);
+    if(it != index_.end()) erase_(EntryPtr(it->second));
+    const string_view key = entry->path;
+    index_.emplace(key, std::move(entry));
+    bytes_ += st.st_size;
+    dirty_ = true;
+    if(bytes_ > capacity_) evict_();
+    publish_(now);
+}
+
+void FileCache::erase_(const EntryPtr& entry) {
+    auto it = index_.find(entry->path);
+    if(it == index_.end() || it->second != entry) return;
+    bytes_ -= entry->st.st_size;
+    index_.erase(it);
+    dirty_ = true;
+}
+
+void FileCache::evict_() {
+    // 按最近使用时间从旧到新，一次多淘汰一些，不必每次插入都排序
+    std::vector<std::pair<uint64_t, EntryPtr>> entries;
+    entries.reserve(index_.size());
+    for(const auto& [path, entry] : index_) {
+        entries.emplace_back(entry->used_ns.load(std::memory_order_relaxed), entry);
+    }
+    std::sort(entries.begin(), entries.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+    const size_t target = capacity_ - capacity_ / 8;
+    for(size_t i = 0; i < entries.size() && bytes_ > target; ++i) {
+        erase_(entries[i].second);
+    }
+}
+
+void FileCache::publish_(uint64_t now) {
+    if(!dirty_ || now - published_ns_ < kPublishNs) return;
+    snapshot_ = std::make_shared<const Index>(index_);
+    published_ns_ = now;
+    dirty_ = false;
+    version_.fetch_add(1, std::memory_order_release);
+}
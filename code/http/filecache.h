@@ -0,0 +1,87 @@
+#pragma once
+
+#include <sys/stat.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "../buffer/chainbuffer.h"
+
+// 在 dir_fd 之下打开 path（相对路径，为空即目录本身），只读、不阻塞：openat2 的 RESOLVE_BENEATH 拒绝 ..
+// 和指向目录之外的符号链接；openat2 不可用时退回 openat，路径已规范化，不含 ..，但符号链接可以指向目录之外
+int open_beneath(int dir_fd, const char* path);
+
+// 启动时对文档根目录调用一次：内核不支持（5.6 之前，ENOSYS）或被 seccomp 拦截（EPERM）时，
+// 此后 open_beneath 都直接用 openat，返回 false
+bool probe_openat2(int dir_fd);
+bool openat2_available();
+
+// 一个目录下小文件的内容缓存：以规范化的相对路径为键，近似 LRU 淘汰，总内存不超过 capacity
+// 内容以共享块交给写缓冲区，条目被淘汰或文件更新后，正在发送的响应仍持有旧内容
+// 命中的条目至多每 kRevalidateNs 重新打开检查一次，大小、修改时间或 inode 变化时重新读取
+// 各 IO 线程共用。索引以 RCU 方式发布：加锁修改主索引，至多每 kPublishNs 复制一份只读快照，
+// 各线程持有快照的引用、版本号变化时才加锁换新，命中快照不加锁；快照里没有的再加锁查主索引
+// 命中只记下时间，淘汰时按最近使用时间排序，一次降到容量的 7/8；
+// 已淘汰的条目在各线程换新快照之前仍占内存，实际占用可能短暂超过 capacity
+class FileCache {
+public:
+    static constexpr uint64_t kRevalidateNs = 1000000000;
+    static constexpr uint64_t kPublishNs = 100000000;
+    static constexpr uint64_t kTouchNs = 10000000;         // 命中时间的记录粒度
+
+    // dir_fd 由调用方持有，生命期不短于缓存
+    FileCache(int dir_fd, size_t capacity, size_t max_file);
+
+    FileCache(const FileCache&) = delete;
+    FileCache& operator=(const FileCache&) = delete;
+
+    // path 见 open_beneath。返回 false 即文件不存在或不在目录之下；成功时 st 为文件属性，
+    // data 非空表示内容已在内存中，否则 fd 为打开的文件，由调用方映射并关闭
+    bool lookup(const char* path, struct stat& st, ChainBuffer::SharedBlock& data, int& fd);
+
+    size_t bytes() const;
+    size_t capacity() const { return capacity_; }
+
+private:
+    // 除两个时间外创建后不再修改，快照与主索引共享
+    struct Entry {
+        std::string path;
+        struct stat st;
+        ChainBuffer::SharedBlock data;
+        std::atomic<uint64_t> checked_ns;
+        std::atomic<uint64_t> used_ns;
+    };
+    using EntryPtr = std::shared_ptr<Entry>;
+    using Index = std::unordered_map<std::string_view, EntryPtr>;   // 键指向条目中的 path
+
+    struct LocalSnapshot {
+        std::shared_ptr<const Index> index;
+        uint64_t version = 0;
+    };
+
+    const Index& local_index_();
+    bool hit_(Entry& entry, uint64_t now, struct stat& st, ChainBuffer::SharedBlock& data);
+    bool cacheable_(const struct stat& st) const;
+    void insert_(std::string_view path, const struct stat& st, ChainBuffer::SharedBlock data, uint64_t now);
+    void erase_(const EntryPtr& entry);
+    void evict_();
+    void publish_(uint64_t now);
+
+    const int dir_fd_;
+    const size_t capacity_;
+    const size_t max_file_;
+    const size_t id_;                                       // 线程本地快照表中的下标
+
+    std::atomic<uint64_t> version_{1};                      // 每次发布快照加一
+
+    mutable std::mutex mutex_;
+    Index index_;                                           // 主索引
+    std::shared_ptr<const Index> snapshot_;                 // 最近发布的快照
+    bool dirty_ = false;                                    // 主索引在发布之后有变化
+    uint64_t published_ns_ = 0;
+    size_t bytes_ = 0;
+};
@@ -0,0 +1,328 @@
+#include "hpack.h"
+#include <algorithm>
+#include <array>
+
+using std::string;
+using std::string_view;
+
+namespace {
+
+// Huffman 解码状态机：状态即编码树的内部节点（共 256 个），每次输入 4 位
+// 最短编码为 5 位，4 位之内最多产生一个符号
+struct HuffmanTransition {
+    uint8_t next;
+    uint8_t sym;
+    uint8_t flags;
+};
+
+enum : uint8_t {
+    kHuffEmit = 1,
+    kHuffFail = 2,
+};
+
+struct HuffmanDecodeTable {
+    std::array<std::array<HuffmanTransition, 16>, 256> trans{};
+    std::array<bool, 256> accept{};     // 停在该状态时剩余的位是合法填充（全 1 且不超过 7 位）
+
+    HuffmanDecodeTable() {
+        struct Node {
+            int child[2] = {-1, -1};
+            int sym = -1;
+            int depth = 0;
+            bool all_ones = true;
+        };
+        std::vector<Node> nodes(1);
+        for(size_t sym = 0; sym < HPACK_HUFFMAN_CODES.size(); ++sym) {
+            const HuffmanCode& hc = HPACK_HUFFMAN_CODES[sym];
+            int cur = 0;
+            for(int i = hc.bits - 1; i >= 0; --i) {
+                const int bit = (hc.code >> i) & 1;
+                if(nodes[cur].child[bit] < 0) {
+                    Node node;
+                    node.depth = nodes[cur].depth + 1;
+                    node.all_ones = nodes[cur].all_ones && bit;
+                    nodes[cur].child[bit] = nodes.size();
+                    nodes.push_back(node);
+                }
+                cur = nodes[cur].child[bit];
+            }
+            nodes[cur].sym = sym;
+        }
+
+        // 内部节点编号为状态
+        std::vector<int> state_of(nodes.size(), -1);
+        std::vector<int> node_of;
+        for(size_t i = 0; i < nodes.size(); ++i) {
+            if(nodes[i].sym < 0) {
+                state_of[i] = node_of.size();
+                node_of.push_back(i);
+            }
+        }
+
+        for(size_t state = 0; state < node_of.size(); ++state) {
+            accept[state] = nodes[node_of[state]].all_ones && nodes[node_of[state]].depth <= 7;
+            for(int nibble = 0; nibble < 16; ++nibble) {
+                HuffmanTransition& t = trans[state][nibble];
+                int cur = node_of[state];
+                for(int i = 3; i >= 0; --i) {
+                    cur = nodes[cur].child[(nibble >> i) & 1];
+                    if(nodes[cur].sym == 256) {
+                        t.flags = kHuffFail;
+                        break;
+                    }
+                    if(nodes[cur].sym >= 0) {
+                        t.flags |= kHuffEmit;
+                        t.sym = nodes[cur].sym;
+                        cur = 0;
+                    }
+                }
+                t.next = state_of[cur] < 0 ? 0 : state_of[cur];
+            }
+        }
+    }
+};
+
+const HuffmanDecodeTable& huffman_table() {
+    static const HuffmanDecodeTable table;
+    return table;
+}
+
+}  // namespace
+
+bool HpackHuffman::decode(string_view in, string& out) {
+    const HuffmanDecodeTable& table = huffman_table();
+    uint8_t state = 0;
+    for(unsigned char c : in) {
+        for(int nibble : {c >> 4, c & 0xF}) {
+            const HuffmanTransition& t = table.trans[state][nibble];
+            if(t.flags & kHuffFail) return false;
+            if(t.flags & kHuffEmit) out.push_back(static_cast<char>(t.sym));
+            state = t.next;
+        }
+    }
+    return table.accept[state];
+}
+
+size_t HpackHuffman::encoded_size(string_view in) {
+    size_t bits = 0;
+    for(unsigned char c : in) {
+        bits += HPACK_HUFFMAN_CODES[c].bits;
+    }
+    return (bits + 7) / 8;
+}
+
+void HpackHuffman::encode(string_view in, string& out) {
+    uint64_t acc = 0;
+    int nbits = 0;
+    for(unsigned char c : in) {
+        const HuffmanCode& hc = HPACK_HUFFMAN_CODES[c];
+        acc = acc << hc.bits | hc.code;
+        nbits += hc.bits;
+        while(nbits >= 8) {
+            nbits -= 8;
+            out.push_back(static_cast<char>(acc >> nbits));
+        }
+    }
+    if(nbits > 0) {
+        // 用 EOS 的高位（全 1）填满最后一个字节
+        out.push_back(static_cast<char>(acc << (8 - nbits) | (0xFF >> nbits)));
+    }
+}
+
+void HpackTable::set_max_size(size_t size) {
+    max_size_ = size;
+    evict_(max_size_);
+}
+
+void HpackTable::evict_(size_t limit) {
+    while(size_ > limit && !entries_.empty()) {
+        const auto& back = entries_.back();
+        size_ -= back.first.size() + back.second.size() + kEntryOverhead;
+        entries_.pop_back();
+    }
+}
+
+void HpackTable::add(string_view name, string_view value) {
+    const size_t size = name.size() + value.size() + kEntryOverhead;
+    if(size > max_size_) {
+        // 比整张表还大的条目会清空表且不被加入
+        evict_(0);
+        return;
+    }
+    evict_(max_size_ - size);
+    entries_.emplace_front(name, value);
+    size_ += size;
+}
+
+bool HpackTable::get(size_t index, string_view& name, string_view& value) const {
+    if(index == 0) return false;
+    if(index <= HPACK_STATIC_TABLE.size()) {
+        name = HPACK_STATIC_TABLE[index - 1].name;
+        value = HPACK_STATIC_TABLE[index - 1].value;
+        return true;
+    }
+    index -= HPACK_STATIC_TABLE.size() + 1;
+    if(index >= entries_.size()) return false;
+    name = entries_[index].first;
+    value = entries_[index].second;
+    return true;
+}
+
+size_t HpackTable::find(string_view name, string_view value, bool& name_only) const {
+    size_t name_index = 0;
+    for(size_t i = 0; i < HPACK_STATIC_TABLE.size(); ++i) {
+        if(HPACK_STATIC_TABLE[i].name != name) continue;
+        if(HPACK_STATIC_TABLE[i].value == value) {
+            name_only = false;
+            return i + 1;
+        }
+        if(name_index == 0) name_index = i + 1;
+    }
+    for(size_t i = 0; i < entries_.size(); ++i) {
+        if(entries_[i].first != name) continue;
+        if(entries_[i].second == value) {
+            name_only = false;
+            return HPACK_STATIC_TABLE.size() + 1 + i;
+        }
+        if(name_index == 0) name_index = HPACK_STATIC_TABLE.size() + 1 + i;
+    }
+    name_only = name_index != 0;
+    return name_index;
+}
+
+bool HpackDecoder::decode_int_(const uint8_t*& p, const uint8_t* end, int prefix, uint64_t& value) {
+    if(p == end) return false;
+    const uint8_t mask = (1 << prefix) - 1;
+    value = *p++ & mask;
+    if(value < mask) return true;
+    for(int shift = 0; p != end; shift += 7) {
+        // 头部块里的整数不会超过 2^32，更长的编码视为错误
+        if(shift > 28) return false;
+        const uint8_t b = *p++;
+        value += static_cast<uint64_t>(b & 0x7F) << shift;
+        if(!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+bool HpackDecoder::decode_string_(const uint8_t*& p, const uint8_t* end, string& out) {
+    if(p == end) return false;
+    const bool huffman = *p & 0x80;
+    uint64_t len;
+    if(!decode_int_(p, end, 7, len) || len > static_cast<uint64_t>(end - p)) return false;
+    string_view raw(reinterpret_cast<const char*>(p), len);
+    p += len;
+    out.clear();
+    if(!huffman) {
+        out.assign(raw);
+        return true;
+    }
+    return HpackHuffman::decode(raw, out);
+}
+
+HpackDecoder::Result HpackDecoder::decode(string_view block, HeaderList& headers, size_t max_list_size) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(block.data());
+    const uint8_t* end = p + block.size();
+    bool field_seen = false;
+    size_t list_size = 0;
+    // 在复制之前计入列表大小
+    auto fits = [&](size_t name_len, size_t value_len) {
+        list_size += name_len + value_len + HpackTable::kEntryOverhead;
+        return list_size <= max_list_size;
+    };
+    while(p != end) {
+        const uint8_t b = *p;
+        uint64_t index;
+        if(b & 0x80) {
+            // 索引字段
+            if(!decode_int_(p, end, 7, index)) return Result::error;
+            string_view name, value;
+            if(!table_.get(index, name, value)) return Result::error;
+            if(!fits(name.size(), value.size())) return Result::too_large;
+            headers.emplace_back(name, value);
+            field_seen = true;
+            continue;
+        }
+        if((b & 0xE0) == 0x20) {
+            // 动态表大小更新，只能出现在块的开头
+            if(field_seen || !decode_int_(p, end, 5, index) || index > kMaxTableSize) return Result::error;
+            table_.set_max_size(index);
+            continue;
+        }
+        const bool incremental = (b & 0xC0) == 0x40;
+        if(!decode_int_(p, end, incremental ? 6 : 4, index)) return Result::error;
+        string name, value;
+        if(index == 0) {
+            if(!decode_string_(p, end, name)) return Result::error;
+        } else {
+            string_view n, v;
+            if(!table_.get(index, n, v)) return Result::error;
+            name.assign(n);
+        }
+        if(!decode_string_(p, end, value)) return Result::error;
+        if(!fits(name.size(), value.size())) return Result::too_large;
+        if(incremental) table_.add(name, value);
+        headers.emplace_back(std::move(name), std::move(value));
+        field_seen = true;
+    }
+    return Result::ok;
+}
+
+void HpackEncoder::set_max_table_size(size_t size) {
+    size = std::min(size, kMaxTableSize);
+    if(size == table_.max_size()) return;
+    pending_min_ = std::min(pending_min_, size);
+    table_.set_max_size(size);
+}
+
+void HpackEncoder::begin(string& out) {
+    if(pending_min_ == SIZE_MAX) return;
+    encode_int_(out, 0x20, 5, pending_min_);
+    if(pending_min_ != table_.max_size()) {
+        encode_int_(out, 0x20, 5, table_.max_size());
+    }
+    pending_min_ = SIZE_MAX;
+}
+
+void HpackEncoder::encode_int_(string& out, uint8_t first, int prefix, uint64_t value) {
+    const uint64_t mask = (1u << prefix) - 1;
+    if(value < mask) {
+        out.push_back(static_cast<char>(first | value));
+        return;
+    }
+    out.push_back(static_cast<char>(first | mask));
+    value -= mask;
+    while(value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+void HpackEncoder::encode_string_(string& out, string_view str) {
+    const size_t huff_len = HpackHuffman::encoded_size(str);
+    if(huff_len < str.size()) {
+        encode_int_(out, 0x80, 7, huff_len);
+        HpackHuffman::encode(str, out);
+    } else {
+        encode_int_(out, 0x00, 7, str.size());
+        out.append(str);
+    }
+}
+
+void HpackEncoder::encode(string& out, string_view name, string_view value, bool index) {
+    bool name_only = false;
+    const size_t found = table_.find(name, value, name_only);
+    if(found && !name_only) {
+        encode_int_(out, 0x80, 7, found);
+        return;
+    }
+    if(index) {
+        encode_int_(out, 0x40, 6, found);
+    } else {
+        encode_int_(out, 0x00, 4, found);
+    }
+    if(found == 0) encode_string_(out, name);
+    encode_string_(out, value);
+    if(index) table_.add(name, value);
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "hpacktables.h"
+
+using HeaderList = std::vector<std::pair<std::string, std::string>>;
+
+// HPACK 的 Huffman 编解码；解码用按半字节推进的状态机，每 4 位查一次表
+class HpackHuffman {
+public:
+    static bool decode(std::string_view in, std::string& out);
+    static size_t encoded_size(std::string_view in);
+    static void encode(std::string_view in, std::string& out);
+};
+
+// 静态表之后接动态表的统一索引空间；动态表新条目在前，大小按 RFC 7541 计为 名字 + 值 + 32
+class HpackTable {
+public:
+    static constexpr size_t kEntryOverhead = 32;
+
+    explicit HpackTable(size_t max_size = 4096) : max_size_(max_size) {}
+
+    void set_max_size(size_t size);
+    size_t max_size() const { return max_size_; }
+
+    void add(std::string_view name, std::string_view value);
+
+    // 索引从 1 开始，越界返回 false
+    bool get(size_t index, std::string_view& name, std::string_view& value) const;
+
+    // 编码用：返回名字和值都相同的索引；只有名字相同时返回名字的索引并置 name_only；都没有返回 0
+    size_t find(std::string_view name, std::string_view value, bool& name_only) const;
+
+private:
+    void evict_(size_t limit);
+
+    std::deque<std::pair<std::string, std::string>> entries_;
+    size_t size_ = 0;
+    size_t max_size_;
+};
+
+class HpackDecoder {
+public:
+    enum class Result { ok, error, too_large };
+
+    // 解码一个完整的头部块，出错（COMPRESSION_ERROR）返回 error
+    // 头部列表按 RFC 7541 计（名字 + 值 + 32）超过 max_list_size 时立即停止、返回 too_large：
+    // 索引字段每次都复制整条表项，小的头部块也能解出巨大的列表；每个字段至少计 32，个数也因此受限
+    // 停在块中间后动态表与对端不再同步，调用方只能关闭连接
+    Result decode(std::string_view block, HeaderList& headers, size_t max_list_size = SIZE_MAX);
+
+private:
+    static bool decode_int_(const uint8_t*& p, const uint8_t* end, int prefix, uint64_t& value);
+    static bool decode_string_(const uint8_t*& p, const uint8_t* end, std::string& out);
+
+    // 本端不修改 SETTINGS_HEADER_TABLE_SIZE，对端的表大小更新不能超过默认值
+    static constexpr size_t kMaxTableSize = 4096;
+
+    HpackTable table_;
+};
+
+class HpackEncoder {
+public:
+    // 对端 SETTINGS_HEADER_TABLE_SIZE 变小时，下一个头部块开头带上表大小更新
+    void set_max_table_size(size_t size);
+
+    // 每个头部块开始时调用
+    void begin(std::string& out);
+
+    // index 为 false 时以“不索引”字面量编码，用于每次都不同的值（如 content-length）
+    void encode(std::string& out, std::string_view name, std::string_view value, bool index = true);
+
+private:
+    static void encode_int_(std::string& out, uint8_t first, int prefix, uint64_t value);
+    static void encode_string_(std::string& out, std::string_view str);
+
+    static constexpr size_t kMaxTableSize = 4096;
+
+    HpackTable table_;
+    size_t pending_min_ = SIZE_MAX;         // 上个头部块之后表大小的最小值，SIZE_MAX 表示没有变化
+};
@@ -0,0 +1,804 @@
+#include "http2session.h"
+#include <algorithm>
+#include <charconv>
+
+#include "../config/runtime.h"
+#include "../limiter/ratelimiter.h"
+#include "../metrics/metrics.h"
+#include "../pool/sqlconnpool.h"
+#include "httpdate.h"
+#include "httpresponse.h"
+#include "router.h"
+#include "urlpath.h"
+
+using std::string;
+using std::string_view;
+
+namespace {
+
+enum : uint8_t {
+    FLAG_END_STREAM = 0x1,
+    FLAG_ACK = 0x1,
+    FLAG_END_HEADERS = 0x4,
+    FLAG_PADDED = 0x8,
+    FLAG_PRIORITY = 0x20,
+};
+
+enum : uint16_t {
+    SETTINGS_HEADER_TABLE_SIZE = 0x1,
+    SETTINGS_ENABLE_PUSH = 0x2,
+    SETTINGS_MAX_CONCURRENT_STREAMS = 0x3,
+    SETTINGS_INITIAL_WINDOW_SIZE = 0x4,
+    SETTINGS_MAX_FRAME_SIZE = 0x5,
+    SETTINGS_MAX_HEADER_LIST_SIZE = 0x6,
+};
+
+uint32_t read_u32(const char* p) {
+    const auto* u = reinterpret_cast<const uint8_t*>(p);
+    return static_cast<uint32_t>(u[0]) << 24 | u[1] << 16 | u[2] << 8 | u[3];
+}
+
+void put_u32(char* p, uint32_t v) {
+    p[0] = static_cast<char>(v >> 24);
+    p[1] = static_cast<char>(v >> 16);
+    p[2] = static_cast<char>(v >> 8);
+    p[3] = static_cast<char>(v);
+}
+
+// 去掉 PADDED 标志带来的填充，格式错误返回 false
+bool strip_padding(uint8_t flags, string_view& payload) {
+    if(!(flags & FLAG_PADDED)) return true;
+    if(payload.empty()) return false;
+    const size_t pad = static_cast<uint8_t>(payload[0]);
+    if(pad >= payload.size()) return false;
+    payload = payload.substr(1, payload.size() - 1 - pad);
+    return true;
+}
+
+// HTTP2-Settings 头使用不带填充的 base64url
+bool decode_base64url(string_view in, string& out) {
+    uint32_t acc = 0;
+    int bits = 0;
+    for(char c : in) {
+        int v;
+        if(c >= 'A' && c <= 'Z') v = c - 'A';
+        else if(c >= 'a' && c <= 'z') v = c - 'a' + 26;
+        else if(c >= '0' && c <= '9') v = c - '0' + 52;
+        else if(c == '-') v = 62;
+        else if(c == '_') v = 63;
+        else if(c == '=') break;
+        else return false;
+        acc = acc << 6 | v;
+        bits += 6;
+        if(bits >= 8) {
+            bits -= 8;
+            out.push_back(static_cast<char>(acc >> bits));
+        }
+    }
+    return true;
+}
+
+// 存放内存中生成的正文，与文件映射一样以共享块挂到写缓冲区上
+ChainBuffer::SharedBlock make_block(string_view body) {
+    char* data = new char[body.size() + 1];
+    std::memcpy(data, body.data(), body.size());
+    return ChainBuffer::SharedBlock(data, std::default_delete<const char[]>());
+}
+
+}  // namespace
+
+Http2Session::Http2Session(uint32_t client_ip)
+    : client_ip_(client_ip) {}
+
+Http2Session::~Http2Session() {
+    close();
+}
+
+void Http2Session::start(ChainBuffer& out) {
+    write_settings_(out);
+}
+
+bool Http2Session::upgrade(string_view settings, const HttpRequest& request, ChainBuffer& out) {
+    string payload;
+    if(!decode_base64url(settings, payload) || payload.size() % 6 != 0 || apply_settings_(payload) != NO_ERROR) {
+        return false;
+    }
+    // 101 即是对 HTTP2-Settings 的确认，不再回 SETTINGS ACK
+    out.append("HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n");
+    write_settings_(out);
+
+    Stream& stream = streams_[1];
+    stream.id = 1;
+    stream.remote_closed = true;
+    stream.method = request.method();
+    stream.path = request.path();
+    stream.authority = request.header("host");
+    stream.send_window = peer_initial_window_;
+    stream.start_ns = metrics_now_ns();
+    last_stream_id_ = 1;
+    dispatch_(stream, out);
+    return true;
+}
+
+void Http2Session::on_read(Buffer& in, ChainBuffer& out) {
+    if(failed_) {
+        in.retrieve_all();
+        return;
+    }
+    if(!preface_received_) {
+        auto view = in.readable_view();
+        const size_t n = std::min(view.size(), kPreface.size());
+        if(string_view(view.data(), n) != kPreface.substr(0, n)) {
+            fail_(PROTOCOL_ERROR, out);
+            in.retrieve_all();
+            return;
+        }
+        if(n < kPreface.size()) return;
+        in.retrieve(kPreface.size());
+        preface_received_ = true;
+    }
+
+    while(!failed_) {
+        auto view = in.readable_view();
+        if(view.size() < 9) break;
+        const auto* h = reinterpret_cast<const uint8_t*>(view.data());
+        const size_t len = static_cast<size_t>(h[0]) << 16 | h[1] << 8 | h[2];
+        const uint8_t type = h[3];
+        const uint8_t flags = h[4];
+        const uint32_t id = read_u32(view.data() + 5) & 0x7fffffff;
+        if(len > kMaxFrameSize) {
+            fail_(FRAME_SIZE_ERROR, out);
+            break;
+        }
+        if(view.size() < 9 + len) break;
+
+        const string_view payload(view.data() + 9, len);
+        if(!settings_received_ && type != SETTINGS) {
+            // 客户端前言之后的第一帧必须是 SETTINGS
+            fail_(PROTOCOL_ERROR, out);
+            break;
+        }
+        if(continuation_stream_ && (type != CONTINUATION || id != continuation_stream_)) {
+            fail_(PROTOCOL_ERROR, out);
+            break;
+        }
+        handle_frame_(type, flags, id, payload, out);
+        in.retrieve(9 + len);
+    }
+    if(failed_) {
+        in.retrieve_all();
+        return;
+    }
+    if(recv_unacked_ > 0) {
+        write_window_update_(out, 0, recv_unacked_);
+        recv_unacked_ = 0;
+    }
+}
+
+void Http2Session::handle_frame_(uint8_t type, uint8_t flags, uint32_t id, string_view payload, ChainBuffer& out) {
+    switch(type) {
+    case DATA:
+        on_data_(flags, id, payload, out);
+        break;
+    case HEADERS:
+        on_headers_(flags, id, payload, out);
+        break;
+    case PRIORITY:
+        on_priority_(id, payload, out);
+        break;
+    case RST_STREAM:
+        on_rst_stream_(id, payload, out);
+        break;
+    case SETTINGS:
+        on_settings_(flags, id, payload, out);
+        break;
+    case PUSH_PROMISE:
+        // 客户端不能推送
+        fail_(PROTOCOL_ERROR, out);
+        break;
+    case PING:
+        if(id != 0) {
+            fail_(PROTOCOL_ERROR, out);
+        } else if(payload.size() != 8) {
+            fail_(FRAME_SIZE_ERROR, out);
+        } else if(!(flags & FLAG_ACK)) {
+            write_frame_header_(out, 8, PING, FLAG_ACK, 0);
+            out.append(payload);
+        }
+        break;
+    case GOAWAY:
+        if(id != 0) fail_(PROTOCOL_ERROR, out);
+        else peer_goaway_ = true;
+        break;
+    case WINDOW_UPDATE:
+        on_window_update_(id, payload, out);
+        break;
+    case CONTINUATION:
+        on_continuation_(flags, id, payload, out);
+        break;
+    default:
+        // 未知类型的帧必须忽略
+        break;
+    }
+}
+
+void Http2Session::on_settings_(uint8_t flags, uint32_t id, string_view payload, ChainBuffer& out) {
+    if(id != 0) {
+        fail_(PROTOCOL_ERROR, out);
+        return;
+    }
+    if(flags & FLAG_ACK) {
+        if(!payload.empty()) fail_(FRAME_SIZE_ERROR, out);
+        return;
+    }
+    if(payload.size() % 6 != 0) {
+        fail_(FRAME_SIZE_ERROR, out);
+        return;
+    }
+    if(const uint32_t error = apply_settings_(payload)) {
+        fail_(error, out);
+        return;
+    }
+    settings_received_ = true;
+    write_frame_header_(out, 0, SETTINGS, FLAG_ACK, 0);
+}
+
+uint32_t Http2Session::apply_settings_(string_view payload) {
+    for(size_t i = 0; i + 6 <= payload.size(); i += 6) {
+        const auto* p = reinterpret_cast<const uint8_t*>(payload.data() + i);
+        const uint16_t key = p[0] << 8 | p[1];
+        const uint32_t value = read_u32(payload.data() + i + 2);
+        switch(key) {
+        case SETTINGS_HEADER_TABLE_SIZE:
+            encoder_.set_max_table_size(value);
+            break;
+        case SETTINGS_ENABLE_PUSH:
+            if(value > 1) return PROTOCOL_ERROR;
+            break;
+        case SETTINGS_INITIAL_WINDOW_SIZE: {
+            if(value > kMaxWindow) return FLOW_CONTROL_ERROR;
+            // 初始窗口的变化作用于所有已打开的流
+            const int64_t delta = static_cast<int64_t>(value) - peer_initial_window_;
+            for(auto& [sid, stream] : streams_) {
+                stream.send_window += delta;
+                if(stream.send_window > kMaxWindow) return FLOW_CONTROL_ERROR;
+            }
+            peer_initial_window_ = value;
+            break;
+        }
+        case SETTINGS_MAX_FRAME_SIZE:
+            if(value < 16384 || value > 16777215) return PROTOCOL_ERROR;
+            peer_max_frame_ = value;
+            break;
+        default:
+            break;
+        }
+    }
+    return NO_ERROR;
+}
+
+void Http2Session::on_headers_(uint8_t flags, uint32_t id, string_view payload, ChainBuffer& out) {
+    if(id == 0 || !(id & 1)) {
+        fail_(PROTOCOL_ERROR, out);
+        return;
+    }
+    if(!strip_padding(flags, payload)) {
+        fail_(PROTOCOL_ERROR, out);
+        return;
+    }
+    pending_ = PendingHeaders();
+    pending_.stream = id;
+    pending_.end_stream = flags & FLAG_END_STREAM;
+    if(flags & FLAG_PRIORITY) {
+        if(payload.size() < 5) {
+            fail_(PROTOCOL_ERROR, out);
+            return;
+        }
+        pending_.has_priority = true;
+        pending_.parent = read_u32(payload.data()) & 0x7fffffff;
+        pending_.weight = static_cast<uint8_t>(payload[4]) + 1;
+        payload.remove_prefix(5);
+        if(pending_.parent == id) {
+            fail_(PROTOCOL_ERROR, out);
+            return;
+        }
+    }
+
+    auto it = streams_.find(id);
+    if(it == streams_.end() && id <= last_stream_id_) {
+        // 流 id 只能递增，已关闭的流上再来 HEADERS 是连接错误
+        fail_(STREAM_CLOSED, out);
+        return;
+    }
+    if(it != streams_.end() && (it->second.remote_closed || !pending_.end_stream)) {
+        // 已有的流上只能收到带 END_STREAM 的尾部字段
+        fail_(it->second.remote_closed ? STREAM_CLOSED : PROTOCOL_ERROR, out);
+        return;
+    }
+
+    pending_.block.assign(payload);
+    if(flags & FLAG_END_HEADERS) {
+        finish_headers_(out);
+    } else {
+        continuation_stream_ = id;
+    }
+}
+
+void Http2Session::on_continuation_(uint8_t flags, uint32_t id, string_view payload, ChainBuffer& out) {
+    if(continuation_stream_ == 0 || id != continuation_stream_) {
+        fail_(PROTOCOL_ERROR, out);
+        return;
+    }
+    if(pending_.block.size() + payload.size() > kMaxHeaderBlock) {
+        fail_(ENHANCE_YOUR_CALM, out);
+        return;
+    }
+    pending_.block.append(payload);
+    if(flags & FLAG_END_HEADERS) {
+        continuation_stream_ = 0;
+        finish_headers_(out);
+    }
+}
+
+void Http2Session::finish_headers_(ChainBuffer& out) {
+    HeaderList headers;
+    // 即使随后拒绝该流也要解码，保持动态表与对端同步；解出的列表与 HTTP/1.1 的头部同一上限
+    const HpackDecoder::Result result = decoder_.decode(pending_.block, headers, HttpRequest::max_header_size);
+    if(result != HpackDecoder::Result::ok) {
+        // 超限时解码停在块中间，动态表已不同步，只能关闭连接
+        fail_(result == HpackDecoder::Result::too_large ? ENHANCE_YOUR_CALM : COMPRESSION_ERROR, out);
+        return;
+    }
+    const uint32_t id = pending_.stream;
+    pending_.block.clear();
+
+    auto it = streams_.find(id);
+    if(it != streams_.end()) {
+        // 尾部字段：内容不使用，只结束请求
+        Stream& stream = it->second;
+        stream.remote_closed = true;
+        if(!stream.dispatched) dispatch_(stream, out);
+        return;
+    }
+
+    last_stream_id_ = id;
+    if(goaway_sent_ || streams_.size() >= kMaxConcurrentStreams) {
+        write_rst_stream_(out, id, REFUSED_STREAM);
+        return;
+    }
+
+    Stream& stream = streams_[id];
+    stream.id = id;
+    stream.remote_closed = pending_.end_stream;
+    stream.send_window = peer_initial_window_;
+    stream.start_ns = metrics_now_ns();
+    if(pending_.has_priority) {
+        stream.parent = pending_.parent;
+        stream.weight = pending_.weight;
+        stream.incremental = true;
+    }
+    if(!parse_request_(stream, headers)) {
+        reset_stream_(id, PROTOCOL_ERROR, out);
+        return;
+    }
+    if(stream.remote_closed) dispatch_(stream, out);
+}
+
+bool Http2Session::parse_request_(Stream& stream, const HeaderList& headers) {
+    bool regular_seen = false;
+    bool has_scheme = false;
+    for(const auto& [name, value] : headers) {
+        if(std::any_of(name.begin(), name.end(), [](char c) { return c >= 'A' && c <= 'Z'; })) {
+            return false;
+        }
+        if(!name.empty() && name[0] == ':') {
+            // 伪首部必须在普通字段之前，且不能重复
+            if(regular_seen) return false;
+            if(name == ":method" && stream.method.empty()) stream.method = value;
+            else if(name == ":path" && stream.path.empty()) stream.path = value;
+            else if(name == ":scheme" && !has_scheme) has_scheme = true;
+            else if(name == ":authority" && stream.authority.empty()) stream.authority = value;
+            else return false;
+            continue;
+        }
+        regular_seen = true;
+        if(name == "connection" || name == "keep-alive" || name == "proxy-connection" ||
+           name == "transfer-encoding" || name == "upgrade" || (name == "te" && value != "trailers")) {
+            return false;
+        }
+        if(name == "content-type") stream.content_type = value;
+        // 没有 :authority 时按 host 字段选站点（RFC 9113 8.3.1）
+        else if(name == "host" && stream.authority.empty()) stream.authority = value;
+        else if(name == "priority") parse_priority_(stream, value);
+    }
+    return !stream.method.empty() && !stream.path.empty() && has_scheme && stream.method != "CONNECT";
+}
+
+void Http2Session::parse_priority_(Stream& stream, string_view value) {
+    // RFC 9218：u=0..7，数值越小越优先；i 表示可与同级流交错发送
+    while(!value.empty()) {
+        const size_t comma = value.find(',');
+        string_view item = value.substr(0, comma);
+        while(!item.empty() && item.front() == ' ') item.remove_prefix(1);
+        if(item.size() == 3 && item.substr(0, 2) == "u=" && item[2] >= '0' && item[2] <= '7') {
+            stream.urgency = item[2] - '0';
+        } else if(item == "i" || item == "i=?1") {
+            stream.incremental = true;
+        } else if(item == "i=?0") {
+            stream.incremental = false;
+        }
+        if(comma == string_view::npos) break;
+        value.remove_prefix(comma + 1);
+    }
+}
+
+void Http2Session::on_data_(uint8_t flags, uint32_t id, string_view payload, ChainBuffer& out) {
+    if(id == 0) {
+        fail_(PROTOCOL_ERROR, out);
+        return;
+    }
+    // 填充也计入流量控制
+    recv_unacked_ += payload.size();
+    const size_t frame_len = payload.size();
+    if(!strip_padding(flags, payload)) {
+        fail_(PROTOCOL_ERROR, out);
+        return;
+    }
+    auto it = streams_.find(id);
+    if(it == streams_.end() || it->second.remote_closed) {
+        if(id > last_stream_id_) fail_(PROTOCOL_ERROR, out);
+        else write_rst_stream_(out, id, STREAM_CLOSED);
+        return;
+    }
+    Stream& stream = it->second;
+    const size_t max_body_size = RuntimeConfig::local().max_body_size;
+    if(stream.body.size() + payload.size() <= max_body_size) {
+        stream.body.append(payload);
+    } else {
+        stream.body.resize(max_body_size + 1);
+    }
+    if(flags & FLAG_END_STREAM) {
+        stream.remote_closed = true;
+        dispatch_(stream, out);
+    } else if(frame_len > 0) {
+        write_window_update_(out, id, frame_len);
+    }
+}
+
+void Http2Session::on_window_update_(uint32_t id, string_view payload, ChainBuffer& out) {
+    if(payload.size() != 4) {
+        fail_(FRAME_SIZE_ERROR, out);
+        return;
+    }
+    const uint32_t increment = read_u32(payload.data()) & 0x7fffffff;
+    if(id == 0) {
+        if(increment == 0 || send_window_ + increment > kMaxWindow) {
+            fail_(increment == 0 ? PROTOCOL_ERROR : FLOW_CONTROL_ERROR, out);
+            return;
+        }
+        send_window_ += increment;
+        return;
+    }
+    auto it = streams_.find(id);
+    if(it == streams_.end()) {
+        if(id > last_stream_id_) fail_(PROTOCOL_ERROR, out);
+        return;
+    }
+    if(increment == 0) {
+        reset_stream_(id, PROTOCOL_ERROR, out);
+        return;
+    }
+    if(it->second.send_window + increment > kMaxWindow) {
+        reset_stream_(id, FLOW_CONTROL_ERROR, out);
+        return;
+    }
+    it->second.send_window += increment;
+}
+
+void Http2Session::on_priority_(uint32_t id, string_view payload, ChainBuffer& out) {
+    if(id == 0) {
+        fail_(PROTOCOL_ERROR, out);
+        return;
+    }
+    if(payload.size() != 5) {
+        reset_stream_(id, FRAME_SIZE_ERROR, out);
+        return;
+    }
+    const uint32_t parent = read_u32(payload.data()) & 0x7fffffff;
+    if(parent == id) {
+        reset_stream_(id, PROTOCOL_ERROR, out);
+        return;
+    }
+    // 对空闲流的 PRIORITY（如 nghttp 建立的分组锚点）不建流，依赖它们的流视为无依赖
+    auto it = streams_.find(id);
+    if(it == streams_.end()) return;
+    it->second.parent = parent;
+    it->second.weight = static_cast<uint8_t>(payload[4]) + 1;
+    it->second.incremental = true;
+}
+
+void Http2Session::on_rst_stream_(uint32_t id, string_view payload, ChainBuffer& out) {
+    if(id == 0 || id > last_stream_id_) {
+        fail_(PROTOCOL_ERROR, out);
+        return;
+    }
+    if(payload.size() != 4) {
+        fail_(FRAME_SIZE_ERROR, out);
+        return;
+    }
+    drop_stream_(id);
+}
+
+void Http2Session::dispatch_(Stream& stream, ChainBuffer& out) {
+    stream.dispatched = true;
+    LoopMetrics& metrics = LoopMetrics::local();
+    metrics.requests.add();
+
+    // 准入控制与 HTTP/1.1 相同，只是拒绝时回在该流上，不关闭连接；路径非法的也先计入限流再回 400
+    const bool valid_path = normalize_path(stream.path);
+    const bool dynamic = valid_path && Router::instance()->uses_db(stream.method, stream.path);
+    if(!RateLimiter::instance()->allow(client_ip_,
+                                       dynamic ? RateLimiter::RouteClass::dynamic
+                                               : RateLimiter::RouteClass::static_file,
+                                       stream.start_ns)) {
+        metrics.rate_limited.add();
+        respond_text_(stream, 429, out);
+        return;
+    }
+    limiter_ = &ConcurrencyLimiter::local();
+    if((dynamic && SqlConnPool::instance()->get_free_count() == 0) ||
+       !limiter_->try_acquire(dynamic ? ConcurrencyLimiter::Priority::low : ConcurrencyLimiter::Priority::high)) {
+        metrics.shed.add();
+        respond_text_(stream, 503, out);
+        return;
+    }
+    stream.admitted = true;
+
+    if(!valid_path) {
+        respond_text_(stream, 400, out);
+        return;
+    }
+    if(stream.body.size() > RuntimeConfig::local().max_body_size) {
+        respond_text_(stream, 413, out);
+        return;
+    }
+    if(stream.path == "/metrics") {
+        metrics_streams_.push_back(stream.id);
+        return;
+    }
+    HttpRequest request;
+    request.assign(stream.method, stream.path, stream.content_type, std::move(stream.body));
+    Router::Result route = Router::instance()->dispatch(request);
+    if(route.stream) {
+        // 流式响应只接到 HTTP/1.x 的写路径上
+        respond_text_(stream, 501, out);
+        return;
+    }
+    respond_file_(stream, route.root_fd, request.path(), route.status ? route.status : 200, out);
+}
+
+void Http2Session::respond_file_(Stream& stream, int root_fd, string& path, int code, ChainBuffer& out) {
+    const VirtualHost& host = VhostTable::instance()->find(stream.authority);
+    HttpResponse response;
+    response.init(host, path, false, code, 0, root_fd);
+    response.resolve();
+    if(response.map_file()) {
+        send_response_(stream, response.code(), response.content_type(), response.file(),
+                       response.get_file_len(), out, response.code() == 200 ? host.cache_control() : "");
+        return;
+    }
+    const string body = response.error_body("File NotFound!");
+    send_response_(stream, response.code(), "text/html", make_block(body), body.size(), out);
+}
+
+void Http2Session::respond_text_(Stream& stream, int code, ChainBuffer& out) {
+    const StatusEntry* status = find_status(code);
+    string body(status ? status->reason : "Error");
+    body += '\n';
+    send_response_(stream, code, DEFAULT_MIME_TYPE, make_block(body), body.size(), out);
+}
+
+void Http2Session::send_response_(Stream& stream, int code, string_view type,
+                                  ChainBuffer::SharedBlock body, size_t len, ChainBuffer& out,
+                                  string_view cache_control) {
+    char num[24];
+    string block;
+    encoder_.begin(block);
+    encoder_.encode(block, ":status", string_view(num, std::to_chars(num, num + sizeof(num), code).ptr - num));
+    encoder_.encode(block, "content-type", type);
+    encoder_.encode(block, "content-length", string_view(num, std::to_chars(num, num + sizeof(num), len).ptr - num), false);
+    encoder_.encode(block, "date", HttpDate::value());
+    if(code == 429 || code == 503) encoder_.encode(block, "retry-after", "1");
+    if(!cache_control.empty()) encoder_.encode(block, "cache-control", cache_control);
+
+    stream.responded = true;
+    stream.data = std::move(body);
+    stream.pos = stream.data.get();
+    stream.remaining = stream.method == "HEAD" ? 0 : len;
+    // 新开始发送的流从当前虚拟时间起步，不会因为来得晚而独占带宽
+    stream.pass = std::max(stream.pass, vtime_);
+    LoopMetrics::local().count_status(code);
+
+    write_headers_(out, stream.id, block, stream.remaining == 0);
+    if(stream.remaining == 0) finish_stream_(stream, out);
+}
+
+void Http2Session::flush(ChainBuffer& out) {
+    while(!failed_ && out.readable_bytes() < kWriteBudget) {
+        Stream* stream = pick_();
+        if(!stream) break;
+        const size_t n = std::min<size_t>({stream->remaining, peer_max_frame_,
+                                            static_cast<size_t>(stream->send_window),
+                                            static_cast<size_t>(send_window_)});
+        const bool last = n == stream->remaining;
+        write_frame_header_(out, n, DATA, last ? FLAG_END_STREAM : 0, stream->id);
+        out.append_ref(stream->data, stream->pos, n);
+        stream->pos += n;
+        stream->remaining -= n;
+        stream->send_window -= n;
+        send_window_ -= n;
+        // 按权重推进虚拟时间：权重越大，每字节推进越少，分到的带宽越多
+        stream->pass += (n << 8) / stream->weight;
+        vtime_ = std::max(vtime_, stream->pass);
+        if(last) finish_stream_(*stream, out);
+    }
+}
+
+Http2Session::Stream* Http2Session::pick_() {
+    if(send_window_ <= 0) return nullptr;
+    auto sendable = [](const Stream& s) {
+        return s.responded && s.remaining > 0 && s.send_window > 0;
+    };
+    Stream* best = nullptr;
+    for(auto& [id, stream] : streams_) {
+        if(!sendable(stream)) continue;
+        // 依赖的流自己还能发送时让出；父流被流量控制卡住时子流可以先发
+        if(stream.parent) {
+            auto parent = streams_.find(stream.parent);
+            if(parent != streams_.end() && sendable(parent->second)) continue;
+        }
+        if(!best) {
+            best = &stream;
+            continue;
+        }
+        // urgency 小的优先；同级中非增量的流按 id 顺序逐个发完，增量的流按虚拟时间轮转
+        if(stream.urgency != best->urgency) {
+            if(stream.urgency < best->urgency) best = &stream;
+        } else if(stream.incremental != best->incremental) {
+            if(!stream.incremental) best = &stream;
+        } else if(stream.incremental && stream.pass < best->pass) {
+            best = &stream;
+        }
+    }
+    return best;
+}
+
+void Http2Session::finish_stream_(Stream& stream, ChainBuffer& out) {
+    const uint64_t latency = metrics_now_ns() - stream.start_ns;
+    LoopMetrics::local().latency.record(latency);
+    if(stream.admitted) {
+        stream.admitted = false;
+        limiter_->release(latency, false);
+    }
+    if(!stream.remote_closed) {
+        // 响应已完整，请对端不必再发送请求正文
+        write_rst_stream_(out, stream.id, NO_ERROR);
+    }
+    streams_.erase(stream.id);
+}
+
+void Http2Session::reset_stream_(uint32_t id, uint32_t code, ChainBuffer& out) {
+    write_rst_stream_(out, id, code);
+    drop_stream_(id);
+}
+
+void Http2Session::drop_stream_(uint32_t id) {
+    auto it = streams_.find(id);
+    if(it == streams_.end()) return;
+    if(it->second.admitted) limiter_->release(0, true);
+    streams_.erase(it);
+}
+
+void Http2Session::fail_(uint32_t code, ChainBuffer& out) {
+    if(failed_) return;
+    LOG_WARN("HTTP/2 connection error %u", code);
+    write_goaway_(out, code);
+    failed_ = true;
+}
+
+void Http2Session::shutdown(ChainBuffer& out) {
+    if(goaway_sent_) return;
+    write_goaway_(out, NO_ERROR);
+}
+
+bool Http2Session::is_open() const {
+    if(failed_) return false;
+    return !((goaway_sent_ || peer_goaway_) && streams_.empty());
+}
+
+bool Http2Session::take_metrics_request() {
+    if(metrics_streams_.size() == metrics_requested_) return false;
+    metrics_requested_ = metrics_streams_.size();
+    return true;
+}
+
+void Http2Session::write_metrics(string_view body, ChainBuffer& out) {
+    auto block = make_block(body);
+    for(uint32_t id : metrics_streams_) {
+        auto it = streams_.find(id);
+        if(it == streams_.end()) continue;
+        send_response_(it->second, 200, DEFAULT_MIME_TYPE, block, body.size(), out);
+    }
+    metrics_streams_.clear();
+    metrics_requested_ = 0;
+}
+
+void Http2Session::close() {
+    for(auto& [id, stream] : streams_) {
+        if(stream.admitted) limiter_->release(0, true);
+    }
+    streams_.clear();
+    metrics_streams_.clear();
+    metrics_requested_ = 0;
+}
+
+void Http2Session::write_frame_header_(ChainBuffer& out, size_t len, uint8_t type, uint8_t flags, uint32_t id) {
+    char h[9];
+    h[0] = static_cast<char>(len >> 16);
+    h[1] = static_cast<char>(len >> 8);
+    h[2] = static_cast<char>(len);
+    h[3] = static_cast<char>(type);
+    h[4] = static_cast<char>(flags);
+    put_u32(h + 5, id);
+    out.append(h, sizeof(h));
+}
+
+void Http2Session::write_settings_(ChainBuffer& out) {
+    char p[12];
+    p[0] = 0;
+    p[1] = SETTINGS_MAX_CONCURRENT_STREAMS;
+    put_u32(p + 2, kMaxConcurrentStreams);
+    p[6] = 0;
+    p[7] = SETTINGS_MAX_HEADER_LIST_SIZE;
+    put_u32(p + 8, static_cast<uint32_t>(std::min<size_t>(HttpRequest::max_header_size, UINT32_MAX)));
+    write_frame_header_(out, sizeof(p), SETTINGS, 0, 0);
+    out.append(p, sizeof(p));
+}
+
+void Http2Session::write_headers_(ChainBuffer& out, uint32_t id, string_view block, bool end_stream) {
+    // 超过对端最大帧长的头部块拆成 HEADERS + CONTINUATION
+    uint8_t type = HEADERS;
+    uint8_t flags = end_stream ? FLAG_END_STREAM : 0;
+    do {
+        const size_t n = std::min<size_t>(block.size(), peer_max_frame_);
+        if(n == block.size()) flags |= FLAG_END_HEADERS;
+        write_frame_header_(out, n, type, flags, id);
+        out.append(block.substr(0, n));
+        block.remove_prefix(n);
+        type = CONTINUATION;
+        flags = 0;
+    } while(!block.empty());
+}
+
+void Http2Session::write_window_update_(ChainBuffer& out, uint32_t id, uint32_t increment) {
+    char p[4];
+    put_u32(p, increment);
+    write_frame_header_(out, sizeof(p), WINDOW_UPDATE, 0, id);
+    out.append(p, sizeof(p));
+}
+
+void Http2Session::write_rst_stream_(ChainBuffer& out, uint32_t id, uint32_t code) {
+    char p[4];
+    put_u32(p, code);
+    write_frame_header_(out, sizeof(p), RST_STREAM, 0, id);
+    out.append(p, sizeof(p));
+}
+
+void Http2Session::write_goaway_(ChainBuffer& out, uint32_t code) {
+    char p[8];
+    put_u32(p, last_stream_id_);
+    put_u32(p + 4, code);
+    write_frame_header_(out, sizeof(p), GOAWAY, 0, 0);
+    out.append(p, sizeof(p));
+    goaway_sent_ = true;
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../buffer/buffer.h"
+#include "../buffer/chainbuffer.h"
+#include "../limiter/concurrencylimiter.h"
+#include "hpack.h"
+#include "httprequest.h"
+
+// HTTP/2（h2c）会话：帧解析、HPACK、流状态、流量控制和 DATA 帧调度
+// 只在连接所属的 IO 线程中使用；输入取自连接的读缓冲区，输出的帧追加到写缓冲区
+// 静态文件的 DATA 帧直接引用 mmap 的文件块，不拷贝
+class Http2Session {
+public:
+    static constexpr std::string_view kPreface = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+    explicit Http2Session(uint32_t client_ip);
+    ~Http2Session();
+
+    Http2Session(const Http2Session&) = delete;
+    Http2Session& operator=(const Http2Session&) = delete;
+
+    // 先验知识（prior knowledge）方式：客户端直接发送前言，服务端回 SETTINGS
+    void start(ChainBuffer& out);
+
+    // h2c 升级：settings 为 HTTP2-Settings 头的值，请求作为流 1 处理
+    // 校验失败返回 false 且不写任何数据，调用方按 HTTP/1.1 继续处理
+    bool upgrade(std::string_view settings, const HttpRequest& request, ChainBuffer& out);
+
+    // 消费读缓冲区中完整的帧，不完整的帧留在缓冲区中
+    void on_read(Buffer& in, ChainBuffer& out);
+
+    // 按优先级生成 DATA 帧，直到写缓冲区达到 kWriteBudget 或没有可发送的数据
+    void flush(ChainBuffer& out);
+
+    // 排空：发送 GOAWAY，不再接受新流，已有的流发完为止
+    void shutdown(ChainBuffer& out);
+
+    // /metrics 流在主循环抓取后回填；每批新请求只返回一次 true
+    bool take_metrics_request();
+    void write_metrics(std::string_view body, ChainBuffer& out);
+
+    // 为 false 时写完缓冲区即可关闭连接
+    bool is_open() const;
+    bool is_idle() const { return streams_.empty(); }
+
+    // 连接关闭，释放未完成的流占用的并发名额
+    void close();
+
+private:
+    enum FrameType : uint8_t {
+        DATA = 0x0,
+        HEADERS = 0x1,
+        PRIORITY = 0x2,
+        RST_STREAM = 0x3,
+        SETTINGS = 0x4,
+        PUSH_PROMISE = 0x5,
+        PING = 0x6,
+        GOAWAY = 0x7,
+        WINDOW_UPDATE = 0x8,
+        CONTINUATION = 0x9,
+    };
+
+    enum ErrorCode : uint32_t {
+        NO_ERROR = 0x0,
+        PROTOCOL_ERROR = 0x1,
+        INTERNAL_ERROR = 0x2,
+        FLOW_CONTROL_ERROR = 0x3,
+        STREAM_CLOSED = 0x5,
+        FRAME_SIZE_ERROR = 0x6,
+        REFUSED_STREAM = 0x7,
+        CANCEL = 0x8,
+        COMPRESSION_ERROR = 0x9,
+        ENHANCE_YOUR_CALM = 0xb,
+    };
+
+    static constexpr uint32_t kMaxFrameSize = 16384;            // 本端接收的最大帧，使用协议默认值
+    static constexpr uint32_t kMaxConcurrentStreams = 128;
+    static constexpr size_t kMaxHeaderBlock = 64 * 1024;
+    static constexpr size_t kWriteBudget = 128 * 1024;          // 单次 flush 最多排入写缓冲区的字节
+    static constexpr int64_t kMaxWindow = 0x7fffffff;
+
+    struct Stream {
+        uint32_t id = 0;
+        bool remote_closed = false;     // 已收到 END_STREAM
+        bool dispatched = false;        // 请求已交给处理逻辑
+        bool responded = false;         // 响应头已发出
+        std::string method;
+        std::string path;
+        std::string authority;          // 选站点，升级来的流取 Host 头
+        std::string content_type;
+        std::string body;
+
+        // 响应正文：文件映射或内存生成的块
+        ChainBuffer::SharedBlock data;
+        const char* pos = nullptr;
+        size_t remaining = 0;
+        int64_t send_window = 0;
+
+        // 调度：RFC 9218 的 urgency/incremental，RFC 7540 的依赖与权重
+        uint32_t parent = 0;
+        uint16_t weight = 16;
+        uint8_t urgency = 3;
+        bool incremental = false;
+        uint64_t pass = 0;              // 加权轮转的虚拟时间
+
+        uint64_t start_ns = 0;
+        bool admitted = false;
+    };
+
+    // 正在接收的头部块（HEADERS 后跟 CONTINUATION）
+    struct PendingHeaders {
+        uint32_t stream = 0;
+        bool end_stream = false;
+        bool has_priority = false;
+        uint32_t parent = 0;
+        uint16_t weight = 16;
+        std::string block;
+    };
+
+    void handle_frame_(uint8_t type, uint8_t flags, uint32_t id, std::string_view payload, ChainBuffer& out);
+    void on_headers_(uint8_t flags, uint32_t id, std::string_view payload, ChainBuffer& out);
+    void on_continuation_(uint8_t flags, uint32_t id, std::string_view payload, ChainBuffer& out);
+    void on_data_(uint8_t flags, uint32_t id, std::string_view payload, ChainBuffer& out);
+    void on_settings_(uint8_t flags, uint32_t id, std::string_view payload, ChainBuffer& out);
+    void on_window_update_(uint32_t id, std::string_view payload, ChainBuffer& out);
+    void on_priority_(uint32_t id, std::string_view payload, ChainBuffer& out);
+    void on_rst_stream_(uint32_t id, std::string_view payload, ChainBuffer& out);
+    void finish_headers_(ChainBuffer& out);
+
+    uint32_t apply_settings_(std::string_view payload);
+    bool parse_request_(Stream& stream, const HeaderList& headers);
+    static void parse_priority_(Stream& stream, std::string_view value);
+
+    void dispatch_(Stream& stream, ChainBuffer& out);
+    void respond_file_(Stream& stream, int root_fd, std::string& path, int code, ChainBuffer& out);
+    void respond_text_(Stream& stream, int code, ChainBuffer& out);
+    void send_response_(Stream& stream, int code, std::string_view type,
+                        ChainBuffer::SharedBlock body, size_t len, ChainBuffer& out,
+                        std::string_view cache_control = {});
+    void finish_stream_(Stream& stream, ChainBuffer& out);
+    void reset_stream_(uint32_t id, uint32_t code, ChainBuffer& out);
+    void drop_stream_(uint32_t id);
+    void fail_(uint32_t code, ChainBuffer& out);
+
+    Stream* pick_();
+
+    static void write_frame_header_(ChainBuffer& out, size_t len, uint8_t type, uint8_t flags, uint32_t id);
+    void write_settings_(ChainBuffer& out);
+    void write_headers_(ChainBuffer& out, uint32_t id, std::string_view block, bool end_stream);
+    static void write_window_update_(ChainBuffer& out, uint32_t id, uint32_t increment);
+    static void write_rst_stream_(ChainBuffer& out, uint32_t id, uint32_t code);
+    void write_goaway_(ChainBuffer& out, uint32_t code);
+
+    const uint32_t client_ip_;
+
+    bool preface_received_ = false;
+    bool settings_received_ = false;
+    bool goaway_sent_ = false;
+    bool peer_goaway_ = false;
+    bool failed_ = false;               // 连接错误，GOAWAY 写完即关闭
+
+    // 对端的 SETTINGS
+    uint32_t peer_max_frame_ = 16384;
+    int64_t peer_initial_window_ = 65535;
+
+    int64_t send_window_ = 65535;       // 连接级发送窗口
+    uint32_t recv_unacked_ = 0;         // 已收到但尚未通过 WINDOW_UPDATE 归还的字节
+
+    uint32_t last_stream_id_ = 0;
+    uint64_t vtime_ = 0;
+    std::map<uint32_t, Stream> streams_;
+    PendingHeaders pending_;
+    uint32_t continuation_stream_ = 0;  // 非 0 时下一帧必须是该流的 CONTINUATION
+
+    std::vector<uint32_t> metrics_streams_;
+    size_t metrics_requested_ = 0;
+
+    HpackDecoder decoder_;
+    HpackEncoder encoder_;
+    ConcurrencyLimiter* limiter_ = nullptr;
+};
@@ -1,13 +1,21 @@
 #include "httpconn.h"
+#include <algorithm>
+
+#include "urlpath.h"
 
-const char* HttpConn::src_dir = nullptr;
-std::atomic<int> HttpConn::user_count{0};
 bool HttpConn::is_et = false;
+std::atomic<bool> HttpConn::is_draining{false};
+
+namespace {
+// 每个线程缓存的空闲 Active 个数；更多的连接同时忙时按需分配
+constexpr size_t kActiveCache = 64;
+// 读缓冲区被大请求撑大后不再放回缓存
+constexpr size_t kActiveReadCapacity = 16 * 1024;
+}  // namespace
 
 HttpConn::HttpConn() { 
     fd_ = -1;
     addr_ = { 0 };
-    iov_count_ = 0;
     is_closed_ = true;
 };
 
@@ -15,86 +23,561 @@ HttpConn::~HttpConn() {
     close(); 
 };
 
-void HttpConn::init(int fd, const sockaddr_in& addr) {
+void HttpConn::init(int fd, const sockaddr_in& addr, bool conn_counted) {
     assert(fd > 0);
-    user_count++;
+    generation_.fetch_add(1, std::memory_order_release);
+    wants_metrics_ = false;
+    request_start_ns_ = 0;
+    accept_ns_ = metrics_now_ns();
+    body_start_ns_ = 0;
+    admitted_ = false;
+    shed_ = false;
+    in_request_ = false;
+    read_pending_ = false;
+    output_paused_ = false;
+    bytes_written_ = 0;
+    requests_ = 0;
+    stream_.reset();
+    h2_.reset();
+    ws_.reset();
+    ws_messages_.clear();
+    ws_hub_ = nullptr;
+    tls_.reset();
+    if(TlsContext::instance()->enabled()) {
+        tls_ = std::make_unique<TlsConn>(fd);
+    }
     addr_ = addr;
+    conn_counted_ = conn_counted;
     fd_ = fd;
-    write_buffer_.retrieve_all();
-    read_buffer_.retrieve_all();
+    // 新连接在第一个字节到达前处于空闲状态
+    if(active_) release_active_(std::move(active_));
     is_closed_ = false;
-    LOG_INFO("Client[%d](%s:%d) in, user_count:%d", fd_, get_ip(), get_port(), (int)user_count);
+    LOG_INFO("Client[%d](%s:%d) in, user_count:%d", fd_, get_ip(), get_port(), user_count());
 }
 
 void HttpConn::close() {
-    response_.unmap_file();
+    // 释放正文接收方，未收完的上传文件随之删除
+    if(active_) release_active_(std::move(active_));
+    in_request_ = false;
+    stream_.reset();
+    if(h2_) {
+        h2_->close();
+    }
+    // 订阅表只在所属 IO 线程中修改；在别的线程关闭时留给该线程的心跳按 generation 清理
+    if(ws_hub_ && ws_hub_ == &WsHub::local()) {
+        ws_hub_->unsubscribe(ws_->topic(), this);
+        ws_hub_ = nullptr;
+    }
+    if(admitted_) {
+        admitted_ = false;
+        limiter_->release(0, true);
+    }
     if(is_closed_ == false){
         is_closed_ = true; 
-        user_count--;
+        LoopMetrics::local().conns_closed.add();
+        if(conn_counted_) {
+            conn_counted_ = false;
+            RateLimiter::instance()->release_conn(addr_.sin_addr.s_addr);
+        }
+        if(tls_) {
+            tls_->shutdown();
+            tls_.reset();
+        }
         ::close(fd_);
-        LOG_INFO("Client[%d](%s:%d) quit, user_count:%d", fd_, get_ip(), get_port(), (int)user_count);
+        LOG_INFO("Client[%d](%s:%d) quit, user_count:%d", fd_, get_ip(), get_port(), user_count());
     }
 }
 
 ssize_t HttpConn::read(int* saveErrno) {
     ssize_t len = -1;
-    do {
-        len = read_buffer_.read_fd(fd_, saveErrno);
+    if(!active_) {
+        unpark_();
+    }
+    if(read_paused()) {
+        // ET 下 EPOLLIN 一直注册着，积压时来了新数据也不读，等恢复后由调用方排进就绪队列
+        read_pending_ = true;
+        *saveErrno = EAGAIN;
+        return -1;
+    }
+    if(!in_request_ && active_->read_buffer.readable_bytes() == 0) {
+        request_start_ns_ = metrics_now_ns();
+    }
+    LoopMetrics& metrics = LoopMetrics::local();
+    // 一个快的客户端不能独占循环：预算用完就停下，由调用方排到其他连接之后
+    const size_t budget = RuntimeConfig::local().io_budget;
+    size_t total = 0;
+    int rounds = 0;
+    read_pending_ = false;
+    for(;;) {
+        if(!tls_ && active_->read_buffer.readable_bytes() == 0 && active_->request.can_splice()) {
+            // 上传的正文从 socket 直接 splice 给接收方，不经过读缓冲区
+            len = active_->request.splice_body(fd_, saveErrno);
+        } else {
+            len = tls_ ? tls_->read(active_->read_buffer, saveErrno, budget - total)
+                       : active_->read_buffer.read_fd(fd_, saveErrno);
+        }
         if (len <= 0) {
             break;
         }
-    } while (is_et);
+        metrics.bytes_in.add(len);
+        total += len;
+        if (!is_et) {
+            break;
+        }
+        if (read_paused() || total >= budget || ++rounds >= kIoRounds) {
+            read_pending_ = true;
+            break;
+        }
+    }
+    // 解密后没读完的记录留在 OpenSSL 中，socket 不会再通知（LT 下也一样）
+    if(tls_ && len > 0 && tls_->has_pending()) read_pending_ = true;
     return len;
 }
 
 ssize_t HttpConn::write(int* saveErrno) {
     ssize_t len = -1;
+    if(!active_) {
+        return 0;
+    }
+    LoopMetrics& metrics = LoopMetrics::local();
+    // 大文件下载每轮只发一份预算，其余连接的请求不用排在它后面
+    const size_t budget = RuntimeConfig::local().io_budget;
+    size_t total = 0;
+    int rounds = 0;
     do {
-        len = writev(fd_, iov_, iov_count_);
+        len = tls_ ? tls_->write(active_->write_buffer, saveErrno, budget - total)
+                   : active_->write_buffer.write_fd(fd_, saveErrno, budget - total);
         if(len <= 0) {
-            *saveErrno = errno;
             break;
         }
-        if(iov_[0].iov_len + iov_[1].iov_len == 0) break; 
-        else if(static_cast<size_t>(len) > iov_[0].iov_len) {
-            iov_[1].iov_base = (uint8_t*) iov_[1].iov_base + (len - iov_[0].iov_len);
-            iov_[1].iov_len -= (len - iov_[0].iov_len);
-            if(iov_[0].iov_len) {
-                write_buffer_.retrieve_all();
-                iov_[0].iov_len = 0;
-            }
-        }
-        else {
-            iov_[0].iov_base = (uint8_t*)iov_[0].iov_base + len; 
-            iov_[0].iov_len -= len; 
-            write_buffer_.retrieve(len);
-        }
-    } while(is_et || get_write_bytes() > 10240);
+        metrics.bytes_out.add(len);
+        total += len;
+        bytes_written_ += len;
+        // 流式响应降到低水位才继续生成，每次补一大批，而不是发一点补一点
+        if(stream_ && get_write_bytes() <= write_low_water_()) pump_stream_();
+        if(get_write_bytes() == 0) break; 
+    } while(total < budget && ++rounds < kIoRounds);
+    update_output_();
     return len;
 }
 
 bool HttpConn::process() {
-    request_.init();
-    if(read_buffer_.readable_bytes() <= 0) {
+    const bool ready = process_input_();
+    update_output_();
+    return ready;
+}
+
+bool HttpConn::process_input_() {
+    if(h2_) {
+        return process_h2_();
+    }
+    if(ws_) {
+        return process_ws_();
+    }
+    // 前一个响应还没发完：流水线中的后续请求留在读缓冲区，写完后再处理
+    if(!active_ || wants_metrics_ || active_->write_buffer.readable_bytes() > 0) {
         return false;
     }
-    else if(request_.parse(read_buffer_)) {
-        LOG_DEBUG("%s", request_.path().c_str());
-        response_.init(src_dir, request_.path(), request_.is_keep_alive(), 200);
-    } else {
-        response_.init(src_dir, request_.path(), false, 400);
+    LoopMetrics& metrics = LoopMetrics::local();
+    if(!in_request_) {
+        if(active_->read_buffer.readable_bytes() <= 0) {
+            park_();
+            return false;
+        }
+        // 以 HTTP/2 连接前言开头：h2c 先验知识方式
+        const auto view = active_->read_buffer.readable_view();
+        const std::string_view head(view.data(), std::min(view.size(), Http2Session::kPreface.size()));
+        if(Http2Session::kPreface.starts_with(head)) {
+            if(head.size() < Http2Session::kPreface.size()) {
+                return false;
+            }
+            h2_ = std::make_unique<Http2Session>(addr_.sin_addr.s_addr);
+            h2_->start(active_->write_buffer);
+            return process_h2_();
+        }
+        // 准入按请求行匹配的路由分类，等请求行收全；超长的交给解析回 431
+        if(std::string_view(view.data(), view.size()).find("\r\n") == std::string_view::npos &&
+           view.size() < HttpRequest::max_header_size) {
+            return false;
+        }
+        metrics.requests.add();
+        if(request_start_ns_ == 0) {
+            // 流水线中的后续请求，以开始处理的时刻计
+            request_start_ns_ = metrics_now_ns();
+        }
+        shed_ = false;
+        if(const int code = admit_()) {
+            // 限流或过载：不解析，直接回预先生成的响应，写完后关闭连接
+            shed_ = true;
+            active_->read_buffer.retrieve_all();
+            active_->write_buffer.append(HttpResponse::reject_response(code));
+            (code == 429 ? metrics.rate_limited : metrics.shed).add();
+            metrics.count_status(code);
+            return true;
+        }
+        in_request_ = true;
+    }
+    WS_TRACE(parse, fd_);
+    const HttpRequest::HttpCode code = active_->request.parse(active_->read_buffer);
+    if(code == HttpRequest::HttpCode::NO_REQUEST) {
+        // 请求还没收完；客户端带 Expect: 100-continue 时先让它发正文
+        if(active_->request.take_expect_continue()) {
+            active_->write_buffer.append(std::string_view("HTTP/1.1 100 Continue\r\n\r\n"));
+            return true;
+        }
+        if(body_start_ns_ == 0 && active_->request.in_body()) {
+            body_start_ns_ = metrics_now_ns();
+        }
+        return false;
+    }
+    in_request_ = false;
+    body_start_ns_ = 0;
+    ++requests_;
+    if(code != HttpRequest::HttpCode::GET_REQUEST) {
+        // 出错之后的字节无法再分帧，回错误响应后关闭连接
+        metrics.parse_errors.add();
+        shed_ = true;
+        active_->read_buffer.retrieve_all();
+        int status = 400;
+        switch(code) {
+            case HttpRequest::HttpCode::ENTITY_TOO_LARGE: status = 413; break;
+            case HttpRequest::HttpCode::HEADER_TOO_LARGE: status = 431; break;
+            case HttpRequest::HttpCode::NOT_IMPLEMENTED: status = 501; break;
+            case HttpRequest::HttpCode::INTERNAL_ERROR: status = 500; break;
+            default: break;
+        }
+        respond_status_(status, false);
+        return true;
+    }
+    LOG_DEBUG("%s", active_->request.path().c_str());
+    if(active_->request.is_websocket()) {
+        return upgrade_ws_();
+    }
+    if(active_->request.header("upgrade") == "h2c" && upgrade_h2_()) {
+        return true;
+    }
+    if(const int status = active_->request.sink_status()) {
+        // 正文已由接收方处理（如上传落盘），只回状态
+        WS_TRACE(respond, fd_);
+        respond_status_(status, is_keep_alive());
+        return true;
+    }
+    if(active_->request.path() == "/metrics") {
+        active_->response.init(VhostTable::instance()->default_host(), active_->request.path(), is_keep_alive(), 200,
+                               keep_alive_remaining_());
+        active_->response.set_head(active_->request.method() == "HEAD");
+        wants_metrics_ = true;
+        return true;
+    }
+    Router::Result route = Router::instance()->dispatch(active_->request);
+    if(route.stream) {
+        WS_TRACE(respond, fd_);
+        stream_ = std::move(route.stream);
+        active_->writer.reset(active_->request.version() != "1.0", is_keep_alive(), keep_alive_remaining_(),
+                              active_->request.method() == "HEAD");
+        pump_stream_();
+        metrics.count_status(active_->writer.code());
+        return true;
     }
+    // 没有匹配的路由时 status 为 404/405，回对应站点的错误页
+    const VirtualHost& host = VhostTable::instance()->find(active_->request.header("host"));
+    active_->response.init(host, active_->request.path(), is_keep_alive(), route.status ? route.status : 200,
+                           keep_alive_remaining_(), route.root_fd);
+    active_->response.set_head(active_->request.method() == "HEAD");
 
-    response_.make_response(write_buffer_);
-    iov_[0].iov_base = const_cast<char*>(write_buffer_.readable_view().data());
-    iov_[0].iov_len = write_buffer_.readable_bytes();
-    iov_count_ = 1;
+    WS_TRACE(respond, fd_);
+    active_->response.make_response(active_->write_buffer);
+    metrics.count_status(active_->response.code());
+    LOG_DEBUG("filesize:%d, to %d", active_->response.get_file_len(), get_write_bytes());
+    return true;
+}
+
+bool HttpConn::process_h2_() {
+    // 每个流的延迟由会话记录
+    request_start_ns_ = 0;
+    if(is_draining) {
+        h2_->shutdown(active_->write_buffer);
+    }
+    WS_TRACE(parse, fd_);
+    h2_->on_read(active_->read_buffer, active_->write_buffer);
+    WS_TRACE(respond, fd_);
+    h2_->flush(active_->write_buffer);
+    wants_metrics_ = h2_->take_metrics_request();
+    // 只有 /metrics 流时没有要写的数据，也要返回 true 让调用方去抓取
+    return active_->write_buffer.readable_bytes() > 0 || wants_metrics_;
+}
+
+bool HttpConn::process_ws_() {
+    request_start_ns_ = 0;
+    if(is_draining) {
+        ws_->close(1001, active_->write_buffer);
+    }
+    WS_TRACE(parse, fd_);
+    ws_->on_read(active_->read_buffer, active_->write_buffer, ws_messages_);
+    return active_->write_buffer.readable_bytes() > 0 || !ws_messages_.empty();
+}
+
+bool HttpConn::upgrade_ws_() {
+    WS_TRACE(respond, fd_);
+    active_->write_buffer.append(WebSocket::handshake_response(active_->request.header("sec-websocket-key")));
+    LoopMetrics::local().count_status(101);
+    // 升级请求到此结束，长连接不占并发名额
+    finish_request();
+    ws_ = std::make_unique<WebSocket>(active_->request.path());
+    ws_hub_ = &WsHub::local();
+    ws_hub_->subscribe(ws_->topic(), this, generation());
+    // 客户端可能紧跟着握手发来了帧
+    process_ws_();
+    return true;
+}
 
-    if(response_.get_file_len() > 0  && response_.get_file()) {
-        iov_[1].iov_base = response_.get_file();
-        iov_[1].iov_len = response_.get_file_len();
-        iov_count_ = 2;
+bool HttpConn::upgrade_h2_() {
+    // 带正文的请求（不论方法）不升级，按 HTTP/1.1 处理
+    const std::string_view settings = active_->request.header("http2-settings");
+    if(settings.empty() || active_->request.has_body()) {
+        return false;
+    }
+    auto session = std::make_unique<Http2Session>(addr_.sin_addr.s_addr);
+    if(!session->upgrade(settings, active_->request, active_->write_buffer)) {
+        return false;
     }
-    LOG_DEBUG("filesize:%d, %d  to %d", response_.get_file_len() , iov_count_, get_write_bytes());
+    // 本次请求改由流 1 计数和准入
+    finish_request();
+    h2_ = std::move(session);
+    process_h2_();
     return true;
 }
+
+void HttpConn::write_metrics(std::string_view body) {
+    wants_metrics_ = false;
+    WS_TRACE(respond, fd_);
+    if(h2_) {
+        h2_->write_metrics(body, active_->write_buffer);
+        h2_->flush(active_->write_buffer);
+        return;
+    }
+    active_->response.make_body_response(active_->write_buffer, body);
+    LoopMetrics::local().count_status(active_->response.code());
+}
+
+void HttpConn::respond_status_(int code, bool keep_alive) {
+    std::string path;
+    active_->response.init(VhostTable::instance()->default_host(), path, keep_alive, code,
+                           keep_alive ? keep_alive_remaining_() : 0);
+    active_->response.set_head(active_->request.method() == "HEAD");
+    const StatusEntry* status = find_status(code);
+    std::string body(status ? status->reason : "Error");
+    body += '\n';
+    active_->response.make_body_response(active_->write_buffer, body);
+    LoopMetrics::local().count_status(code);
+}
+
+void HttpConn::pump_stream_() {
+    // 慢客户端的流式响应最多在写缓冲区中积压到高水位，剩下的等可写事件腾出空间再生成；
+    // 写缓冲合计超过 output_budget 时只积压到低水位
+    const RuntimeConfig& runtime = RuntimeConfig::local();
+    const bool over_budget = runtime.output_budget && BlockPool::in_use() > runtime.output_budget;
+    const size_t limit = over_budget ? write_low_water_() : runtime.write_high_water;
+    while(!active_->writer.finished() && active_->write_buffer.readable_bytes() < limit) {
+        const size_t before = active_->write_buffer.readable_bytes();
+        stream_->produce(active_->writer);
+        active_->writer.flush();
+        if(active_->write_buffer.readable_bytes() == before && !active_->writer.finished()) {
+            // 违反约定的生成方：不再调用，以免空转
+            LOG_WARN("Client[%d] response stream made no progress", fd_);
+            active_->writer.end();
+        }
+    }
+    if(active_->writer.finished()) {
+        stream_.reset();
+    }
+}
+
+size_t HttpConn::write_low_water_() {
+    const RuntimeConfig& runtime = RuntimeConfig::local();
+    return std::min(runtime.write_low_water, runtime.write_high_water);
+}
+
+void HttpConn::update_output_() {
+    const size_t pending = get_buffered_bytes();
+    if(!output_paused_ && pending >= RuntimeConfig::local().write_high_water) {
+        output_paused_ = true;
+        // 登记到本线程的积压表，写缓冲合计超限时从中挑出不读的客户端断开
+        backlog_().push_back({this, generation(), bytes_written_});
+    } else if(output_paused_ && pending <= write_low_water_()) {
+        output_paused_ = false;
+    }
+}
+
+std::vector<HttpConn::Backlogged>& HttpConn::backlog_() {
+    thread_local std::vector<Backlogged> backlog;
+    return backlog;
+}
+
+void HttpConn::collect_stalled(std::vector<HttpConn*>& stalled) {
+    auto& backlog = backlog_();
+    for(size_t i = 0; i < backlog.size();) {
+        Backlogged& entry = backlog[i];
+        HttpConn* conn = entry.conn;
+        if(conn->is_closed() || conn->generation() != entry.generation || !conn->output_paused_) {
+            entry = backlog.back();
+            backlog.pop_back();
+            continue;
+        }
+        // 两次检查之间一个字节都没发出去
+        if(conn->bytes_written_ == entry.written) stalled.push_back(conn);
+        entry.written = conn->bytes_written_;
+        ++i;
+    }
+    std::sort(stalled.begin(), stalled.end(), [](const HttpConn* a, const HttpConn* b) {
+        return a->get_buffered_bytes() > b->get_buffered_bytes();
+    });
+}
+
+HttpConn::Phase HttpConn::phase() const {
+    if(h2_ || ws_) return Phase::busy;
+    if(!active_) return requests_ == 0 ? Phase::connect : Phase::idle;
+    if(in_request_) return active_->request.in_body() ? Phase::body : Phase::header;
+    if(active_->write_buffer.readable_bytes() > 0 || wants_metrics_ || stream_) return Phase::busy;
+    // 收到了一部分 HTTP/2 连接前言；握手中的 TLS 连接还没有请求字节
+    if(active_->read_buffer.readable_bytes() > 0) return Phase::header;
+    return requests_ == 0 ? Phase::connect : Phase::idle;
+}
+
+int HttpConn::timeout_ms(uint64_t now_ns) const {
+    const RuntimeConfig& runtime = RuntimeConfig::local();
+    // 从 start_ns 起 limit_ms 到期，返回剩余的毫秒数
+    auto remaining = [now_ns](uint64_t start_ns, int64_t limit_ms) {
+        const int64_t left = limit_ms - static_cast<int64_t>(now_ns - std::min(start_ns, now_ns)) / 1000000;
+        return static_cast<int>(std::clamp<int64_t>(left, 0, INT32_MAX));
+    };
+    switch(phase()) {
+    case Phase::connect:
+        if(runtime.first_byte_timeout_ms > 0) return remaining(accept_ns_, runtime.first_byte_timeout_ms);
+        break;
+    case Phase::idle:
+        return runtime.timeout_ms > 0 ? runtime.keepalive_timeout_ms : kNoTimeout;
+    case Phase::header:
+        if(runtime.header_timeout_ms > 0 && request_start_ns_ != 0) {
+            return remaining(request_start_ns_, runtime.header_timeout_ms);
+        }
+        break;
+    case Phase::body:
+        if(runtime.body_timeout_ms > 0) {
+            int left = runtime.body_timeout_ms;
+            if(runtime.min_body_rate > 0 && body_start_ns_ != 0) {
+                // 每收到 min_body_rate 字节多给一秒
+                const uint64_t earned_ms = active_->request.body_received() * 1000 / runtime.min_body_rate;
+                left = std::min(left, remaining(body_start_ns_,
+                                                runtime.body_timeout_ms + static_cast<int64_t>(std::min<uint64_t>(earned_ms, INT32_MAX))));
+            }
+            return left;
+        }
+        break;
+    case Phase::busy:
+        break;
+    }
+    return runtime.timeout_ms > 0 ? runtime.timeout_ms : kNoTimeout;
+}
+
+void HttpConn::send_timeout() {
+    if(!active_ || active_->write_buffer.readable_bytes() > 0) return;
+    if(tls_ && !tls_->is_established()) return;
+    LoopMetrics::local().count_status(408);
+    active_->write_buffer.append(HttpResponse::reject_response(408));
+    int err = 0;
+    if(tls_) tls_->write(active_->write_buffer, &err);
+    else active_->write_buffer.write_fd(fd_, &err);
+}
+
+void HttpConn::finish_request() {
+    // 只发出了 100 Continue，请求还没结束
+    if(request_start_ns_ == 0 || in_request_) {
+        return;
+    }
+    const uint64_t latency = metrics_now_ns() - request_start_ns_;
+    LoopMetrics::local().latency.record(latency);
+    request_start_ns_ = 0;
+    if(admitted_) {
+        admitted_ = false;
+        limiter_->release(latency, false);
+    }
+}
+
+uint32_t HttpConn::keep_alive_remaining_() const {
+    const uint32_t max_requests = RuntimeConfig::local().keepalive_requests;
+    return max_requests > requests_ ? max_requests - requests_ : 0;
+}
+
+void HttpConn::unpark_() {
+    active_ = acquire_active_();
+}
+
+void HttpConn::park_() {
+    // TLS 握手还在进行时不归还，免得每个握手来回都换一次
+    if(tls_ && !tls_->is_established()) {
+        return;
+    }
+    release_active_(std::move(active_));
+}
+
+std::vector<std::unique_ptr<HttpConn::Active>>& HttpConn::active_cache_() {
+    thread_local std::vector<std::unique_ptr<Active>> cache;
+    return cache;
+}
+
+std::unique_ptr<HttpConn::Active> HttpConn::acquire_active_() {
+    auto& cache = active_cache_();
+    if(cache.empty()) {
+        return std::make_unique<Active>();
+    }
+    std::unique_ptr<Active> active = std::move(cache.back());
+    cache.pop_back();
+    return active;
+}
+
+void HttpConn::release_active_(std::unique_ptr<Active> active) {
+    active->request.init();
+    active->response.unmap_file();
+    active->write_buffer.retrieve_all();
+    active->read_buffer.retrieve_all();
+    auto& cache = active_cache_();
+    if(cache.size() < kActiveCache && active->read_buffer.capacity() <= kActiveReadCapacity) {
+        cache.push_back(std::move(active));
+    }
+}
+
+int HttpConn::admit_() {
+    // 只看请求行，不解析头部：匹配到访问数据库的路由（登录、注册）时，数据库连接用尽直接拒绝，
+    // 不让 IO 线程阻塞在连接池上
+    const auto view = active_->read_buffer.readable_view();
+    std::string_view line(view.data(), view.size());
+    line = line.substr(0, line.find("\r\n"));
+    bool dynamic = false;
+    if(const size_t sp = line.find(' '); sp != std::string_view::npos) {
+        const std::string_view method = line.substr(0, sp);
+        const std::string_view target = line.substr(sp + 1, line.find(' ', sp + 1) - sp - 1);
+        // 每个请求都要分类，规范化到栈上不分配；少见的超长路径才复制一份
+        char buf[1024];
+        size_t len = 0;
+        if(normalize_path(target, buf, sizeof(buf), len)) {
+            dynamic = Router::instance()->uses_db(method, std::string_view(buf, len));
+        } else if(target.size() > sizeof(buf)) {
+            std::string path(target);
+            dynamic = normalize_path(path) && Router::instance()->uses_db(method, path);
+        }
+    }
+    if(!RateLimiter::instance()->allow(addr_.sin_addr.s_addr,
+                                       dynamic ? RateLimiter::RouteClass::dynamic
+                                               : RateLimiter::RouteClass::static_file,
+                                       request_start_ns_)) {
+        return 429;
+    }
+    if(dynamic && SqlConnPool::instance()->get_free_count() == 0) {
+        return 503;
+    }
+    limiter_ = &ConcurrencyLimiter::local();
+    admitted_ = limiter_->try_acquire(dynamic ? ConcurrencyLimiter::Priority::low
+                                              : ConcurrencyLimiter::Priority::high);
+    return admitted_ ? 0 : 503;
+}
@@ -4,13 +4,26 @@
 #include <sys/uio.h>    
 #include <arpa/inet.h>   
 #include <atomic>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <string_view>
+#include <vector>
 
 #include "../log/log.h"
 #include "../buffer/buffer.h"
+#include "../buffer/chainbuffer.h"
+#include "../metrics/trace.h"
+#include "../limiter/concurrencylimiter.h"
+#include "../limiter/ratelimiter.h"
+#include "../tls/tlsconn.h"
+#include "../config/runtime.h"
 #include "httprequest.h"
 #include "httpresponse.h"
+#include "responsewriter.h"
+#include "router.h"
+#include "http2session.h"
+#include "websocket.h"
 
 class HttpConn {
 public:
@@ -20,44 +33,177 @@ public:
     HttpConn(const HttpConn&) = delete;
     HttpConn& operator=(const HttpConn&) = delete;
 
-    void init(int sock_fd, const sockaddr_in& addr);
+    // conn_counted：RateLimiter::acquire_conn 为该连接计了数，关闭时要释放
+    void init(int sock_fd, const sockaddr_in& addr, bool conn_counted);
 
+    // ET 下读到 EAGAIN、读缓冲区到高水位或用完本轮预算为止；写到写完、EAGAIN 或用完预算为止。
+    // 用完预算时返回值大于 0：读方向由 read_pending() 标出，写方向还有 get_write_bytes()
     ssize_t read(int* save_errno);
     ssize_t write(int* save_errno);
 
+    // 上次读没有读到 EAGAIN 就停下了，socket 中可能还有数据，ET 下不会再通知
+    bool read_pending() const { return read_pending_; }
+
     void close();
 
+    // 响应发送完毕，记录本次请求延迟
+    void finish_request();
+
     bool process();
 
+    // /metrics 请求：process() 只登记，由调用方在主循环抓取后填入正文
+    bool wants_metrics() const { return wants_metrics_; }
+    void write_metrics(std::string_view body);
+    // 每次 init 递增，跨线程回调据此判断连接是否已被关闭复用
+    // init 在主线程执行，定时器等回调在 IO 线程读取，release/acquire 配对
+    uint64_t generation() const { return generation_.load(std::memory_order_acquire); }
+    bool is_closed() const { return is_closed_; }
+
     int get_fd() const { return fd_; }
     int get_port() const { return addr_.sin_port; }
     const char* get_ip() const { return inet_ntoa(addr_.sin_addr); }
     sockaddr_in get_addr() const { return addr_; }
 
-    int get_write_bytes() const { 
-        return iov_[0].iov_len + iov_[1].iov_len; 
+    size_t get_write_bytes() const { 
+        return active_ ? active_->write_buffer.readable_bytes() : 0; 
+    }
+    // 其中占用内存的部分，mmap 的文件内容不计；写高低水位按它判断
+    size_t get_buffered_bytes() const {
+        return active_ ? active_->write_buffer.owned_bytes() : 0;
     }
 
     bool is_keep_alive() const {
-        return request_.is_keep_alive();
+        if(h2_) return h2_->is_open();
+        if(ws_) return ws_->is_open();
+        if(!active_) return !is_draining;
+        // 正文还在接收（刚发完 100 Continue）
+        if(in_request_) return true;
+        const uint32_t max_requests = RuntimeConfig::local().keepalive_requests;
+        return active_->request.is_keep_alive() && !is_draining && !shed_ &&
+               (max_requests == 0 || requests_ < max_requests);
+    }
+
+    // 没有读到一半的请求，也没有待发送的响应
+    bool is_idle() const {
+        if(!active_) return true;
+        return active_->read_buffer.readable_bytes() == 0 && active_->write_buffer.readable_bytes() == 0 &&
+               !wants_metrics_ && !in_request_ && !stream_ && (!h2_ || h2_->is_idle());
+    }
+
+    // 两个请求之间的 HTTP/1 长连接只保留连接本身，缓冲区和请求、响应对象还回线程的缓存，下一个字节到达时再取回
+    bool is_parked() const { return !active_; }
+
+    // 连接所处的阶段，各有各的时限：
+    // connect 建立连接（含 TLS 握手）到第一个请求的首字节；idle 两个请求之间；
+    // header 请求首字节到头部收完；body 接收正文；其余（发送响应、HTTP/2、WebSocket）为 busy
+    enum class Phase { connect, idle, header, body, busy };
+    Phase phase() const;
+    // 按当前阶段还剩多少毫秒到期：connect、header 从阶段开始算起，收到数据也不顺延；
+    // body 不能停顿超过 body_timeout_ms，平均速率也不能低于 min_body_rate；idle、busy 从现在算起
+    // 该阶段不限时（server.timeout_ms 也为 0）时返回 kNoTimeout
+    static constexpr int kNoTimeout = INT32_MAX;
+    int timeout_ms(uint64_t now_ns) const;
+    // 收头部或正文时超时：尽力发送一次 408，不等可写，随后由调用方关闭
+    void send_timeout();
+
+    // 读缓冲区积压到高水位（流水线请求在等前一个响应发完），或待发送的数据到了写高水位、还没降到低水位：
+    // 调用方应停止读取，由内核接收窗口把背压传给对端
+    bool read_paused() const {
+        return output_paused_ ||
+               (active_ && active_->read_buffer.readable_bytes() >= RuntimeConfig::local().read_high_water);
+    }
+
+    // 本线程中待发送数据在高水位以上、且自上次调用以来一个字节都没发出去的连接，积压多的在前
+    static void collect_stalled(std::vector<HttpConn*>& stalled);
+
+    // WebSocket：升级后收到的数据消息由调用方广播；广播和心跳帧以共享块追加，不拷贝
+    bool is_websocket() const { return ws_ != nullptr; }
+    const std::string& ws_topic() const { return ws_->topic(); }
+    void take_ws_messages(std::vector<WebSocket::Message>& messages) { messages.swap(ws_messages_); }
+    // 已发出关闭帧的连接不再追加
+    bool send_ws(const ChainBuffer::SharedBlock& frame, size_t len) {
+        if(!ws_->is_open()) return false;
+        active_->write_buffer.append_ref(frame, len);
+        return true;
     }
+    bool ws_check_alive() { return ws_->check_alive(); }
+
+    // TLS 握手未完成或读时被写阻塞：可写事件交给读路径推进，而不是发送响应
+    bool tls_pending() const { return tls_ && (!tls_->is_established() || tls_->wants_write()); }
+    bool tls_wants_write() const { return tls_ && tls_->wants_write(); }
 
     static bool is_et;                       
-    static const char* src_dir;              
-    static std::atomic<int> user_count;      
+    static constexpr int kIoRounds = 16;     // 每轮每个方向最多的系统调用次数
+    static std::atomic<bool> is_draining;    // 排空中：响应写完即关闭连接
+    static int user_count() { return Metrics::instance()->connections(); }
 
 private:
     int fd_;                                 
     sockaddr_in addr_;                       
 
     bool is_closed_;                         
-    
-    int iov_count_;                         
-    iovec iov_[2];                         
-    
-    Buffer read_buffer_;                    
-    Buffer write_buffer_;                   
-
-    HttpRequest request_;                 
-    HttpResponse response_;                 
+    bool conn_counted_ = false;              // 占用了 RateLimiter 中该地址的一个连接名额
+    bool read_pending_ = false;
+    bool output_paused_ = false;             // 待发送的数据到了写高水位，降到低水位前不读、不生成
+    uint64_t bytes_written_ = 0;
+    bool wants_metrics_ = false;
+    std::atomic<uint64_t> generation_{0};
+    uint64_t request_start_ns_ = 0;          // 当前请求首字节到达时间，用于延迟直方图
+    uint64_t accept_ns_ = 0;
+    uint64_t body_start_ns_ = 0;             // 当前请求头部收完、开始收正文的时间
+    uint32_t requests_ = 0;                  // 本连接已接收的 HTTP/1 请求数，到 keepalive_requests 后关闭
+
+    // HTTP/2：收到连接前言或 h2c 升级后，本连接后续的读写都交给会话处理
+    bool process_h2_();
+    bool upgrade_h2_();
+    std::unique_ptr<Http2Session> h2_;
+
+    // WebSocket：升级后本连接的读写都交给帧层处理，并订阅所在 IO 线程的 WsHub
+    bool process_ws_();
+    bool upgrade_ws_();
+    std::unique_ptr<WebSocket> ws_;
+    std::vector<WebSocket::Message> ws_messages_;
+    WsHub* ws_hub_ = nullptr;
+
+    std::unique_ptr<TlsConn> tls_;           // 监听端口启用 TLS 时非空
+
+    // 准入控制
+    int admit_();                            // 准入返回 0，否则返回拒绝用的状态码
+    ConcurrencyLimiter* limiter_ = nullptr;
+    bool admitted_ = false;                  // 已占用 limiter_ 的一个名额
+    bool shed_ = false;                      // 本次请求被拒绝（限流、过载或请求有误），回错误响应后关闭
+    bool in_request_ = false;                // 已准入、请求还没有接收完整
+
+    // 没有对应文件的状态响应，正文为纯文本的状态描述
+    void respond_status_(int code, bool keep_alive);
+
+    // 流式响应：每次发送腾出空间后继续生成，直到写缓冲区回到高水位或响应结束
+    void pump_stream_();
+    std::unique_ptr<ResponseStream> stream_;
+
+    // 处理请求时才需要的状态，空闲的长连接不持有
+    struct Active {
+        Buffer read_buffer;
+        ChainBuffer write_buffer;
+        ResponseWriter writer{write_buffer};
+        HttpRequest request;
+        HttpResponse response;
+    };
+    bool process_input_();
+    void update_output_();
+    static size_t write_low_water_();
+    struct Backlogged {
+        HttpConn* conn;
+        uint64_t generation;
+        uint64_t written;                    // 上次检查时的 bytes_written_
+    };
+    static std::vector<Backlogged>& backlog_();
+
+    void unpark_();
+    void park_();
+    static std::vector<std::unique_ptr<Active>>& active_cache_();    // 本线程的空闲 Active
+    static std::unique_ptr<Active> acquire_active_();
+    static void release_active_(std::unique_ptr<Active> active);
+    uint32_t keep_alive_remaining_() const;  // 本连接还能接收的请求数，0 表示不限
+    std::unique_ptr<Active> active_;
 };
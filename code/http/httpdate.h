@@ -0,0 +1,35 @@
+#pragma once
+
+#include <ctime>
+#include <string_view>
+
+// 每个线程（即每个 EventLoop）缓存一份格式化好的 Date 头，每秒最多刷新一次
+class HttpDate {
+public:
+    static std::string_view header() {
+        thread_local HttpDate date;
+        date.refresh();
+        return {date.buf_, date.len_};
+    }
+
+    // 不含 "Date: " 和行尾，用于 HTTP/2 的 date 头
+    static std::string_view value() {
+        std::string_view line = header();
+        return line.substr(6, line.size() - 8);
+    }
+
+private:
+    void refresh() {
+        timespec ts;
+        clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+        if(ts.tv_sec == last_) return;
+        last_ = ts.tv_sec;
+        tm t;
+        gmtime_r(&last_, &t);
+        len_ = strftime(buf_, sizeof(buf_), "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &t);
+    }
+
+    char buf_[64];
+    size_t len_ = 0;
+    time_t last_ = -1;
+};
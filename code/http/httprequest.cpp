@@ -1,19 +1,45 @@
 #include "httprequest.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+
+#include "urlpath.h"
 
 using std::unordered_map;
-using std::unordered_set;
 using std::string;
 using std::string_view;
 using std::regex;
 using std::cmatch;
 using std::regex_match;
 
-const unordered_set<string_view>HttpRequest::DEFAULT_HTML{
-            "/index", "/register", "/login",
-             "/welcome", "/video", "/picture", };
+size_t HttpRequest::max_header_size = 64 << 10;
+HttpRequest::BodyHandler HttpRequest::body_handler;
+
+namespace {
+
+constexpr size_t kMaxChunkLine = 1024;     // 块长度行（含扩展）的上限
+
+bool iequals(string_view a, string_view b) {
+    return a.size() == b.size() && strncasecmp(a.data(), b.data(), a.size()) == 0;
+}
 
-const unordered_map<string_view, int> HttpRequest::DEFAULT_HTML_TAG {
-            {"/register.html", 0}, {"/login.html", 1},  };
+}  // namespace
+
+HttpRequest::BodyHandler HttpRequest::upload_handler(string prefix, string dir, size_t limit) {
+    return [prefix = std::move(prefix), dir = std::move(dir), limit](const HttpRequest& request,
+                                                                      std::unique_ptr<BodySink>& sink) {
+        if(request.method() != "PUT" || !request.path().starts_with(prefix)) return false;
+        const string_view name = request.path().substr(prefix.size());
+        const bool valid = !name.empty() && name.size() <= 255 && name.front() != '.' &&
+            std::all_of(name.begin(), name.end(), [](char ch) {
+                return isalnum(static_cast<unsigned char>(ch)) || ch == '.' || ch == '_' || ch == '-';
+            });
+        if(!valid) return false;
+        auto file = std::make_unique<FileSink>(dir + string(name), limit);
+        if(file->open()) sink = std::move(file);
+        return true;
+    };
+}
 
 void HttpRequest::init() {
     method_.clear();
@@ -21,67 +47,219 @@ void HttpRequest::init() {
     version_.clear();
     body_.clear();
     state_ = ParseState::REQUEST_LINE;
+    head_bytes_ = 0;
+    body_remaining_ = 0;
+    body_received_ = 0;
+    body_limit_ = 0;
+    expect_continue_ = false;
+    has_body_ = false;
+    sink_.reset();
+    sink_status_ = 0;
     header_.clear();
     post_data_.clear();
 }
 
 bool HttpRequest::is_keep_alive() const {
-    auto it = header_.find("Connection");
-    if(it != header_.end()) {
-        return it->second == "keep-alive" && version_ == "1.1";
+    // HTTP/1.1 默认保持连接，除非带 Connection: close；HTTP/1.0 要显式带 keep-alive
+    if(version_ == "1.1") return !connection_has_("close");
+    return version_ == "1.0" && connection_has_("keep-alive");
+}
+
+bool HttpRequest::connection_has_(string_view option) const {
+    // Connection 是逗号分隔的列表，如 "keep-alive, Upgrade"
+    string_view conn = header("connection");
+    while(!conn.empty()) {
+        const size_t comma = conn.find(',');
+        string_view token = conn.substr(0, comma);
+        while(!token.empty() && token.front() == ' ') token.remove_prefix(1);
+        while(!token.empty() && token.back() == ' ') token.remove_suffix(1);
+        if(token.size() == option.size() && strncasecmp(token.data(), option.data(), option.size()) == 0) return true;
+        if(comma == string_view::npos) break;
+        conn.remove_prefix(comma + 1);
     }
     return false;
 }
 
-bool HttpRequest::parse(Buffer& buffer) {
+bool HttpRequest::is_websocket() const {
+    if(method_ != "GET" || header("sec-websocket-key").empty() || header("sec-websocket-version") != "13") {
+        return false;
+    }
+    const string_view upgrade = header("upgrade");
+    if(upgrade.size() != 9 || strncasecmp(upgrade.data(), "websocket", 9) != 0) {
+        return false;
+    }
+    return connection_has_("upgrade");
+}
+
+string_view HttpRequest::header(const string& key) const {
+    auto it = header_.find(key);
+    return it != header_.end() ? string_view(it->second) : string_view();
+}
+
+void HttpRequest::assign(string_view method, string_view path, string_view content_type, string body) {
+    init();
+    method_ = method;
+    path_ = path;
+    version_ = "2";
+    if(!content_type.empty()) header_["content-type"] = content_type;
+    if(!body.empty()) {
+        body_ = std::move(body);
+        process_post();
+    }
+    state_ = ParseState::FINISH;
+}
+
+HttpRequest::HttpCode HttpRequest::parse(Buffer& buffer) {
     static constexpr string_view CRLF = "\r\n";
 
-    if(buffer.readable_bytes() <= 0) return false;
-    
-    while(buffer.readable_bytes() && state_ != ParseState::FINISH) {
-        const char* line_end = std::search(
-        buffer.readable_view().data(), 
-        buffer.readable_view().data() + buffer.readable_bytes(),
-        CRLF.data(), 
-        CRLF.data() + 2);
-        string_view line(buffer.readable_view().data(), line_end);
-
-        switch(state_) {
-            case ParseState::REQUEST_LINE:
-                if(!parse_request_line(line)) return false;
-                process_path();
-                break;
-            case ParseState::HEADERS:
-                parse_header(line);
-                if(buffer.readable_bytes() <= 2) state_ = ParseState::FINISH;
-                break;
-            case ParseState::BODY:
-                parse_body(line);
-                break;
-            default:
-                break;
+    if(state_ == ParseState::FINISH) init();
+
+    while(state_ != ParseState::FINISH) {
+        const string_view data(buffer.begin_read(), buffer.readable_bytes());
+        if(state_ == ParseState::BODY || state_ == ParseState::CHUNK_DATA) {
+            const size_t n = std::min(data.size(), body_remaining_);
+            if(n > 0) {
+                expect_continue_ = false;
+                if(!append_body_(data.substr(0, n))) return HttpCode::INTERNAL_ERROR;
+                buffer.retrieve(n);
+                body_remaining_ -= n;
+            }
+            if(body_remaining_ > 0) return HttpCode::NO_REQUEST;
+            if(state_ == ParseState::CHUNK_DATA) {
+                state_ = ParseState::CHUNK_CRLF;
+                continue;
+            }
+            return finish_body_();
         }
 
-        if(line_end == buffer.begin_write()) break;
+        // 其余状态按行解析，不完整的行留在缓冲区等下次读
+        const size_t eol = data.find(CRLF);
+        const bool in_head = state_ == ParseState::REQUEST_LINE || state_ == ParseState::HEADERS ||
+                             state_ == ParseState::TRAILERS;
+        if(eol == string_view::npos) {
+            if(in_head && head_bytes_ + data.size() > max_header_size) return HttpCode::HEADER_TOO_LARGE;
+            if(!in_head && data.size() > kMaxChunkLine) return HttpCode::BAD_REQUEST;
+            return HttpCode::NO_REQUEST;
+        }
+        if(in_head) {
+            head_bytes_ += eol + CRLF.size();
+            if(head_bytes_ > max_header_size) return HttpCode::HEADER_TOO_LARGE;
+        }
+        const HttpCode code = parse_line_(data.substr(0, eol));
+        buffer.retrieve(eol + CRLF.size());
+        if(code != HttpCode::NO_REQUEST) return code;
+    }
+    return HttpCode::GET_REQUEST;
+}
 
-        buffer.retrieve_until(line_end + 2);
+HttpRequest::HttpCode HttpRequest::parse_line_(string_view line) {
+    switch(state_) {
+        case ParseState::REQUEST_LINE:
+            // 请求之间多余的空行忽略
+            if(line.empty()) break;
+            if(!parse_request_line(line)) return HttpCode::BAD_REQUEST;
+            break;
+        case ParseState::HEADERS:
+            if(line.empty()) return on_headers_complete_();
+            if(!parse_header(line)) return HttpCode::BAD_REQUEST;
+            break;
+        case ParseState::CHUNK_SIZE: {
+            // 块扩展（; 之后）忽略
+            string_view size = line.substr(0, line.find(';'));
+            while(!size.empty() && (size.back() == ' ' || size.back() == '\t')) size.remove_suffix(1);
+            size_t len = 0;
+            const auto [end, ec] = std::from_chars(size.data(), size.data() + size.size(), len, 16);
+            if(size.empty() || ec != std::errc() || end != size.data() + size.size()) {
+                return HttpCode::BAD_REQUEST;
+            }
+            if(len == 0) {
+                state_ = ParseState::TRAILERS;
+                break;
+            }
+            if(len > body_limit_ - body_received_) return HttpCode::ENTITY_TOO_LARGE;
+            body_remaining_ = len;
+            state_ = ParseState::CHUNK_DATA;
+            break;
+        }
+        case ParseState::CHUNK_CRLF:
+            if(!line.empty()) return HttpCode::BAD_REQUEST;
+            state_ = ParseState::CHUNK_SIZE;
+            break;
+        case ParseState::TRAILERS:
+            // 尾部字段不参与处理
+            if(line.empty()) return finish_body_();
+            break;
+        default:
+            break;
     }
+    return HttpCode::NO_REQUEST;
+}
+
+HttpRequest::HttpCode HttpRequest::on_headers_complete_() {
     LOG_DEBUG("[%s], [%s], [%s]", method_.c_str(), path_.c_str(), version_.c_str());
+    const string_view encoding = header("transfer-encoding");
+    const string_view length = header("content-length");
+    bool chunked = false;
+    size_t len = 0;
+    if(!encoding.empty()) {
+        // 两者同时出现时前后端可能对正文边界理解不一致（请求走私），直接拒绝
+        if(!length.empty()) return HttpCode::BAD_REQUEST;
+        if(!iequals(encoding, "chunked")) return HttpCode::NOT_IMPLEMENTED;
+        chunked = true;
+    } else if(!length.empty()) {
+        const auto [end, ec] = std::from_chars(length.data(), length.data() + length.size(), len);
+        if(ec != std::errc() || end != length.data() + length.size()) return HttpCode::BAD_REQUEST;
+    }
+    if(!chunked && len == 0) return finish_body_();
+
+    has_body_ = true;
+    body_limit_ = RuntimeConfig::local().max_body_size;
+    if(body_handler && body_handler(*this, sink_)) {
+        if(!sink_) return HttpCode::INTERNAL_ERROR;
+        body_limit_ = sink_->limit();
+    }
+    if(len > body_limit_) return HttpCode::ENTITY_TOO_LARGE;
+    if(!sink_) body_.reserve(len);
+    expect_continue_ = iequals(header("expect"), "100-continue");
+    body_remaining_ = len;
+    state_ = chunked ? ParseState::CHUNK_SIZE : ParseState::BODY;
+    return HttpCode::NO_REQUEST;
+}
+
+bool HttpRequest::append_body_(string_view data) {
+    body_received_ += data.size();
+    if(sink_) return sink_->write(data);
+    body_.append(data);
     return true;
 }
 
-void HttpRequest::process_path() {
-    if(path_ == "/") {
-        path_ = "/index.html"; 
+HttpRequest::HttpCode HttpRequest::finish_body_() {
+    state_ = ParseState::FINISH;
+    if(sink_) {
+        sink_status_ = sink_->finish();
+        sink_.reset();
+        LOG_DEBUG("Body streamed, len:%zu, status:%d", body_received_, sink_status_);
+    } else if(!body_.empty()) {
+        process_post();
+        LOG_DEBUG("Body:%s, len:%d", body_.c_str(), body_.size());
     }
-    else {
-        for(auto &item: DEFAULT_HTML) {
-            if(item == path_) {
-                path_ += ".html";
-                break;
-            }
-        }
+    return HttpCode::GET_REQUEST;
+}
+
+ssize_t HttpRequest::splice_body(int fd, int* saved_errno) {
+    expect_continue_ = false;
+    const ssize_t len = sink_->splice_from(fd, body_remaining_, saved_errno);
+    if(len > 0) {
+        body_remaining_ -= len;
+        body_received_ += len;
     }
+    return len;
+}
+
+bool HttpRequest::take_expect_continue() {
+    const bool expect = expect_continue_;
+    expect_continue_ = false;
+    return expect;
 }
 
 bool HttpRequest::parse_request_line(string_view line) {
@@ -91,6 +269,10 @@ bool HttpRequest::parse_request_line(string_view line) {
         method_ = match[1].str();
         path_ = match[2].str();
         version_ = match[3].str();
+        if(!normalize_path(path_)) {
+            LOG_DEBUG("Bad path %s", path_.c_str());
+            return false;
+        }
         state_ = ParseState::HEADERS;
         return true;
     }
@@ -98,22 +280,18 @@ bool HttpRequest::parse_request_line(string_view line) {
     return false;
 }
 
-void HttpRequest::parse_header(string_view line) {
+bool HttpRequest::parse_header(string_view line) {
     regex patten("^([^:]*): ?(.*)$");
     cmatch match;
     if(regex_match(line.begin(), line.end(), match, patten)) {
-        header_[match[1].str()] = match[2].str();
-    }
-    else {
-        state_ = ParseState::BODY;
+        // 头部名不区分大小写，存小写，查找时精确匹配
+        string name = match[1].str();
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+        header_[std::move(name)] = match[2].str();
+        return true;
     }
-}
-
-void HttpRequest::parse_body(string_view line) {
-    body_ = line;
-    process_post();
-    state_ = ParseState::FINISH;
-    LOG_DEBUG("Body:%s, len:%d", body_.c_str(), body_.size());
+    LOG_ERROR("Header Error");
+    return false;
 }
 
 int HttpRequest::convert_hex(char ch) {
@@ -123,23 +301,10 @@ int HttpRequest::convert_hex(char ch) {
 }
 
 void HttpRequest::process_post() {
-    if(method_ == "POST" && header_["Content-Type"] == "application/x-www-form-urlencoded") {
+    // 表单解析到 post_data_，交给路由的处理函数
+    if(method_ == "POST" && header("content-type") == "application/x-www-form-urlencoded") {
         parse_url_encoded();
-        auto it = DEFAULT_HTML_TAG.find(path_);
-        if(it != DEFAULT_HTML_TAG.end()) {
-            int tag = it->second;
-            LOG_DEBUG("Tag:%d", tag);
-            if(tag == 0 || tag == 1) {
-                bool isLogin = (tag == 1);
-                if(verify_user(post_data_["username"], post_data_["password"], isLogin)) {
-                    path_ = "/welcome.html";
-                } 
-                else {
-                    path_ = "/error.html";
-                }
-            }
-        }
-    }   
+    }
 }
 
 void HttpRequest::parse_url_encoded() {
@@ -1,23 +1,32 @@
 #pragma once
 
+#include <functional>
+#include <memory>
 #include <unordered_map>
-#include <unordered_set>
 #include <string>
 #include <string_view>
 #include <regex>
+#include <strings.h>
 #include <mysql/mysql.h>
 
 #include "../buffer/buffer.h"
 #include "../log/log.h"
+#include "../config/runtime.h"
 #include "../pool/sqlconnpool.h"
 #include "../pool/sqlconnRAII.h"
+#include "httptables.h"
+#include "bodysink.h"
 
 class HttpRequest {
 public:
     enum class ParseState {
         REQUEST_LINE,
         HEADERS,
-        BODY,
+        BODY,           // Content-Length 正文
+        CHUNK_SIZE,     // chunked：块长度行
+        CHUNK_DATA,
+        CHUNK_CRLF,     // 块数据之后的 CRLF
+        TRAILERS,       // 长度为 0 的块之后的尾部字段，到空行结束
         FINISH
     };
 
@@ -29,15 +38,47 @@ public:
         FORBIDDEN_REQUEST,
         FILE_REQUEST,
         INTERNAL_ERROR,
-        CLOSED_CONNECTION
+        CLOSED_CONNECTION,
+        ENTITY_TOO_LARGE,
+        HEADER_TOO_LARGE,
+        NOT_IMPLEMENTED
     };
-    
+
+    // 头部解析完、正文开始之前调用：返回 true 表示由 sink 流式接收正文，不缓存到内存，也不受 http.max_body_size 限制；
+    // 返回 true 而 sink 为空表示接收方创建失败，回 500
+    using BodyHandler = std::function<bool(const HttpRequest& request, std::unique_ptr<BodySink>& sink)>;
+
+    static size_t max_header_size;      // 请求行加头部的上限，超过回 431
+    static BodyHandler body_handler;    // 为空时正文都缓存在内存中
+
+    // PUT <prefix><文件名> 的正文写入 dir 下的同名文件，文件名只允许字母、数字和 ._-，不能以 . 开头
+    static BodyHandler upload_handler(std::string prefix, std::string dir, size_t limit);
+
     HttpRequest() { init(); }
     ~HttpRequest() = default;
 
     void init();
-    
-    bool parse(Buffer& buffer);
+
+    // 增量解析：消费缓冲区中属于本请求的字节，流水线中的后续请求留在缓冲区
+    // 返回 NO_REQUEST 表示还需要更多数据，GET_REQUEST 表示请求完整，其余为错误
+    HttpCode parse(Buffer& buffer);
+
+    bool is_finished() const { return state_ == ParseState::FINISH; }
+    // 头部已收完，正在收正文（含 chunked 的尾部字段）
+    bool in_body() const { return state_ >= ParseState::BODY && state_ != ParseState::FINISH; }
+    size_t body_received() const { return body_received_; }
+    // 头部声明了正文：带 Transfer-Encoding，或 Content-Length 大于 0
+    bool has_body() const { return has_body_; }
+    // 头部带 Expect: 100-continue 且正文还没开始到达，取出后清除
+    bool take_expect_continue();
+
+    // 正文可以直接从 socket 搬给接收方，不经过读缓冲区
+    bool can_splice() const {
+        return state_ == ParseState::BODY && sink_ && body_remaining_ > 0 && sink_->can_splice();
+    }
+    ssize_t splice_body(int fd, int* saved_errno);
+    // 正文交给了接收方时为接收方给出的状态码，否则为 0
+    int sink_status() const { return sink_status_; }
 
     std::string_view path() const { return path_; }
     std::string& path() { return path_; }
@@ -45,24 +86,45 @@ public:
     std::string_view version() const { return version_; }
     
     std::string_view get_post(std::string_view key) const;
+    // 头部名解析时已转为小写，key 须为小写，如 header("content-length")
+    std::string_view header(const std::string& key) const;
+
+    // HTTP/2 的请求由帧层解出方法、路径和正文，这里只做表单处理，路径由路由映射
+    void assign(std::string_view method, std::string_view path,
+                std::string_view content_type, std::string body);
     
     bool is_keep_alive() const;
 
+    // RFC 6455 升级请求：GET、Upgrade: websocket、Connection 含 Upgrade、版本 13 且带 Sec-WebSocket-Key
+    bool is_websocket() const;
+
+    // 注册或登录校验，访问数据库
+    static bool verify_user(std::string_view name, std::string_view pwd, bool is_login);
+
 private:
     bool parse_request_line(std::string_view line);
-    void parse_header(std::string_view line);
-    void parse_body(std::string_view line);
+    bool parse_header(std::string_view line);
+    HttpCode parse_line_(std::string_view line);
+    HttpCode on_headers_complete_();
+    bool append_body_(std::string_view data);
+    HttpCode finish_body_();
+    bool connection_has_(std::string_view option) const;    // Connection 列表中含该选项，不区分大小写
     
-    void process_path();
     void process_post();
     
     void parse_url_encoded();
     
-    static bool verify_user(std::string_view name, std::string_view pwd, bool is_login);
-    
     static int convert_hex(char ch);
 
     ParseState state_ = ParseState::REQUEST_LINE;
+    size_t head_bytes_ = 0;             // 已消费的请求行、头部和尾部字段字节数
+    size_t body_remaining_ = 0;         // Content-Length 正文或当前块还差的字节数
+    size_t body_received_ = 0;
+    size_t body_limit_ = 0;
+    bool expect_continue_ = false;
+    bool has_body_ = false;
+    std::unique_ptr<BodySink> sink_;
+    int sink_status_ = 0;
     
     std::string method_;
     std::string path_;
@@ -71,7 +133,4 @@ private:
     
     std::unordered_map<std::string, std::string> header_;
     std::unordered_map<std::string, std::string> post_data_;
-
-    static const std::unordered_set<std::string_view> DEFAULT_HTML;
-    static const std::unordered_map<std::string_view, int> DEFAULT_HTML_TAG;
 };
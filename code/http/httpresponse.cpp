@@ -4,52 +4,50 @@
  * @copyleft Apache 2.0
  */ 
 #include "httpresponse.h"
+#include <algorithm>
+#include <charconv>
 
-using std::unordered_map;
 using std::string;
 using std::string_view;
 
 
-const unordered_map<string, string> HttpResponse::SUFFIX_TYPE = {
-    { ".html",  "text/html" },
-    { ".xml",   "text/xml" },
-    { ".xhtml", "application/xhtml+xml" },
-    { ".txt",   "text/plain" },
-    { ".rtf",   "application/rtf" },
-    { ".pdf",   "application/pdf" },
-    { ".word",  "application/nsword" },
-    { ".png",   "image/png" },
-    { ".gif",   "image/gif" },
-    { ".jpg",   "image/jpeg" },
-    { ".jpeg",  "image/jpeg" },
-    { ".au",    "audio/basic" },
-    { ".mpeg",  "video/mpeg" },
-    { ".mpg",   "video/mpeg" },
-    { ".avi",   "video/x-msvideo" },
-    { ".gz",    "application/x-gzip" },
-    { ".tar",   "application/x-tar" },
-    { ".css",   "text/css "},
-    { ".js",    "text/javascript "},
-};
+const HttpResponse::HeaderTable HttpResponse::HEADER_TABLE = HttpResponse::build_header_table_();
 
-const unordered_map<int, string> HttpResponse::CODE_STATUS = {
-    { 200, "OK" },
-    { 400, "Bad Request" },
-    { 403, "Forbidden" },
-    { 404, "Not Found" },
-};
+HttpResponse::HeaderTable HttpResponse::build_header_table_() {
+    HeaderTable table;
+    table.types.push_back(DEFAULT_MIME_TYPE);
+    for(size_t i = 0; i < MIME_TABLE.size(); ++i) {
+        auto it = std::find(table.types.begin(), table.types.end(), MIME_TABLE[i].type);
+        table.type_slot[i] = it - table.types.begin();
+        if(it == table.types.end()) table.types.push_back(MIME_TABLE[i].type);
+    }
 
-const unordered_map<int, string> HttpResponse::CODE_PATH = {
-    { 400, "/400.html" },
-    { 403, "/403.html" },
-    { 404, "/404.html" },
-};
+    table.blocks.resize(STATUS_TABLE.size() * table.types.size() * 2);
+    for(size_t status = 0; status < STATUS_TABLE.size(); ++status) {
+        for(size_t slot = 0; slot < table.types.size(); ++slot) {
+            for(int keep_alive = 0; keep_alive < 2; ++keep_alive) {
+                string& block = table.blocks[(status * table.types.size() + slot) * 2 + keep_alive];
+                block = "HTTP/1.1 " + std::to_string(STATUS_TABLE[status].key) + " ";
+                block += STATUS_TABLE[status].reason;
+                block += "\r\nConnection: ";
+                if(keep_alive) {
+                    block += "keep-alive\r\n";
+                } else {
+                    block += "close\r\n";
+                }
+                block += "Content-type: ";
+                block += table.types[slot];
+                block += "\r\n";
+            }
+        }
+    }
+    return table;
+}
 
 HttpResponse::HttpResponse() {
     code_ = -1;
-    path_ = src_dir_ = "";
+    path_ = "";
     is_keep_alive_ = false;
-    mm_file_ = nullptr; 
     mm_file_stat_ = { 0 };
 };
 
@@ -57,19 +55,30 @@ HttpResponse::~HttpResponse() {
     unmap_file();
 }
 
-void HttpResponse::init(const string& src_dir, string& path, bool is_keep_alive, int code){
-    assert(src_dir != "");
-    if(mm_file_) unmap_file(); 
+void HttpResponse::init(const VirtualHost& host, string& path, bool is_keep_alive, int code,
+                        uint32_t keep_alive_max, int root_fd){
+    unmap_file(); 
     code_ = code;
     is_keep_alive_ = is_keep_alive;
+    head_ = false;
+    keep_alive_max_ = keep_alive_max;
     path_ = path;
-    src_dir_ = src_dir;
-    mm_file_ = nullptr; 
+    host_ = &host;
+    root_fd_ = root_fd;
     mm_file_stat_ = { 0 };
 }
 
-void HttpResponse::make_response(Buffer& buffer) {
-    if(stat((src_dir_ + path_).data(), &mm_file_stat_) < 0 || S_ISDIR(mm_file_stat_.st_mode)) {
+void HttpResponse::make_response(ChainBuffer& buffer) {
+    resolve();
+    add_header_(buffer);
+    add_content_(buffer);
+}
+
+void HttpResponse::resolve() {
+    if(code_ >= 400) {
+        // 状态已经确定（如路由未匹配），不查找请求的文件，直接用错误页
+    }
+    else if(!lookup_file_() || !S_ISREG(mm_file_stat_.st_mode)) {
         code_ = 404;
     }
     else if(!(mm_file_stat_.st_mode & S_IROTH)) {
@@ -79,13 +88,45 @@ void HttpResponse::make_response(Buffer& buffer) {
         code_ = 200; 
     }
     handle_error_page();
-    add_status_line_(buffer);
+}
+
+string_view HttpResponse::reject_response(int code) {
+    static constexpr string_view kTooManyRequests =
+        "HTTP/1.1 429 Too Many Requests\r\n"
+        "Connection: close\r\n"
+        "Retry-After: 1\r\n"
+        "Content-type: text/plain\r\n"
+        "Content-length: 18\r\n\r\n"
+        "Too Many Requests\n";
+    static constexpr string_view kServiceUnavailable =
+        "HTTP/1.1 503 Service Unavailable\r\n"
+        "Connection: close\r\n"
+        "Retry-After: 1\r\n"
+        "Content-type: text/plain\r\n"
+        "Content-length: 20\r\n\r\n"
+        "Service Unavailable\n";
+    static constexpr string_view kRequestTimeout =
+        "HTTP/1.1 408 Request Timeout\r\n"
+        "Connection: close\r\n"
+        "Content-type: text/plain\r\n"
+        "Content-length: 16\r\n\r\n"
+        "Request Timeout\n";
+    assert(code == 408 || code == 429 || code == 503);
+    if(code == 408) return kRequestTimeout;
+    return code == 429 ? kTooManyRequests : kServiceUnavailable;
+}
+
+void HttpResponse::make_body_response(ChainBuffer& buffer, string_view body) {
+    if(code_ == -1) {
+        code_ = 200;
+    }
     add_header_(buffer);
-    add_content_(buffer);
+    add_content_length_(buffer, body.size());
+    if(!head_) buffer.append(body);
 }
 
-char* HttpResponse::get_file() {
-    return mm_file_;
+const char* HttpResponse::get_file() const {
+    return mm_file_.get();
 }
 
 size_t HttpResponse::get_file_len() const {
@@ -93,94 +134,166 @@ size_t HttpResponse::get_file_len() const {
 }
 
 void HttpResponse::handle_error_page() {
-    if(CODE_PATH.count(code_)) {
-        path_ = CODE_PATH.at(code_);
-        stat((src_dir_ + path_).c_str(), &mm_file_stat_);
+    const StatusEntry* status = find_status(code_);
+    if(status && !status->page.empty()) {
+        path_ = status->page;
+        lookup_file_();
+    } else if(code_ >= 400) {
+        unmap_file();
+    }
+}
+
+bool HttpResponse::lookup_file_() {
+    unmap_file();
+    // 路径以 / 开头，去掉后即相对文档根目录的路径，也是文件缓存的键
+    if(path_.empty() || path_[0] != '/') return false;
+    const char* path = path_.c_str() + 1;
+    if(root_fd_ < 0) {
+        return host_->cache().lookup(path, mm_file_stat_, mm_file_, file_fd_);
+    }
+    file_fd_ = open_beneath(root_fd_, path);
+    if(file_fd_ >= 0 && fstat(file_fd_, &mm_file_stat_) < 0) {
+        unmap_file();
     }
+    return file_fd_ >= 0;
 }
 
-void HttpResponse::add_status_line_(Buffer& buffer) {
-    string status;
-    if(CODE_STATUS.count(code_) == 0) {
+void HttpResponse::add_header_(ChainBuffer& buffer) {
+    int status = table_index(STATUS_TABLE, code_);
+    if(status < 0) {
         code_ = 400;
+        status = table_index(STATUS_TABLE, code_);
     }
-    status = CODE_STATUS.at(code_);
-    buffer.append("HTTP/1.1 " + std::to_string(code_) + " " + status + "\r\n");
+    const string_view type = host_ ? host_->mime_type(path_) : string_view();
+    if(type.empty()) {
+        buffer.append(HEADER_TABLE.block(status, get_type_slot_(), is_keep_alive_));
+    } else {
+        // 站点覆盖的类型：取默认类型的那一份，换掉末尾的 Content-type 行
+        const string& block = HEADER_TABLE.block(status, 0, is_keep_alive_);
+        buffer.append(string_view(block).substr(0, block.size() - DEFAULT_MIME_TYPE.size() - 2));
+        buffer.append(type);
+        buffer.append(string_view("\r\n"));
+    }
+    buffer.append(HttpDate::header());
+    if(is_keep_alive_) add_keep_alive(buffer, keep_alive_max_);
 }
 
-void HttpResponse::add_header_(Buffer& buffer) {
-    buffer.append("Connection: ");
-    if(is_keep_alive_) {
-        buffer.append("keep-alive\r\n");
-        buffer.append("keep-alive: max=6, timeout=120\r\n");
-    } else{
-        buffer.append("close\r\n");
+void HttpResponse::add_keep_alive(ChainBuffer& buffer, uint32_t keep_alive_max) {
+    const RuntimeConfig& runtime = RuntimeConfig::local();
+    const bool timed = runtime.timeout_ms > 0;
+    if(!timed && keep_alive_max == 0) return;
+    char line[64];
+    char* end = line;
+    auto put = [&end](string_view s) { std::memcpy(end, s.data(), s.size()); end += s.size(); };
+    put("Keep-Alive: ");
+    if(timed) {
+        put("timeout=");
+        end = std::to_chars(end, line + sizeof(line), runtime.keepalive_timeout_ms / 1000).ptr;
+        if(keep_alive_max) put(", ");
+    }
+    if(keep_alive_max) {
+        put("max=");
+        end = std::to_chars(end, line + sizeof(line), keep_alive_max).ptr;
     }
-    buffer.append("Content-type: " + get_file_type_() + "\r\n");
+    put("\r\n");
+    buffer.append(line, end - line);
 }
 
-void HttpResponse::add_content_(Buffer& buffer) {
-    string file_path = src_dir_ + path_;
-    int srcFd = open(file_path.c_str(), O_RDONLY);
-    if(srcFd < 0) { 
+void HttpResponse::add_content_length_(ChainBuffer& buffer, size_t len) {
+    static constexpr string_view kPrefix = "Content-length: ";
+    char line[64];
+    std::memcpy(line, kPrefix.data(), kPrefix.size());
+    char* end = std::to_chars(line + kPrefix.size(), line + sizeof(line), len).ptr;
+    std::memcpy(end, "\r\n\r\n", 4);
+    buffer.append(line, end + 4 - line);
+}
+
+void HttpResponse::add_content_(ChainBuffer& buffer) {
+    // HEAD 只要文件长度，不必映射
+    if(head_ ? !mm_file_ && file_fd_ < 0 : !map_file()) {
         error_content(buffer, "File NotFound!");
-        return; 
+        return;
+    }
+    // 文件映射或缓存的内容以共享块的形式挂到写缓冲区上，发送时直接 writev，不拷贝
+    const size_t len = mm_file_stat_.st_size;
+    if(code_ == 200) buffer.append(host_->cache_control_line());
+    add_content_length_(buffer, len);
+    if(head_) {
+        unmap_file();
+        return;
+    }
+    buffer.append_ref(mm_file_, len);
+}
+
+bool HttpResponse::map_file() {
+    if(mm_file_) {
+        return true;
+    }
+    if(file_fd_ < 0) {
+        return false;
     }
 
-    LOG_DEBUG("file path %s", file_path.c_str());
-    void* mmRet = mmap(0, mm_file_stat_.st_size, PROT_READ, MAP_PRIVATE, srcFd, 0);
+    LOG_DEBUG("file path %s", path_.c_str());
+    void* mmRet = mmap(0, mm_file_stat_.st_size, PROT_READ, MAP_PRIVATE, file_fd_, 0);
+    close(file_fd_);
+    file_fd_ = -1;
     if(mmRet == MAP_FAILED) {
-        error_content(buffer, "File NotFound!");
-        return; 
+        return false;
     }
-    close(srcFd);
-    mm_file_ = static_cast<char*>(mmRet);
-    buffer.append("Content-length: " + std::to_string(mm_file_stat_.st_size) + "\r\n\r\n");
+    const size_t len = mm_file_stat_.st_size;
+    mm_file_.reset(static_cast<const char*>(mmRet), [len](const char* p) {
+        munmap(const_cast<char*>(p), len);
+    });
+    return true;
 }
 
 void HttpResponse::unmap_file() {
-    if(mm_file_) {
-        munmap(mm_file_, mm_file_stat_.st_size);
-        mm_file_ = nullptr;
+    mm_file_.reset();
+    if(file_fd_ >= 0) {
+        close(file_fd_);
+        file_fd_ = -1;
     }
 }
 
-string HttpResponse::get_file_type_() {
-    /*std::filesystem::path file_path(path_);
-    std::string ext = file_path.extension().string();
-    if(ext.empty()) {
-        return "text/plain";
-    }
-    if(SUFFIX_TYPE.count(ext)) {
-        return SUFFIX_TYPE.at(ext);
-    }
-    return "text/plain";*/
-    string::size_type idx = path_.find_last_of('.');
-    if(idx == string::npos) {
-        return "text/plain";
+string_view HttpResponse::content_type() const {
+    const string_view type = host_ ? host_->mime_type(path_) : string_view();
+    if(!type.empty()) return type;
+    return HEADER_TABLE.types[get_type_slot_()];
+}
+
+int HttpResponse::get_type_slot_() const {
+    string_view path = path_;
+    string_view::size_type idx = path.find_last_of("./");
+    if(idx == string_view::npos || path[idx] != '.') {
+        return 0;
     }
-    string suffix = path_.substr(idx);
-    if(SUFFIX_TYPE.count(suffix) == 1) {
-        return SUFFIX_TYPE.find(suffix)->second;
+    char buf[kMaxSuffix];
+    const string_view suffix = lower_suffix(path.substr(idx), buf);
+    if(suffix.empty()) {
+        return 0;
     }
-    return "text/plain";
+    int entry = table_index(MIME_TABLE, suffix);
+    return entry < 0 ? 0 : HEADER_TABLE.type_slot[entry];
 }
 
-void HttpResponse::error_content(Buffer& buffer, string message) 
+void HttpResponse::error_content(ChainBuffer& buffer, string message) 
 {
+    string body = error_body(message);
+    add_content_length_(buffer, body.size());
+    if(!head_) buffer.append(body);
+}
+
+string HttpResponse::error_body(string_view message) const {
     string body;
-    string status;
+    const StatusEntry* status = find_status(code_);
     body += "<html><title>Error</title>";
     body += "<body bgcolor=\"ffffff\">";
-    if(CODE_STATUS.count(code_)) {
-        status = CODE_STATUS.at(code_);
-    } else {
-        status = "Bad Request";
-    }
-    body += std::to_string(code_) + " : " + status  + "\n";
-    body += "<p>" + message + "</p>";
+    body += std::to_string(code_) + " : ";
+    body += status ? status->reason : "Bad Request";
+    body += "\n";
+    body += "<p>";
+    body += message;
+    body += "</p>";
     body += "<hr><em>TinyWebServer</em></body></html>";
-
-    buffer.append("Content-length: " + std::to_string(body.size()) + "\r\n\r\n");
-    buffer.append(body);
+    return body;
 }
@@ -1,46 +1,88 @@
 #pragma once
 
-#include <unordered_map>
+#include <vector>
+#include <array>
 #include <filesystem>
 #include <fcntl.h>       
 #include <unistd.h>      
 #include <sys/stat.h>    
 #include <sys/mman.h>    
 
-#include "../buffer/buffer.h"
+#include "../buffer/chainbuffer.h"
 #include "../log/log.h"
+#include "../config/runtime.h"
+#include "httpdate.h"
+#include "httptables.h"
+#include "vhost.h"
 
 class HttpResponse {
 public:
     HttpResponse();
     ~HttpResponse();
 
-    void init(const std::string& src_dir, std::string& path, bool is_keep_alive = false, int code = -1);
-    void make_response(Buffer& buffer);
+    // path 为规范化后的请求路径（见 normalize_path），文件在 host 的文档根目录下查找并经其文件缓存；
+    // root_fd 不为 -1 时（路由挂载的目录）在该目录下查找，不缓存
+    // keep_alive_max 为连接上还能接收的请求数，写入 Keep-Alive 头，0 表示不限
+    void init(const VirtualHost& host, std::string& path, bool is_keep_alive = false, int code = -1,
+              uint32_t keep_alive_max = 0, int root_fd = -1);
+    void make_response(ChainBuffer& buffer);
+    // HEAD 请求：头部照常（含 Content-length），不写正文；每次 init 后重新设置
+    void set_head(bool head) { head_ = head; }
+
+    // HTTP/2 用：只确定状态码并映射正文文件，头部由帧层编码
+    void resolve();
+    // 内容已在文件缓存中时直接引用缓存的块，否则映射查找时打开的文件
+    bool map_file();
+    const ChainBuffer::SharedBlock& file() const { return mm_file_; }
+    std::string_view content_type() const;
+    std::string error_body(std::string_view message) const;
+    // 内存中生成的正文（如 /metrics），类型取默认的 text/plain
+    void make_body_response(ChainBuffer& buffer, std::string_view body);
     void unmap_file();
-    char* get_file();
+    const char* get_file() const;
     size_t get_file_len() const;
-    void error_content(Buffer& buffer, std::string message);
+    void error_content(ChainBuffer& buffer, std::string message);
     int code() const { return code_; }
 
+    // 不解析请求直接返回的完整响应，都带 Connection: close：准入控制拒绝的 429、503，收请求超时的 408
+    static std::string_view reject_response(int code);
+
+    // Keep-Alive: timeout=空闲超时秒数, max=剩余请求数；与实际关闭连接的设置一致，都不限时不写
+    static void add_keep_alive(ChainBuffer& buffer, uint32_t keep_alive_max);
+
 private:
-    void add_status_line_(Buffer &buff);
-    void add_header_(Buffer &buff);
-    void add_content_(Buffer &buff);
+    void add_header_(ChainBuffer &buff);
+    void add_content_(ChainBuffer &buff);
+    void add_content_length_(ChainBuffer &buff, size_t len);
 
     void handle_error_page();
-    std::string get_file_type_();
+    bool lookup_file_();
+    int get_type_slot_() const;
+
+    // 预格式化的响应头：状态行 + Connection + Content-type，按 状态码/类型/keep-alive 组合预先生成
+    struct HeaderTable {
+        std::vector<std::string_view> types;                 // 类型槽位 -> MIME 类型，0 为默认类型
+        std::array<int, MIME_TABLE.size()> type_slot;        // MIME_TABLE 下标 -> 类型槽位
+        std::vector<std::string> blocks;                     // [状态码下标][类型槽位][keep-alive]
+
+        const std::string& block(int status, int slot, bool keep_alive) const {
+            return blocks[(status * types.size() + slot) * 2 + keep_alive];
+        }
+    };
+    static HeaderTable build_header_table_();
 
     int code_;
     bool is_keep_alive_;
+    bool head_ = false;
+    uint32_t keep_alive_max_ = 0;
 
     std::string path_;
-    std::string src_dir_;
-    
-    char* mm_file_; 
+    const VirtualHost* host_ = nullptr;
+    int root_fd_ = -1;
+    int file_fd_ = -1;                      // 查找时打开、尚未映射的文件
+
+    ChainBuffer::SharedBlock mm_file_;
     struct stat mm_file_stat_;
 
-    static const std::unordered_map<std::string, std::string> SUFFIX_TYPE;
-    static const std::unordered_map<int, std::string> CODE_STATUS;
-    static const std::unordered_map<int, std::string> CODE_PATH;
+    static const HeaderTable HEADER_TABLE;
 };
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include <string_view>
+
+// 编译期生成的静态查找表：按 key 排序的 std::array，运行时二分查找，无分配、无哈希
+
+struct MimeEntry {
+    std::string_view key;       // 后缀，含 '.'
+    std::string_view type;
+};
+
+struct StatusEntry {
+    int key;
+    std::string_view reason;
+    std::string_view page;      // 错误页路径，空表示没有
+};
+
+struct PathTagEntry {
+    std::string_view key;
+    int tag;
+};
+
+template<typename T, size_t N>
+constexpr bool is_sorted_table(const std::array<T, N>& table) {
+    for(size_t i = 1; i < N; ++i) {
+        if(!(table[i - 1].key < table[i].key)) return false;
+    }
+    return true;
+}
+
+template<typename T, size_t N, typename K>
+constexpr const T* table_find(const std::array<T, N>& table, K key) {
+    auto it = std::lower_bound(table.begin(), table.end(), key,
+                               [](const T& entry, K k) { return entry.key < k; });
+    if(it == table.end() || !(it->key == key)) return nullptr;
+    return &*it;
+}
+
+template<typename T, size_t N, typename K>
+constexpr int table_index(const std::array<T, N>& table, K key) {
+    const T* entry = table_find(table, key);
+    return entry ? static_cast<int>(entry - table.data()) : -1;
+}
+
+inline constexpr std::string_view DEFAULT_MIME_TYPE = "text/plain";
+
+// 后缀（含 '.'）不区分大小写：表中和站点配置的后缀都是小写，查找前把请求路径的后缀转成小写写入 buf
+// 比 kMaxSuffix 长的返回空，不会匹配任何类型
+inline constexpr size_t kMaxSuffix = 32;
+inline std::string_view lower_suffix(std::string_view suffix, char (&buf)[kMaxSuffix]) {
+    if(suffix.size() > kMaxSuffix) return {};
+    for(size_t i = 0; i < suffix.size(); ++i) {
+        const char c = suffix[i];
+        buf[i] = c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+    return std::string_view(buf, suffix.size());
+}
+
+inline constexpr auto MIME_TABLE = std::to_array<MimeEntry>({
+    { ".3gp",         "video/3gpp" },
+    { ".7z",          "application/x-7z-compressed" },
+    { ".aac",         "audio/aac" },
+    { ".apng",        "image/apng" },
+    { ".au",          "audio/basic" },
+    { ".avi",         "video/x-msvideo" },
+    { ".avif",        "image/avif" },
+    { ".bin",         "application/octet-stream" },
+    { ".bmp",         "image/bmp" },
+    { ".css",         "text/css" },
+    { ".csv",         "text/csv" },
+    { ".doc",         "application/msword" },
+    { ".docx",        "application/vnd.openxmlformats-officedocument.wordprocessingml.document" },
+    { ".eot",         "application/vnd.ms-fontobject" },
+    { ".flac",        "audio/flac" },
+    { ".gif",         "image/gif" },
+    { ".gz",          "application/gzip" },
+    { ".htm",         "text/html" },
+    { ".html",        "text/html" },
+    { ".ico",         "image/x-icon" },
+    { ".jpeg",        "image/jpeg" },
+    { ".jpg",         "image/jpeg" },
+    { ".js",          "text/javascript" },
+    { ".json",        "application/json" },
+    { ".jsonld",      "application/ld+json" },
+    { ".m4a",         "audio/mp4" },
+    { ".map",         "application/json" },
+    { ".md",          "text/markdown" },
+    { ".mid",         "audio/midi" },
+    { ".mjs",         "text/javascript" },
+    { ".mov",         "video/quicktime" },
+    { ".mp3",         "audio/mpeg" },
+    { ".mp4",         "video/mp4" },
+    { ".mpeg",        "video/mpeg" },
+    { ".mpg",         "video/mpeg" },
+    { ".oga",         "audio/ogg" },
+    { ".ogg",         "audio/ogg" },
+    { ".ogv",         "video/ogg" },
+    { ".otf",         "font/otf" },
+    { ".pdf",         "application/pdf" },
+    { ".png",         "image/png" },
+    { ".rtf",         "application/rtf" },
+    { ".svg",         "image/svg+xml" },
+    { ".tar",         "application/x-tar" },
+    { ".tif",         "image/tiff" },
+    { ".tiff",        "image/tiff" },
+    { ".ts",          "video/mp2t" },
+    { ".ttf",         "font/ttf" },
+    { ".txt",         "text/plain" },
+    { ".wasm",        "application/wasm" },
+    { ".wav",         "audio/wav" },
+    { ".weba",        "audio/webm" },
+    { ".webm",        "video/webm" },
+    { ".webmanifest", "application/manifest+json" },
+    { ".webp",        "image/webp" },
+    { ".woff",        "font/woff" },
+    { ".woff2",       "font/woff2" },
+    { ".word",        "application/msword" },
+    { ".xhtml",       "application/xhtml+xml" },
+    { ".xml",         "text/xml" },
+    { ".zip",         "application/zip" },
+});
+static_assert(is_sorted_table(MIME_TABLE), "MIME_TABLE must be sorted by suffix");
+
+inline constexpr auto STATUS_TABLE = std::to_array<StatusEntry>({
+    { 101, "Switching Protocols",             "" },
+    { 200, "OK",                              "" },
+    { 201, "Created",                         "" },
+    { 204, "No Content",                      "" },
+    { 206, "Partial Content",                 "" },
+    { 301, "Moved Permanently",               "" },
+    { 302, "Found",                           "" },
+    { 304, "Not Modified",                    "" },
+    { 400, "Bad Request",                     "/400.html" },
+    { 403, "Forbidden",                       "/403.html" },
+    { 404, "Not Found",                       "/404.html" },
+    { 405, "Method Not Allowed",              "/405.html" },
+    { 408, "Request Timeout",                 "" },
+    { 413, "Content Too Large",               "" },
+    { 414, "URI Too Long",                    "" },
+    { 429, "Too Many Requests",               "" },
+    { 431, "Request Header Fields Too Large", "" },
+    { 500, "Internal Server Error",           "" },
+    { 501, "Not Implemented",                 "" },
+    { 503, "Service Unavailable",             "" },
+});
+static_assert(is_sorted_table(STATUS_TABLE), "STATUS_TABLE must be sorted by code");
+
+// 不带后缀访问时自动补 .html 的页面
+inline constexpr auto DEFAULT_HTML = std::to_array<std::string_view>({
+    "/index", "/login", "/picture", "/register", "/video", "/welcome",
+});
+static_assert(std::is_sorted(DEFAULT_HTML.begin(), DEFAULT_HTML.end()), "DEFAULT_HTML must be sorted");
+
+inline constexpr auto DEFAULT_HTML_TAG = std::to_array<PathTagEntry>({
+    { "/login.html",    1 },
+    { "/register.html", 0 },
+});
+static_assert(is_sorted_table(DEFAULT_HTML_TAG), "DEFAULT_HTML_TAG must be sorted by path");
+
+constexpr std::string_view find_mime_type(std::string_view suffix) {
+    const MimeEntry* entry = table_find(MIME_TABLE, suffix);
+    return entry ? entry->type : DEFAULT_MIME_TYPE;
+}
+
+constexpr const StatusEntry* find_status(int code) {
+    return table_find(STATUS_TABLE, code);
+}
+
+static_assert(find_mime_type(".woff2") == "font/woff2");
+static_assert(find_mime_type(".unknown") == DEFAULT_MIME_TYPE);
+static_assert(find_status(404)->page == "/404.html");
@@ -0,0 +1,135 @@
+#include "responsewriter.h"
+#include <algorithm>
+#include <charconv>
+
+#include "httpdate.h"
+#include "httpresponse.h"
+#include "httptables.h"
+
+using std::string_view;
+
+void ResponseWriter::reset(bool chunked, bool keep_alive, uint32_t keep_alive_max, bool head) {
+    chunk_header_ = nullptr;
+    prepared_header_ = nullptr;
+    chunk_len_ = 0;
+    code_ = 0;
+    chunked_ = chunked;
+    // 不分块时只能以关闭连接标记正文结束；HEAD 没有正文，不受此限
+    keep_alive_ = (chunked || head) && keep_alive;
+    head_ = head;
+    keep_alive_max_ = keep_alive_max;
+    started_ = false;
+    finished_ = false;
+}
+
+void ResponseWriter::begin(int code, string_view content_type) {
+    if(started_) return;
+    started_ = true;
+    const StatusEntry* status = find_status(code);
+    if(!status) {
+        code = 500;
+        status = find_status(code);
+    }
+    code_ = code;
+    char line[16];
+    char* end = std::to_chars(line, line + sizeof(line), code).ptr;
+    out_.append("HTTP/1.1 ");
+    out_.append(line, end - line);
+    out_.append(" ");
+    out_.append(status->reason);
+    out_.append(keep_alive_ ? "\r\nConnection: keep-alive\r\n" : "\r\nConnection: close\r\n");
+    out_.append("Content-type: ");
+    out_.append(content_type);
+    out_.append("\r\n");
+    out_.append(HttpDate::header());
+    if(keep_alive_) HttpResponse::add_keep_alive(out_, keep_alive_max_);
+    out_.append(chunked_ ? "Transfer-Encoding: chunked\r\n\r\n" : "\r\n");
+    // HEAD 写完头部即结束，生成方之后写的内容都丢弃
+    if(head_) finished_ = true;
+}
+
+void ResponseWriter::open_chunk_() {
+    if(!started_) begin(200, DEFAULT_MIME_TYPE);
+    if(!chunked_ || chunk_header_) return;
+    chunk_header_ = out_.prepare(kChunkHeader);
+    out_.commit(kChunkHeader);
+}
+
+void ResponseWriter::write(string_view data) {
+    if(head_) {
+        if(!started_) begin(200, DEFAULT_MIME_TYPE);
+        return;
+    }
+    while(!data.empty()) {
+        open_chunk_();
+        const size_t n = chunked_ ? std::min(data.size(), kChunkSize - chunk_len_) : data.size();
+        out_.append(data.data(), n);
+        chunk_len_ += n;
+        data.remove_prefix(n);
+        if(chunk_len_ >= kChunkSize) flush();
+    }
+}
+
+void ResponseWriter::write_ref(ChainBuffer::SharedBlock block, const char* data, size_t len) {
+    if(head_) {
+        if(!started_) begin(200, DEFAULT_MIME_TYPE);
+        return;
+    }
+    while(len > 0) {
+        open_chunk_();
+        const size_t n = chunked_ ? std::min(len, kChunkSize - chunk_len_) : len;
+        out_.append_ref(block, data, n);
+        chunk_len_ += n;
+        data += n;
+        len -= n;
+        if(chunk_len_ >= kChunkSize) flush();
+    }
+}
+
+char* ResponseWriter::prepare(size_t len) {
+    assert(len <= kMaxPrepare);
+    if(!started_) begin(200, DEFAULT_MIME_TYPE);
+    // HEAD：给出可写空间，commit 时不提交
+    if(head_ || !chunked_ || chunk_header_) return out_.prepare(len);
+    // 长度为 0 的块表示正文结束，因此块头和内容一起预留，commit 的内容非空才提交块头
+    prepared_header_ = out_.prepare(kChunkHeader + len);
+    return prepared_header_ + kChunkHeader;
+}
+
+void ResponseWriter::commit(size_t len) {
+    if(head_) return;
+    if(prepared_header_) {
+        if(len > 0) {
+            out_.commit(kChunkHeader + len);
+            chunk_header_ = prepared_header_;
+        }
+        prepared_header_ = nullptr;
+    } else {
+        out_.commit(len);
+    }
+    chunk_len_ += len;
+    if(chunk_len_ >= kChunkSize) flush();
+}
+
+void ResponseWriter::flush() {
+    if(!chunk_header_) return;
+    // 回填占位：固定 4 位十六进制，块长度不超过 kChunkSize 加一次 prepare
+    static constexpr char kHex[] = "0123456789abcdef";
+    for(int i = 3; i >= 0; --i) {
+        chunk_header_[i] = kHex[(chunk_len_ >> ((3 - i) * 4)) & 0xF];
+    }
+    chunk_header_[4] = '\r';
+    chunk_header_[5] = '\n';
+    out_.append("\r\n");
+    chunk_header_ = nullptr;
+    chunk_len_ = 0;
+}
+
+void ResponseWriter::end() {
+    if(finished_) return;
+    if(!started_) begin(200, DEFAULT_MIME_TYPE);
+    if(head_) return;
+    flush();
+    if(chunked_) out_.append("0\r\n\r\n");
+    finished_ = true;
+}
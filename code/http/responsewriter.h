@@ -0,0 +1,63 @@
+#pragma once
+
+#include <memory>
+#include <string_view>
+
+#include "../buffer/chainbuffer.h"
+
+// 流式响应：正文直接写进连接写缓冲区的池化块，不经过中间的 std::string
+// HTTP/1.1 以 chunked 发送，块长度先写占位、结束该块时回填；HTTP/1.0 直接发送正文，写完关闭连接
+class ResponseWriter {
+public:
+    static constexpr size_t kChunkSize = 32 * 1024;     // 当前块达到该长度时自动结束
+    static constexpr size_t kChunkHeader = 6;           // 4 位十六进制长度（前导零）+ CRLF
+    static constexpr size_t kMaxPrepare = BlockPool::kBlockSize - kChunkHeader;
+
+    explicit ResponseWriter(ChainBuffer& out) : out_(out) {}
+
+    // 开始一个新响应，之前的状态全部丢弃；head 为 HEAD 请求，只写头部，正文都丢弃
+    void reset(bool chunked, bool keep_alive, uint32_t keep_alive_max = 0, bool head = false);
+
+    // 状态行和头部；没有调用时在第一次写正文前以 200 text/plain 补上
+    void begin(int code, std::string_view content_type);
+
+    void write(std::string_view data);
+    // 共享块按引用追加，不拷贝（如缓存的大段内容）
+    void write_ref(ChainBuffer::SharedBlock block, const char* data, size_t len);
+
+    // 直接格式化到写缓冲区：prepare 返回至少 len 字节（不超过 kMaxPrepare）的可写空间，写完后 commit
+    char* prepare(size_t len);
+    void commit(size_t len);
+
+    // 结束当前块，之前写入的内容都可以发送；每次 produce 返回后由连接调用
+    void flush();
+    void end();
+
+    bool started() const { return started_; }
+    bool finished() const { return finished_; }
+    int code() const { return code_; }
+    bool keep_alive() const { return keep_alive_; }
+
+private:
+    void open_chunk_();
+
+    ChainBuffer& out_;
+    char* chunk_header_ = nullptr;                      // 当前块长度的占位，为空表示没有打开的块
+    char* prepared_header_ = nullptr;                   // prepare 时预留、commit 非空内容时才打开的块
+    size_t chunk_len_ = 0;
+    int code_ = 0;
+    bool chunked_ = true;
+    bool keep_alive_ = false;
+    bool head_ = false;
+    uint32_t keep_alive_max_ = 0;
+    bool started_ = false;
+    bool finished_ = false;
+};
+
+// 流式响应的生成方：连接的写缓冲区低于高水位时反复调用 produce，每次写入一批后返回，
+// 写完全部正文时调用 writer.end()；每次调用都必须写入内容或结束响应
+class ResponseStream {
+public:
+    virtual ~ResponseStream() = default;
+    virtual void produce(ResponseWriter& writer) = 0;
+};
@@ -0,0 +1,266 @@
+#include "router.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+
+#include "httprequest.h"
+
+using std::string;
+using std::string_view;
+
+namespace {
+
+template<size_t N>
+bool any_route(const std::array<int16_t, N>& routes) {
+    return std::any_of(routes.begin(), routes.end(), [](int16_t r) { return r >= 0; });
+}
+
+}  // namespace
+
+string_view RouteParams::get(string_view name) const {
+    for(size_t i = 0; i < count_ && names_ && i < names_->size(); ++i) {
+        if((*names_)[i] == name) return values_[i];
+    }
+    return {};
+}
+
+Router* Router::instance() {
+    static Router router;
+    return &router;
+}
+
+int Router::method_index_(string_view method) {
+    static constexpr string_view kMethods[kMethodCount] = {
+        "GET", "HEAD", "POST", "PUT", "DELETE", "PATCH", "OPTIONS",
+    };
+    for(int i = 0; i < kMethodCount; ++i) {
+        if(kMethods[i] == method) return i;
+    }
+    return -1;
+}
+
+int Router::pick_(const std::array<int16_t, kMethodCount>& routes, int method) {
+    if(method < 0) return -1;
+    // 没有单独注册 HEAD 时按 GET 处理
+    if(routes[method] < 0 && method == HEAD) return routes[GET];
+    return routes[method];
+}
+
+Router::Handler Router::rewrite(string path) {
+    return [path = std::move(path)](HttpRequest& request, const RouteParams&) -> std::unique_ptr<ResponseStream> {
+        request.path() = path;
+        return nullptr;
+    };
+}
+
+bool Router::add(string_view method, string_view pattern, Handler handler, bool uses_db) {
+    if(!handler) return false;
+    return add_(method, pattern, std::move(handler), -1, uses_db);
+}
+
+bool Router::mount(string_view prefix, string dir) {
+    if(prefix.empty() || prefix.back() != '/') return false;
+    string pattern(prefix);
+    pattern += "*path";
+    // 路由表存活到进程结束，目录句柄不关闭
+    const int root_fd = dir.empty() ? -1 : open(dir.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if(!dir.empty() && root_fd < 0) return false;
+    return add_("GET", pattern, nullptr, root_fd) && add_("HEAD", pattern, nullptr, root_fd);
+}
+
+Router::BuildNode* Router::insert_static_(BuildNode* node, string_view segment) {
+    while(!segment.empty()) {
+        auto it = std::find_if(node->children.begin(), node->children.end(),
+                               [c = segment[0]](const auto& child) { return child->prefix[0] == c; });
+        if(it == node->children.end()) {
+            auto child = std::make_unique<BuildNode>();
+            child->prefix = segment;
+            node->children.push_back(std::move(child));
+            return node->children.back().get();
+        }
+        BuildNode* child = it->get();
+        const size_t len = std::mismatch(child->prefix.begin(), child->prefix.end(),
+                                         segment.begin(), segment.end()).first - child->prefix.begin();
+        if(len < child->prefix.size()) {
+            // 公共前缀之后的部分连同原节点的子树下移一层
+            auto tail = std::make_unique<BuildNode>();
+            tail->prefix = child->prefix.substr(len);
+            tail->children = std::move(child->children);
+            tail->param = std::move(child->param);
+            tail->routes = child->routes;
+            tail->catch_all = child->catch_all;
+            child->prefix.resize(len);
+            child->children.clear();
+            child->children.push_back(std::move(tail));
+            child->routes.fill(-1);
+            child->catch_all.fill(-1);
+        }
+        node = child;
+        segment.remove_prefix(len);
+    }
+    return node;
+}
+
+bool Router::add_(string_view method, string_view pattern, Handler handler, int root_fd, bool uses_db) {
+    const int index = method == "*" ? -1 : method_index_(method);
+    if(frozen_ || pattern.empty() || pattern[0] != '/' || (index < 0 && method != "*") ||
+       routes_.size() >= INT16_MAX) {
+        // 日志系统此时尚未初始化
+        fprintf(stderr, "Router: cannot add %.*s %.*s\n", static_cast<int>(method.size()), method.data(),
+                static_cast<int>(pattern.size()), pattern.data());
+        return false;
+    }
+
+    Route route{ string(pattern), {}, std::move(handler), root_fd, uses_db };
+    BuildNode* node = root_.get();
+    string_view rest = pattern;
+    bool catch_all = false;
+    bool valid = true;
+    while(!rest.empty() && valid) {
+        if(rest[0] == ':') {
+            const size_t end = rest.find('/');
+            const string_view name = rest.substr(1, end == string_view::npos ? string_view::npos : end - 1);
+            valid = !name.empty();
+            route.names.emplace_back(name);
+            if(!node->param) node->param = std::make_unique<BuildNode>();
+            node = node->param.get();
+            rest = end == string_view::npos ? string_view() : rest.substr(end);
+        } else if(rest[0] == '*') {
+            const string_view name = rest.substr(1);
+            valid = !name.empty() && name.find('/') == string_view::npos;
+            route.names.emplace_back(name);
+            catch_all = true;
+            rest = {};
+        } else {
+            // : 和 * 只在一段的开头才有特殊含义
+            size_t end = 1;
+            while(end < rest.size() && !(rest[end - 1] == '/' && (rest[end] == ':' || rest[end] == '*'))) ++end;
+            node = insert_static_(node, rest.substr(0, end));
+            rest.remove_prefix(end);
+        }
+    }
+    auto& slots = catch_all ? node->catch_all : node->routes;
+    const int first = index < 0 ? 0 : index;
+    const int last = index < 0 ? kMethodCount : index + 1;
+    for(int i = first; i < last && valid; ++i) {
+        valid = slots[i] < 0;
+    }
+    if(!valid || route.names.size() > RouteParams::kMaxParams) {
+        fprintf(stderr, "Router: invalid or duplicate route %.*s %.*s\n", static_cast<int>(method.size()),
+                method.data(), static_cast<int>(pattern.size()), pattern.data());
+        return false;
+    }
+    for(int i = first; i < last; ++i) {
+        slots[i] = static_cast<int16_t>(routes_.size());
+    }
+    routes_.push_back(std::move(route));
+    return true;
+}
+
+void Router::freeze() {
+    if(frozen_) return;
+    frozen_ = true;
+    // 按层展开：同一节点的静态子节点下标连续
+    std::vector<std::pair<const BuildNode*, uint32_t>> queue;
+    nodes_.emplace_back();
+    child_keys_.push_back('\0');
+    queue.emplace_back(root_.get(), 0);
+    for(size_t i = 0; i < queue.size(); ++i) {
+        const auto [build, index] = queue[i];
+        Node node;
+        node.prefix = chars_.size();
+        node.prefix_len = build->prefix.size();
+        chars_ += build->prefix;
+        node.routes = build->routes;
+        node.catch_all = build->catch_all;
+        node.first_child = nodes_.size();
+        node.child_count = build->children.size();
+        for(const auto& child : build->children) {
+            queue.emplace_back(child.get(), nodes_.size());
+            nodes_.emplace_back();
+            child_keys_.push_back(child->prefix[0]);
+        }
+        if(build->param) {
+            node.param = nodes_.size();
+            queue.emplace_back(build->param.get(), nodes_.size());
+            nodes_.emplace_back();
+            child_keys_.push_back('\0');
+        }
+        nodes_[index] = node;
+    }
+    nodes_.shrink_to_fit();
+    child_keys_.shrink_to_fit();
+    chars_.shrink_to_fit();
+    // 注册用的树不再需要，路由表里的处理函数和目录仍按下标引用
+    root_.reset();
+}
+
+bool Router::match_(uint32_t index, string_view path, int method, RouteParams& params,
+                    int& route, bool& method_miss) const {
+    const Node& node = nodes_[index];
+    if(path.size() < node.prefix_len || memcmp(path.data(), chars_.data() + node.prefix, node.prefix_len) != 0) {
+        return false;
+    }
+    path.remove_prefix(node.prefix_len);
+    if(path.empty()) {
+        if((route = pick_(node.routes, method)) >= 0) return true;
+        method_miss |= any_route(node.routes);
+    } else {
+        const char* keys = child_keys_.data() + node.first_child;
+        for(uint32_t i = 0; i < node.child_count; ++i) {
+            if(keys[i] != path[0]) continue;
+            if(match_(node.first_child + i, path, method, params, route, method_miss)) return true;
+            break;
+        }
+        if(node.param >= 0) {
+            const string_view segment = path.substr(0, path.find('/'));
+            if(!segment.empty() && params.count_ < RouteParams::kMaxParams) {
+                params.values_[params.count_++] = segment;
+                if(match_(node.param, path.substr(segment.size()), method, params, route, method_miss)) return true;
+                --params.count_;
+            }
+        }
+    }
+    // 更具体的路由都没有匹配上，才轮到通配
+    if((route = pick_(node.catch_all, method)) >= 0) {
+        params.values_[params.count_++] = path;
+        return true;
+    }
+    method_miss |= any_route(node.catch_all);
+    return false;
+}
+
+Router::Result Router::dispatch(HttpRequest& request) const {
+    Result result;
+    string_view path = request.path();
+    path = path.substr(0, path.find('?'));
+    RouteParams params;
+    int route = -1;
+    bool method_miss = false;
+    if(nodes_.empty() || !match_(0, path, method_index_(request.method()), params, route, method_miss)) {
+        result.status = method_miss ? 405 : 404;
+        return result;
+    }
+    const Route& r = routes_[route];
+    params.names_ = &r.names;
+    if(!r.handler) {
+        // 挂载：通配捕获的余下路径即目录中的文件
+        result.root_fd = r.root_fd;
+        string file = "/";
+        file += params[params.size() - 1];
+        request.path() = std::move(file);
+        return result;
+    }
+    result.stream = r.handler(request, params);
+    return result;
+}
+
+bool Router::uses_db(string_view method, string_view path) const {
+    path = path.substr(0, path.find('?'));
+    RouteParams params;
+    int route = -1;
+    bool method_miss = false;
+    if(nodes_.empty() || !match_(0, path, method_index_(method), params, route, method_miss)) return false;
+    return routes_[route].uses_db;
+}
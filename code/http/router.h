@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "responsewriter.h"
+
+class HttpRequest;
+
+// 一次匹配捕获的路径参数，值直接指向请求路径，不分配内存
+class RouteParams {
+public:
+    static constexpr size_t kMaxParams = 8;
+
+    std::string_view get(std::string_view name) const;
+    size_t size() const { return count_; }
+    std::string_view operator[](size_t i) const { return values_[i]; }
+
+private:
+    friend class Router;
+
+    std::array<std::string_view, kMaxParams> values_;
+    const std::vector<std::string>* names_ = nullptr;
+    size_t count_ = 0;
+};
+
+// 方法 + 路径模式 -> 处理函数，以及静态目录挂载
+// 模式中 :name 匹配一段（到下一个 / 为止），*name 匹配余下的全部且只能在末尾；静态段优先于参数，参数优先于通配
+// 启动前注册，freeze 后编译为连续存放的扁平节点数组，之后只读，各 IO 线程无锁匹配
+class Router {
+public:
+    // 返回非空时流式生成响应；返回空时按（可能被改写的）request.path() 返回静态文件
+    using Handler = std::function<std::unique_ptr<ResponseStream>(HttpRequest& request, const RouteParams& params)>;
+
+    struct Result {
+        int status = 0;                         // 非 0：没有匹配的路由（404）或方法不允许（405）
+        std::unique_ptr<ResponseStream> stream;
+        int root_fd = -1;                       // 静态文件所在目录，-1 时用请求所属站点的文档根目录
+    };
+
+    static Router* instance();
+
+    // method 为 "*" 时匹配所有方法；模式非法、重复或已 freeze 时返回 false
+    // uses_db 表示处理函数访问数据库：准入时按动态请求限流、降为低优先级，数据库连接池耗尽时直接拒绝
+    bool add(std::string_view method, std::string_view pattern, Handler handler, bool uses_db = false);
+    // prefix 以 / 结尾，其下的 GET/HEAD 请求映射到 dir 中的同名文件；dir 为空时按 Host 取站点的文档根目录
+    // dir 在挂载时打开，之后的文件相对它查找；打开失败返回 false
+    bool mount(std::string_view prefix, std::string dir);
+    void freeze();
+    bool frozen() const { return frozen_; }
+
+    // 改写路径后返回静态文件，用于 / -> /index.html 之类的别名
+    static Handler rewrite(std::string path);
+
+    // 匹配并执行处理函数；请求路径中的查询串不参与匹配
+    Result dispatch(HttpRequest& request) const;
+    // 只匹配不执行，供解析请求之前的准入控制分类；path 应已规范化
+    bool uses_db(std::string_view method, std::string_view path) const;
+
+private:
+    Router() = default;
+
+    enum Method : uint8_t { GET, HEAD, POST, PUT, DELETE, PATCH, OPTIONS, kMethodCount };
+    static int method_index_(std::string_view method);
+
+    struct Route {
+        std::string pattern;
+        std::vector<std::string> names;     // 按捕获顺序的参数名
+        Handler handler;
+        int root_fd;                        // 挂载的目录，-1 时用站点的文档根目录；挂载没有 handler
+        bool uses_db = false;
+    };
+
+    // 注册阶段的树，freeze 时展平
+    struct BuildNode {
+        std::string prefix;
+        std::vector<std::unique_ptr<BuildNode>> children;
+        std::unique_ptr<BuildNode> param;
+        std::array<int16_t, kMethodCount> routes;
+        std::array<int16_t, kMethodCount> catch_all;
+        BuildNode() { routes.fill(-1); catch_all.fill(-1); }
+    };
+
+    // 展平后的节点：静态子节点连续存放，首字节另存一份，选子节点时只扫一小段连续内存
+    struct Node {
+        uint32_t prefix = 0;                // 前缀在 chars_ 中的偏移
+        uint32_t prefix_len = 0;
+        uint32_t first_child = 0;
+        uint32_t child_count = 0;
+        int32_t param = -1;
+        std::array<int16_t, kMethodCount> routes;
+        std::array<int16_t, kMethodCount> catch_all;
+    };
+
+    bool add_(std::string_view method, std::string_view pattern, Handler handler, int root_fd, bool uses_db = false);
+    static BuildNode* insert_static_(BuildNode* node, std::string_view segment);
+    bool match_(uint32_t index, std::string_view path, int method, RouteParams& params,
+                int& route, bool& method_miss) const;
+    static int pick_(const std::array<int16_t, kMethodCount>& routes, int method);
+
+    std::vector<Route> routes_;
+    std::unique_ptr<BuildNode> root_ = std::make_unique<BuildNode>();
+    std::vector<Node> nodes_;
+    std::vector<char> child_keys_;          // nodes_[i] 前缀的首字节
+    std::string chars_;
+    bool frozen_ = false;
+};
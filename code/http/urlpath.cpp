@@ -0,0 +1,77 @@
+#include "urlpath.h"
+#include <cstring>
+
+namespace {
+
+inline int hex_value(char c) {
+    if(c >= '0' && c <= '9') return c - '0';
+    if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// 规范化 in[0, n) 中第一个 ? 之前的部分写入 p，返回时 r 为 ? 的位置（没有时为 n），w 为输出长度
+// p 可以就是 in：输出不会比输入长，写位置 w 始终不超过读位置 r
+bool normalize_into(const char* in, size_t n, char* p, size_t& r, size_t& w) {
+    if(n == 0 || in[0] != '/') return false;
+    p[0] = '/';
+    // seg 为当前段在输出中的起点，p[seg - 1] 为 /
+    w = 1;
+    size_t seg = 1;
+    r = 1;
+    // 当前段写完：. 段丢弃，.. 段连同上一段丢弃；返回 false 即越过了根目录
+    auto close_segment = [&]() -> bool {
+        const size_t len = w - seg;
+        if(len == 1 && p[seg] == '.') {
+            w = seg;
+        } else if(len == 2 && p[seg] == '.' && p[seg + 1] == '.') {
+            if(seg == 1) return false;
+            w = seg - 1;
+            while(p[w - 1] != '/') --w;
+        }
+        seg = w;
+        return true;
+    };
+    for(; r < n && in[r] != '?'; ++r) {
+        char c = in[r];
+        if(c == '%') {
+            const int hi = r + 2 < n ? hex_value(in[r + 1]) : -1;
+            const int lo = hi >= 0 ? hex_value(in[r + 2]) : -1;
+            if(lo < 0) return false;
+            c = static_cast<char>(hi << 4 | lo);
+            // 编码的 / 和 ? 不能当分隔符，文件名中也不会有 NUL
+            if(c == '\0' || c == '/' || c == '?') return false;
+            r += 2;
+        } else if(c == '/') {
+            if(!close_segment()) return false;
+            // 空段（连续的 /）和丢弃的段之后不再写 /
+            if(p[w - 1] != '/') {
+                p[w++] = '/';
+                seg = w;
+            }
+            continue;
+        }
+        p[w++] = c;
+    }
+    return close_segment();
+}
+
+}  // namespace
+
+bool normalize_path(std::string& path) {
+    char* p = path.data();
+    const size_t n = path.size();
+    size_t r, w;
+    if(!normalize_into(p, n, p, r, w)) return false;
+    if(r < n) {
+        std::memmove(p + w, p + r, n - r);
+    }
+    path.resize(w + (n - r));
+    return true;
+}
+
+bool normalize_path(std::string_view path, char* out, size_t cap, size_t& len) {
+    path = path.substr(0, path.find('?'));
+    size_t r;
+    return path.size() <= cap && normalize_into(path.data(), path.size(), out, r, len);
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// 请求路径的规范化，就地改写、一遍扫描、不分配内存：
+// 解码 %XX，合并连续的 /，去掉 . 段，.. 段回退一级；查询串（第一个 ? 之后）原样保留
+// 以下情况返回 false（回 400）：不以 / 开头、% 后不是两位十六进制、解码出 NUL、/ 或 ?、.. 越过根目录
+// 规范化之后同一个文件只有一种写法，路由、上传和文件缓存都以它为准
+bool normalize_path(std::string& path);
+
+// 同上，但只规范化查询串之前的部分，写入调用方的缓冲区（可以在栈上），用于只需分类、不保留结果的地方
+// 查询串之前的部分超过 cap 时也返回 false，调用方自行退回上面的版本
+bool normalize_path(std::string_view path, char* out, size_t cap, size_t& len);
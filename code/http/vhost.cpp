@@ -0,0 +1,194 @@
+#include "vhost.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdlib>
+
+#include "httptables.h"
+
+using std::string;
+using std::string_view;
+
+namespace {
+
+inline char lower(char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// 以空白分隔的各项
+template<typename F>
+void for_each_word(string_view list, F&& f) {
+    size_t pos = 0;
+    while((pos = list.find_first_not_of(" \t", pos)) != string_view::npos) {
+        const size_t end = std::min(list.find_first_of(" \t", pos), list.size());
+        f(list.substr(pos, end - pos));
+        pos = end;
+    }
+}
+
+// 相对路径以启动时的工作目录为准；解析符号链接，去掉末尾的 /
+bool resolve_root(const string& dir, string& root) {
+    char* path = realpath(dir.c_str(), nullptr);
+    if(!path) return false;
+    root = path;
+    free(path);
+    struct stat st;
+    if(stat(root.c_str(), &st) < 0 || !S_ISDIR(st.st_mode)) return false;
+    if(root == "/") root.clear();
+    return true;
+}
+
+}  // namespace
+
+VirtualHost::VirtualHost(const VhostConfig& config, string root)
+    : name_(config.name), root_(std::move(root)),
+      root_fd_(open(root_.empty() ? "/" : root_.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC)),
+      cache_(root_fd_, config.file_cache, config.file_cache_max_file) {
+    for_each_word(config.mime, [this](string_view item) {
+        const size_t eq = item.find('=');
+        string suffix(item.substr(0, eq));
+        std::transform(suffix.begin(), suffix.end(), suffix.begin(), lower);
+        string type(item.substr(eq + 1));
+        auto it = std::lower_bound(mime_.begin(), mime_.end(), suffix,
+                                   [](const auto& entry, const string& key) { return entry.first < key; });
+        if(it != mime_.end() && it->first == suffix) {
+            it->second = std::move(type);
+        } else {
+            mime_.emplace(it, std::move(suffix), std::move(type));
+        }
+    });
+    if(!config.cache_control.empty()) {
+        cache_control_ = config.cache_control;
+        cache_control_line_ = "Cache-Control: " + cache_control_ + "\r\n";
+    }
+}
+
+VirtualHost::~VirtualHost() {
+    if(root_fd_ >= 0) close(root_fd_);
+}
+
+string_view VirtualHost::mime_type(string_view path) const {
+    if(mime_.empty()) return {};
+    const size_t idx = path.find_last_of("./");
+    if(idx == string_view::npos || path[idx] != '.') return {};
+    char buf[kMaxSuffix];
+    const string_view suffix = lower_suffix(path.substr(idx), buf);
+    if(suffix.empty()) return {};
+    auto it = std::lower_bound(mime_.begin(), mime_.end(), suffix,
+                               [](const auto& entry, string_view key) { return entry.first < key; });
+    if(it == mime_.end() || it->first != suffix) return {};
+    return it->second;
+}
+
+VhostTable* VhostTable::instance() {
+    static VhostTable table;
+    return &table;
+}
+
+uint32_t VhostTable::hash_(string_view name, uint32_t seed) {
+    // FNV-1a，边算边转小写；末尾再混一次让低位也均匀
+    uint32_t h = 2166136261u ^ seed;
+    for(char c : name) {
+        h ^= static_cast<unsigned char>(lower(c));
+        h *= 16777619u;
+    }
+    h ^= h >> 15;
+    h *= 0x2c1b3c6du;
+    h ^= h >> 12;
+    return h;
+}
+
+string_view VhostTable::strip_(string_view host) {
+    if(!host.empty() && host[0] == '[') {
+        // IPv6 字面量：[::1]:8080
+        const size_t close = host.find(']');
+        host = host.substr(0, close == string_view::npos ? host.size() : close + 1);
+    } else {
+        host = host.substr(0, host.find(':'));
+    }
+    if(!host.empty() && host.back() == '.') host.remove_suffix(1);
+    return host;
+}
+
+bool VhostTable::init(const VhostConfig& default_host, const std::vector<VhostConfig>& vhosts, string& error) {
+    string root;
+    if(!resolve_root(default_host.root.empty() ? "resources" : default_host.root, root)) {
+        error = "document root " + (default_host.root.empty() ? string("resources") : default_host.root) +
+                " is not a directory";
+        return false;
+    }
+    default_ = std::make_unique<VirtualHost>(default_host, std::move(root));
+    if(default_->root_fd() < 0) {
+        error = "cannot open document root " + default_->root();
+        return false;
+    }
+    // 日志系统此时尚未初始化，不可用时由 WebServer 在初始化日志后告警
+    probe_openat2(default_->root_fd());
+
+    std::vector<Slot> entries;
+    for(const VhostConfig& config : vhosts) {
+        if(!resolve_root(config.root, root)) {
+            error = "vhost." + config.name + ".root " + config.root + " is not a directory";
+            return false;
+        }
+        hosts_.push_back(std::make_unique<VirtualHost>(config, std::move(root)));
+        if(hosts_.back()->root_fd() < 0) {
+            error = "cannot open vhost." + config.name + ".root " + hosts_.back()->root();
+            return false;
+        }
+        auto add = [&](string_view name) {
+            string key(strip_(name));
+            std::transform(key.begin(), key.end(), key.begin(), lower);
+            if(key.empty()) return;
+            names_.push_back(std::make_unique<string>(std::move(key)));
+            entries.push_back({ *names_.back(), hosts_.back().get() });
+        };
+        add(config.name);
+        for_each_word(config.aliases, add);
+    }
+    for(size_t i = 0; i < entries.size(); ++i) {
+        for(size_t j = 0; j < i; ++j) {
+            if(entries[i].name == entries[j].name) {
+                error = "host " + string(entries[i].name) + " is configured twice";
+                return false;
+            }
+        }
+    }
+    if(entries.empty()) return true;
+
+    // 槽数取不小于两倍名字数的 2 的幂；一批种子都有冲突时槽数翻倍
+    size_t size = 2;
+    while(size < entries.size() * 2) size <<= 1;
+    for(uint32_t attempt = 0;; ++attempt) {
+        if(attempt > 0 && attempt % 64 == 0) size <<= 1;
+        const uint32_t seed = attempt * 0x9e3779b9u;
+        std::vector<Slot> slots(size);
+        bool ok = true;
+        for(const Slot& entry : entries) {
+            Slot& slot = slots[hash_(entry.name, seed) & (size - 1)];
+            if(slot.host) {
+                ok = false;
+                break;
+            }
+            slot = entry;
+        }
+        if(ok) {
+            slots_ = std::move(slots);
+            seed_ = seed;
+            mask_ = static_cast<uint32_t>(size - 1);
+            return true;
+        }
+    }
+}
+
+const VirtualHost& VhostTable::find(string_view host) const {
+    if(slots_.empty()) return *default_;
+    host = strip_(host);
+    const Slot& slot = slots_[hash_(host, seed_) & mask_];
+    if(!slot.host || slot.name.size() != host.size()) return *default_;
+    for(size_t i = 0; i < host.size(); ++i) {
+        if(lower(host[i]) != slot.name[i]) return *default_;
+    }
+    return *slot.host;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../config/config.h"
+#include "filecache.h"
+
+// 一个站点：文档根目录、追加的 MIME 类型、Cache-Control 和独立的文件缓存
+class VirtualHost {
+public:
+    // root 为已经解析成绝对路径的目录，不以 / 结尾；构造时打开，之后的文件都相对它查找
+    VirtualHost(const VhostConfig& config, std::string root);
+    ~VirtualHost();
+
+    const std::string& name() const { return name_; }
+    const std::string& root() const { return root_; }
+    // 文档根目录的 O_PATH 句柄，打开失败时为 -1
+    int root_fd() const { return root_fd_; }
+
+    // 按后缀覆盖的类型，没有配置时为空，由调用方查默认表
+    std::string_view mime_type(std::string_view path) const;
+
+    // 静态文件 200 响应的 Cache-Control 值，以及 HTTP/1.x 用的完整头部行（含 \r\n）；没有配置时为空
+    const std::string& cache_control() const { return cache_control_; }
+    const std::string& cache_control_line() const { return cache_control_line_; }
+
+    FileCache& cache() const { return cache_; }
+
+private:
+    std::string name_;
+    std::string root_;
+    int root_fd_;
+    std::vector<std::pair<std::string, std::string>> mime_;     // 后缀 -> 类型，按后缀排序
+    std::string cache_control_;
+    std::string cache_control_line_;
+    mutable FileCache cache_;
+};
+
+// Host 头 -> 站点。启动时对全部主机名（含别名）求一个完美哈希：
+// 换种子直到各名字落在不同的槽里，查找时算一次哈希、比较一次名字，不分配内存
+class VhostTable {
+public:
+    static VhostTable* instance();
+
+    // 启动时调用一次；根目录不存在或主机名重复时返回 false
+    bool init(const VhostConfig& default_host, const std::vector<VhostConfig>& vhosts, std::string& error);
+
+    // host 为 Host 头或 :authority 的值，忽略端口、末尾的点和大小写；不匹配时返回默认站点
+    const VirtualHost& find(std::string_view host) const;
+    const VirtualHost& default_host() const { return *default_; }
+    const std::vector<std::unique_ptr<VirtualHost>>& hosts() const { return hosts_; }
+
+private:
+    VhostTable() = default;
+
+    struct Slot {
+        std::string_view name;
+        const VirtualHost* host = nullptr;
+    };
+
+    static uint32_t hash_(std::string_view name, uint32_t seed);
+    static std::string_view strip_(std::string_view host);
+
+    std::unique_ptr<VirtualHost> default_;
+    std::vector<std::unique_ptr<VirtualHost>> hosts_;
+    std::vector<std::unique_ptr<std::string>> names_;           // 槽中的名字指向这里
+    std::vector<Slot> slots_;
+    uint32_t seed_ = 0;
+    uint32_t mask_ = 0;
+};
@@ -0,0 +1,199 @@
+#include "websocket.h"
+#include <algorithm>
+#include <cstring>
+#include <openssl/evp.h>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+using std::string;
+using std::string_view;
+
+namespace {
+
+constexpr string_view kGuid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+}  // namespace
+
+string WebSocket::handshake_response(string_view key) {
+    // Sec-WebSocket-Accept = base64(SHA-1(key + GUID))
+    string input(key);
+    input.append(kGuid);
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_len = 0;
+    EVP_Digest(input.data(), input.size(), digest, &digest_len, EVP_sha1(), nullptr);
+    unsigned char accept[64];
+    const int accept_len = EVP_EncodeBlock(accept, digest, digest_len);
+
+    string res = "HTTP/1.1 101 Switching Protocols\r\n"
+                 "Upgrade: websocket\r\n"
+                 "Connection: Upgrade\r\n"
+                 "Sec-WebSocket-Accept: ";
+    res.append(reinterpret_cast<const char*>(accept), accept_len);
+    res += "\r\n\r\n";
+    return res;
+}
+
+string WebSocket::frame(Opcode opcode, string_view payload) {
+    string res;
+    res.reserve(payload.size() + 10);
+    res.push_back(static_cast<char>(0x80 | opcode));
+    const size_t len = payload.size();
+    if(len < 126) {
+        res.push_back(static_cast<char>(len));
+    } else if(len <= 0xFFFF) {
+        res.push_back(126);
+        res.push_back(static_cast<char>(len >> 8));
+        res.push_back(static_cast<char>(len));
+    } else {
+        res.push_back(127);
+        for(int shift = 56; shift >= 0; shift -= 8) {
+            res.push_back(static_cast<char>(static_cast<uint64_t>(len) >> shift));
+        }
+    }
+    res.append(payload);
+    return res;
+}
+
+void WebSocket::unmask(char* data, size_t len, const uint8_t mask[4]) {
+    // 掩码按 4 字节循环，向量宽度是 4 的倍数，每块的起点都与掩码对齐
+    uint32_t key;
+    memcpy(&key, mask, 4);
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i key32 = _mm256_set1_epi32(static_cast<int>(key));
+    for(; i + 32 <= len; i += 32) {
+        __m256i* p = reinterpret_cast<__m256i*>(data + i);
+        _mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), key32));
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i key16 = _mm_set1_epi32(static_cast<int>(key));
+    for(; i + 16 <= len; i += 16) {
+        __m128i* p = reinterpret_cast<__m128i*>(data + i);
+        _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), key16));
+    }
+#endif
+    const uint64_t key8 = static_cast<uint64_t>(key) << 32 | key;
+    for(; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        word ^= key8;
+        memcpy(data + i, &word, 8);
+    }
+    for(; i < len; ++i) {
+        data[i] ^= mask[i & 3];
+    }
+}
+
+void WebSocket::close(uint16_t code, ChainBuffer& out) {
+    if(closing_) return;
+    closing_ = true;
+    const char payload[2] = { static_cast<char>(code >> 8), static_cast<char>(code) };
+    out.append(frame(CLOSE, string_view(payload, sizeof(payload))));
+}
+
+void WebSocket::on_read(Buffer& in, ChainBuffer& out, std::vector<Message>& messages) {
+    while(!closing_) {
+        const auto view = in.readable_view();
+        if(view.size() < 2) return;
+        const uint8_t b0 = view[0];
+        const uint8_t b1 = view[1];
+        const bool fin = b0 & 0x80;
+        const auto opcode = static_cast<Opcode>(b0 & 0x0F);
+        // 没有协商扩展，RSV 必须为 0；客户端帧必须带掩码
+        if((b0 & 0x70) || !(b1 & 0x80)) {
+            close(1002, out);
+            return;
+        }
+        uint64_t len = b1 & 0x7F;
+        size_t header = 2;
+        if(len == 126) {
+            if(view.size() < 4) return;
+            len = static_cast<uint8_t>(view[2]) << 8 | static_cast<uint8_t>(view[3]);
+            header = 4;
+        } else if(len == 127) {
+            if(view.size() < 10) return;
+            len = 0;
+            for(int i = 2; i < 10; ++i) len = len << 8 | static_cast<uint8_t>(view[i]);
+            header = 10;
+        }
+        const bool control = opcode & 0x8;
+        if(control && (!fin || len > 125)) {
+            close(1002, out);
+            return;
+        }
+        if(len > kMaxMessage || message_.size() + len > kMaxMessage) {
+            close(1009, out);
+            return;
+        }
+        if(view.size() < header + 4 + len) return;
+
+        uint8_t mask[4];
+        memcpy(mask, view.data() + header, 4);
+        char* payload = in.begin_read() + header + 4;
+        unmask(payload, len, mask);
+        const string_view data(payload, len);
+        alive_ = true;
+
+        switch(opcode) {
+            case CONTINUATION:
+                if(message_opcode_ == CONTINUATION) {
+                    close(1002, out);
+                    return;
+                }
+                message_.append(data);
+                break;
+            case TEXT:
+            case BINARY:
+                if(message_opcode_ != CONTINUATION) {
+                    close(1002, out);
+                    return;
+                }
+                message_opcode_ = opcode;
+                message_.assign(data);
+                break;
+            case CLOSE:
+                if(len == 1) {
+                    close(1002, out);
+                    return;
+                }
+                // 回送对端的状态码，没有则回空的关闭帧
+                closing_ = true;
+                out.append(frame(CLOSE, data.substr(0, 2)));
+                break;
+            case PING:
+                out.append(frame(PONG, data));
+                break;
+            case PONG:
+                break;
+            default:
+                close(1002, out);
+                return;
+        }
+        in.retrieve(header + 4 + len);
+        if(!control && fin) {
+            messages.push_back({ message_opcode_, std::move(message_) });
+            message_.clear();
+            message_opcode_ = CONTINUATION;
+        }
+    }
+}
+
+void WsHub::subscribe(const string& topic, HttpConn* conn, uint64_t generation) {
+    topics_[topic].push_back({ conn, generation });
+}
+
+void WsHub::unsubscribe(const string& topic, HttpConn* conn) {
+    auto it = topics_.find(topic);
+    if(it == topics_.end()) return;
+    auto& subs = it->second;
+    subs.erase(std::remove_if(subs.begin(), subs.end(), [conn](const Subscriber& s) { return s.conn == conn; }),
+               subs.end());
+    if(subs.empty()) topics_.erase(it);
+}
+
+std::vector<WsHub::Subscriber>* WsHub::find(const string& topic) {
+    auto it = topics_.find(topic);
+    return it == topics_.end() ? nullptr : &it->second;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../buffer/buffer.h"
+#include "../buffer/chainbuffer.h"
+
+class HttpConn;
+
+// RFC 6455 的帧层：升级之后本连接的读写都交给它处理
+// 服务端发出的帧不加掩码，同一帧可以作为共享块追加到多个连接的写缓冲区
+class WebSocket {
+public:
+    enum Opcode : uint8_t {
+        CONTINUATION = 0x0,
+        TEXT = 0x1,
+        BINARY = 0x2,
+        CLOSE = 0x8,
+        PING = 0x9,
+        PONG = 0xA,
+    };
+
+    struct Message {
+        Opcode opcode;
+        std::string data;
+    };
+
+    static constexpr size_t kMaxMessage = 1 << 20;
+
+    // 101 响应，key 为 Sec-WebSocket-Key
+    static std::string handshake_response(std::string_view key);
+
+    // 组一个完整的服务端帧
+    static std::string frame(Opcode opcode, std::string_view payload);
+
+    // 客户端帧负载的掩码异或，按 16/32 字节向量处理，尾部逐字节
+    static void unmask(char* data, size_t len, const uint8_t mask[4]);
+
+    explicit WebSocket(std::string topic) : topic_(std::move(topic)) {}
+
+    const std::string& topic() const { return topic_; }
+
+    // 消费读缓冲区中完整的帧：控制帧就地应答，完整的数据消息追加到 messages
+    void on_read(Buffer& in, ChainBuffer& out, std::vector<Message>& messages);
+
+    // 发送关闭帧，之后不再处理收到的数据帧
+    void close(uint16_t code, ChainBuffer& out);
+
+    // 为 false 时写完缓冲区即可关闭连接
+    bool is_open() const { return !closing_; }
+
+    // 心跳：上次检查之后收到过任何帧才算存活，检查同时清除标记
+    bool check_alive() {
+        const bool alive = alive_;
+        alive_ = false;
+        return alive;
+    }
+
+private:
+    std::string topic_;
+    std::string message_;               // 分片消息的已收部分
+    Opcode message_opcode_ = CONTINUATION;  // 为 CONTINUATION 表示没有未完成的消息
+    bool alive_ = true;
+    bool closing_ = false;
+};
+
+// 每个 IO 线程一份的订阅表：主题（升级请求的路径）到连接
+// 只在所属线程中访问；连接关闭后可能留下失效的项，按 generation 识别，广播和心跳时清理
+class WsHub {
+public:
+    struct Subscriber {
+        HttpConn* conn;
+        uint64_t generation;
+    };
+
+    static WsHub& local() {
+        thread_local WsHub hub;
+        return hub;
+    }
+
+    void subscribe(const std::string& topic, HttpConn* conn, uint64_t generation);
+    void unsubscribe(const std::string& topic, HttpConn* conn);
+
+    std::vector<Subscriber>* find(const std::string& topic);
+    std::unordered_map<std::string, std::vector<Subscriber>>& topics() { return topics_; }
+
+private:
+    WsHub() = default;
+
+    std::unordered_map<std::string, std::vector<Subscriber>> topics_;
+};
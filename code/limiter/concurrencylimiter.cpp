@@ -0,0 +1,86 @@
+#include "concurrencylimiter.h"
+#include <algorithm>
+#include <cmath>
+#include "../metrics/metrics.h"
+
+static ConcurrencyLimiter::Options g_options;
+static thread_local ConcurrencyLimiter* t_limiter = nullptr;
+
+void ConcurrencyLimiter::set_options(const Options& options) {
+    g_options = options;
+}
+
+const ConcurrencyLimiter::Options& ConcurrencyLimiter::options() {
+    return g_options;
+}
+
+ConcurrencyLimiter& ConcurrencyLimiter::local() {
+    if(!t_limiter) {
+        // 与线程同生命周期；连接关闭时可能从别的线程 release，故不随线程退出释放
+        t_limiter = new ConcurrencyLimiter();
+    }
+    return *t_limiter;
+}
+
+ConcurrencyLimiter::ConcurrencyLimiter()
+    : opts_(g_options), limit_(std::clamp(g_options.initial_limit, g_options.min_limit, g_options.max_limit)) {
+    publish_();
+}
+
+bool ConcurrencyLimiter::try_acquire(Priority priority) {
+    // 只有所属线程会增加 inflight_，先检查再加不会超发
+    const int cur = inflight_.load(std::memory_order_relaxed);
+    double cap = limit_;
+    if(priority == Priority::low) cap *= opts_.low_priority_share;
+    if(cur >= std::max(1.0, cap)) {
+        return false;
+    }
+    inflight_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void ConcurrencyLimiter::release(uint64_t latency_ns, bool dropped) {
+    const int before = inflight_.fetch_sub(1, std::memory_order_relaxed);
+    if(this != t_limiter) {
+        return;
+    }
+    if(opts_.algorithm == Algorithm::aimd) update_aimd_(latency_ns, dropped, before);
+    else if(!dropped) update_gradient_(latency_ns, before);
+    publish_();
+}
+
+void ConcurrencyLimiter::update_gradient_(uint64_t latency_ns, int inflight) {
+    const double sample = std::max<double>(latency_ns, 1000.0);
+    if(long_rtt_ == 0) {
+        long_rtt_ = sample;
+        return;
+    }
+    // 基线按约 600 个样本的窗口平滑；负载长时间偏高时让基线缓慢回落，避免把拥塞当成常态
+    long_rtt_ += (sample - long_rtt_) / 600.0;
+    if(long_rtt_ / sample > 2.0) long_rtt_ *= 0.95;
+
+    // 远未用满时延迟不反映容量，不调整
+    if(inflight * 2 < limit_) return;
+
+    static constexpr double kTolerance = 1.5;
+    static constexpr double kSmoothing = 0.2;
+    const double gradient = std::clamp(kTolerance * long_rtt_ / sample, 0.5, 1.0);
+    const double target = limit_ * gradient + std::sqrt(limit_);
+    limit_ = std::clamp(limit_ * (1 - kSmoothing) + target * kSmoothing,
+                        static_cast<double>(opts_.min_limit), static_cast<double>(opts_.max_limit));
+}
+
+void ConcurrencyLimiter::update_aimd_(uint64_t latency_ns, bool dropped, int inflight) {
+    if(dropped || latency_ns > opts_.aimd_timeout_ns) {
+        limit_ *= 0.9;
+    } else if(inflight * 2 >= limit_) {
+        limit_ += 1.0;
+    }
+    limit_ = std::clamp(limit_, static_cast<double>(opts_.min_limit), static_cast<double>(opts_.max_limit));
+}
+
+void ConcurrencyLimiter::publish_() {
+    LoopMetrics& metrics = LoopMetrics::local();
+    metrics.concurrency_limit.set(static_cast<uint64_t>(limit_));
+    metrics.inflight.set(inflight_.load(std::memory_order_relaxed));
+}
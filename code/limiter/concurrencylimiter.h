@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// 自适应并发上限，思路同 Netflix concurrency-limits：按实测请求延迟调整每个 IO 循环可同时处理的请求数
+// - gradient：长期延迟基线与当前样本之比作为梯度，延迟上升时收缩，空闲时以 sqrt(limit) 为步长增长
+// - aimd：延迟超过阈值或请求被丢弃时乘性减小，否则加性增长
+// 低优先级（访问数据库的路由）只能使用上限的一部分，静态资源始终保留余量
+class ConcurrencyLimiter {
+public:
+    enum class Algorithm { gradient, aimd };
+    enum class Priority { high, low };
+
+    struct Options {
+        Algorithm algorithm = Algorithm::gradient;
+        int min_limit = 8;
+        int max_limit = 1000;
+        int initial_limit = 100;
+        double low_priority_share = 0.5;        // 低优先级请求可占用的比例
+        uint64_t aimd_timeout_ns = 50000000;     // aimd：超过该延迟视为过载
+    };
+
+    // 在启动 IO 线程之前设置，之后创建的限流器都使用这份配置
+    static void set_options(const Options& options);
+    static const Options& options();
+
+    // 当前 IO 线程的限流器
+    static ConcurrencyLimiter& local();
+
+    bool try_acquire(Priority priority);
+
+    // 请求结束：latency_ns 为请求延迟，dropped 表示连接在响应写完前被关闭
+    // 任意线程都可以调用，只有所属线程会据此调整上限
+    void release(uint64_t latency_ns, bool dropped);
+
+    int limit() const { return static_cast<int>(limit_); }
+    int inflight() const { return inflight_.load(std::memory_order_relaxed); }
+
+private:
+    ConcurrencyLimiter();
+
+    void update_gradient_(uint64_t latency_ns, int inflight);
+    void update_aimd_(uint64_t latency_ns, bool dropped, int inflight);
+    void publish_();
+
+    const Options& opts_;
+    double limit_;
+    double long_rtt_ = 0;                       // 长期延迟基线（EWMA），单位 ns
+    std::atomic<int> inflight_{0};
+};
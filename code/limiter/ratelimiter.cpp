@@ -0,0 +1,136 @@
+#include "ratelimiter.h"
+#include <algorithm>
+
+RateLimiter* RateLimiter::instance() {
+    static RateLimiter limiter;
+    return &limiter;
+}
+
+void RateLimiter::init(const Options& options) {
+    size_t sets = 1;
+    while(sets * kWays < options.capacity) sets <<= 1;
+    sets_.reset(new Set[sets]);
+    set_mask_ = sets - 1;
+    update(options);
+}
+
+void RateLimiter::update(const Options& options) {
+    max_conns_.store(options.max_conns, std::memory_order_relaxed);
+    for(size_t i = 0; i < static_cast<size_t>(RouteClass::count); ++i) {
+        const Rule& rule = options.rules[i];
+        const uint64_t interval = rule.rate ? 1000000000ull / rule.rate : 0;
+        // 连续 burst 个请求的理论到达时间最多领先当前时刻 burst 个间隔
+        tolerance_ns_[i].store(interval * (rule.burst ? rule.burst : 1), std::memory_order_relaxed);
+        interval_ns_[i].store(interval, std::memory_order_relaxed);
+    }
+}
+
+RateLimiter::Set& RateLimiter::set_of_(uint32_t ip) const {
+    // 乘法哈希取高位，同一网段的相邻地址分散到不同组
+    const uint64_t h = ip * 0x9E3779B97F4A7C15ull;
+    return sets_[(h >> 32) & set_mask_];
+}
+
+RateLimiter::Slot* RateLimiter::find_(uint32_t ip) {
+    Set& set = set_of_(ip);
+    // 插入时可能与别的线程竞争同一个槽，重试几次仍失败就放行，不为限流阻塞请求
+    for(int attempt = 0; attempt < 3; ++attempt) {
+        Slot* victim = nullptr;
+        uint64_t victim_owner = 0;
+        uint64_t victim_seen = UINT64_MAX;
+        for(Slot& slot : set.slots) {
+            const uint64_t owner = slot.owner.load(std::memory_order_acquire);
+            if(owner != 0 && ip_of_(owner) == ip) {
+                return &slot;
+            }
+            if(conns_of_(owner) > 0) {
+                continue;
+            }
+            // 空槽最优先；否则挑最近一次请求最早的槽
+            uint64_t seen = 0;
+            if(owner != 0) {
+                for(const auto& tat : slot.tat) {
+                    seen = std::max(seen, tat.load(std::memory_order_relaxed));
+                }
+            }
+            if(seen < victim_seen) {
+                victim = &slot;
+                victim_owner = owner;
+                victim_seen = seen;
+            }
+        }
+        if(!victim) {
+            return nullptr;
+        }
+        // 只有连接数为 0 时才能抢占，正在计数的槽不会被淘汰
+        if(victim->owner.compare_exchange_strong(victim_owner, pack_(ip, 0), std::memory_order_acq_rel)) {
+            for(auto& tat : victim->tat) {
+                tat.store(0, std::memory_order_relaxed);
+            }
+            return victim;
+        }
+    }
+    return nullptr;
+}
+
+bool RateLimiter::acquire_conn(uint32_t ip, bool* counted) {
+    *counted = false;
+    const uint32_t max_conns = max_conns_.load(std::memory_order_relaxed);
+    if(max_conns == 0) {
+        return true;
+    }
+    Slot* slot = find_(ip);
+    if(!slot) {
+        return true;
+    }
+    uint64_t owner = slot->owner.load(std::memory_order_relaxed);
+    do {
+        if(ip_of_(owner) != ip) {
+            return true;        // 刚好被淘汰，放行
+        }
+        if(conns_of_(owner) >= max_conns) {
+            return false;
+        }
+    } while(!slot->owner.compare_exchange_weak(owner, owner + 1, std::memory_order_acq_rel));
+    *counted = true;
+    return true;
+}
+
+void RateLimiter::release_conn(uint32_t ip) {
+    if(max_conns_.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+    // 并发插入可能让同一地址占了两个槽，找连接数不为 0 的那个
+    Set& set = set_of_(ip);
+    for(Slot& slot : set.slots) {
+        uint64_t owner = slot.owner.load(std::memory_order_relaxed);
+        while(ip_of_(owner) == ip && conns_of_(owner) > 0) {
+            if(slot.owner.compare_exchange_weak(owner, owner - 1, std::memory_order_acq_rel)) {
+                return;
+            }
+        }
+    }
+}
+
+bool RateLimiter::allow(uint32_t ip, RouteClass cls, uint64_t now_ns) {
+    const size_t idx = static_cast<size_t>(cls);
+    const uint64_t interval = interval_ns_[idx].load(std::memory_order_relaxed);
+    if(interval == 0) {
+        return true;
+    }
+    Slot* slot = find_(ip);
+    if(!slot) {
+        return true;
+    }
+    std::atomic<uint64_t>& tat = slot->tat[idx];
+    uint64_t cur = tat.load(std::memory_order_relaxed);
+    const uint64_t tolerance = tolerance_ns_[idx].load(std::memory_order_relaxed);
+    uint64_t next;
+    do {
+        next = std::max(cur, now_ns) + interval;
+        if(next - now_ns > tolerance) {
+            return false;
+        }
+    } while(!tat.compare_exchange_weak(cur, next, std::memory_order_relaxed));
+    return true;
+}
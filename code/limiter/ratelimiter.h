@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// 按客户端 IPv4 地址的限流表：每个地址的并发连接数 + 按路由类别的令牌桶
+// 固定内存的组相联哈希表，每组 kWays 个槽，组满时淘汰组内最久未访问且没有连接的槽（近似 LRU），
+// 地址再多表也不会增长。所有操作都是对槽内 64 位原子量的 CAS，accept 线程和 IO 线程并发访问无锁
+// 令牌桶用 GCRA 实现：每个类别只存一个“理论到达时间”，不需要单独记录余量和补充时刻
+class RateLimiter {
+public:
+    enum class RouteClass : uint8_t { static_file, dynamic, count };
+
+    struct Rule {
+        uint32_t rate = 0;          // 每秒允许的请求数，0 表示不限
+        uint32_t burst = 1;         // 允许的突发请求数
+    };
+
+    struct Options {
+        size_t capacity = 1 << 18;  // 槽数，向上取整到 2 的幂
+        uint32_t max_conns = 0;     // 每个地址的最大并发连接数，0 表示不限
+        Rule rules[static_cast<size_t>(RouteClass::count)];
+    };
+
+    static RateLimiter* instance();
+
+    // 在启动服务之前调用；未调用时不做任何限制，不分配表
+    void init(const Options& options);
+
+    // 运行中替换规则和连接上限，表的容量不变；各项分别原子替换，正在进行的检查可能用到新旧混合的值
+    // 连接上限不能在 0 与非 0 之间切换：之前的连接没有计数，释放时会算错
+    void update(const Options& options);
+
+    // accept 之后调用，返回 false 表示该地址连接数已满
+    // 不限连接数、表中抢不到槽或槽刚被淘汰时放行但不计数，*counted 为 false；只有计数的连接才能 release_conn
+    bool acquire_conn(uint32_t ip, bool* counted);
+    void release_conn(uint32_t ip);
+
+    // 每个请求调用一次，now_ns 取 CLOCK_MONOTONIC
+    bool allow(uint32_t ip, RouteClass cls, uint64_t now_ns);
+
+private:
+    static constexpr int kWays = 8;
+
+    // owner 高 32 位为地址、低 32 位为连接数，两者一起 CAS：淘汰与连接计数不会交错
+    // 地址 0（0.0.0.0）不会是客户端地址，owner 为 0 表示空槽
+    struct Slot {
+        std::atomic<uint64_t> owner{0};
+        std::atomic<uint64_t> tat[static_cast<size_t>(RouteClass::count)]{};
+    };
+
+    struct alignas(64) Set {
+        Slot slots[kWays];
+    };
+
+    RateLimiter() = default;
+
+    Slot* find_(uint32_t ip);
+    Set& set_of_(uint32_t ip) const;
+
+    static uint64_t pack_(uint32_t ip, uint32_t conns) { return static_cast<uint64_t>(ip) << 32 | conns; }
+    static uint32_t ip_of_(uint64_t owner) { return owner >> 32; }
+    static uint32_t conns_of_(uint64_t owner) { return static_cast<uint32_t>(owner); }
+
+    std::atomic<uint32_t> max_conns_{0};
+    std::atomic<uint64_t> interval_ns_[static_cast<size_t>(RouteClass::count)]{};   // 0 表示不限
+    std::atomic<uint64_t> tolerance_ns_[static_cast<size_t>(RouteClass::count)]{};
+    size_t set_mask_ = 0;
+    std::unique_ptr<Set[]> sets_;
+};
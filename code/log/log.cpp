@@ -54,10 +54,10 @@ void Log::init(int level = 1, const string& path, const string& suffix,
             fclose(fp_);
         }
 
-        fp_ = fopen(file_name, "a");
+        fp_ = fopen(file_name, "ae");
         if(fp_ == nullptr) {
             mkdir(path.c_str(), 0777);
-            fp_ = fopen(file_name, "a");
+            fp_ = fopen(file_name, "ae");
         }
     }
 }
@@ -90,7 +90,7 @@ void Log::write(int level, const char *format, ...) {
         lck.lock();
         flush();
         fclose(fp_);
-        fp_ = fopen(new_file, "a");
+        fp_ = fopen(new_file, "ae");
     }
 
     {
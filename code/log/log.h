@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <mutex>
 #include <string>
 #include <thread>
@@ -24,15 +25,12 @@ public:
     void write(int level, const char *format,...);
     void flush();
 
-    int get_level() {
-        std::lock_guard<std::mutex> lck(mtx_);
-        return level_;
-    }
-    void set_level(int level) {
-        std::lock_guard<std::mutex> lck(mtx_);
-        level_ = level;
-    }
+    // 每条日志都要比较等级，不加锁；运行中可由 SIGHUP 重新加载修改
+    int get_level() { return level_.load(std::memory_order_relaxed); }
+    void set_level(int level) { level_.store(level, std::memory_order_relaxed); }
     bool is_open() { return is_open_; }
+    // 异步写线程，同步模式下为空
+    std::thread* writer_thread() { return write_thread_.get(); }
     
 private:
     Log();
@@ -54,7 +52,7 @@ private:
     bool is_open_ = false;
  
     Buffer buffer_;
-    int level_ = 1;
+    std::atomic<int> level_{1};
     bool is_async_ = false;
 
     FILE* fp_ = nullptr;
@@ -1,14 +1,28 @@
 #include <unistd.h>
+#include <cstdio>
+#include <cstring>
 #include "server/webserver.h"
 
-int main() {
+int main(int argc, char* argv[]) {
     /* 守护进程 后台运行 */
-    //daemon(1, 0); 
+    //daemon(1, 0);
 
-    WebServer server(
-        2316, 3, 60000, false,             /* 端口 ET模式 timeoutMs 优雅退出  */
-        3306, "root", "root", "webserver", /* Mysql配置 */
-        12, 6, true, 1, 1024);             /* 连接池数量 线程池数量 日志开关 日志等级 日志异步队列容量 */
+    /* 设置见 server.ini 与 ./server -h：-c 指定配置文件，--节.键=值 覆盖其中的单项，如
+       ./server -c server.ini --server.port=8080 --log.level=0
+       kill -HUP 重新读取配置文件（只有标 * 的设置在运行中生效），kill -USR2 以同样的参数热重启 */
+    for(int i = 1; i < argc; ++i) {
+        if(strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_config_usage(stdout, argv[0]);
+            return 0;
+        }
+    }
+    ServerConfig config;
+    std::string error;
+    if(!parse_config_args(argc, argv, config, error)) {
+        fprintf(stderr, "%s\n(%s -h lists all keys)\n", error.c_str(), argv[0]);
+        return 1;
+    }
+
+    WebServer server(config);
     server.start();
-} 
-  
\ No newline at end of file
+}
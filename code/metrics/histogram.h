@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// HDR 风格的对数线性直方图：每个 2 的幂区间再等分为 2^(kSubBits-1) 个桶
+// 相对误差不超过 1/2^(kSubBits-1)，记录 O(1)，内存固定
+class Histogram {
+public:
+    static constexpr int kSubBits = 8;
+    static constexpr int kMaxBits = 40;     // 以 ns 计约 18 分钟，超出的值截断到上限
+    static constexpr uint64_t kSubCount = 1ull << kSubBits;
+    static constexpr uint64_t kHalfCount = kSubCount >> 1;
+    static constexpr uint64_t kMaxValue = (1ull << kMaxBits) - 1;
+    static constexpr size_t kBuckets = (kMaxBits - kSubBits + 2) * kHalfCount;
+
+    Histogram() : counts_(kBuckets, 0) {}
+
+    static size_t index_of(uint64_t value) {
+        value = std::min(value, kMaxValue);
+        if(value < kSubCount) return value;
+        const int shift = 63 - __builtin_clzll(value) - (kSubBits - 1);
+        return shift * kHalfCount + (value >> shift);
+    }
+
+    // 桶内最大值，百分位按此返回，与 HdrHistogram 的 highest equivalent value 一致
+    static uint64_t highest_equivalent(size_t index) {
+        if(index < kSubCount) return index;
+        const int shift = index / kHalfCount - 1;
+        const uint64_t sub = index % kHalfCount + kHalfCount;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    void record(uint64_t value, uint64_t count = 1) {
+        counts_[index_of(value)] += count;
+        total_ += count;
+        sum_ += value * count;
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+
+    // 闭环压测时补录因等待而“遗漏”的样本（协调遗漏修正）
+    void record_corrected(uint64_t value, uint64_t expected_interval) {
+        record(value);
+        if(expected_interval == 0) return;
+        for(uint64_t missing = value > expected_interval ? value - expected_interval : 0;
+            missing >= expected_interval; missing -= expected_interval) {
+            record(missing);
+        }
+    }
+
+    void merge(const Histogram& other) {
+        for(size_t i = 0; i < kBuckets; ++i) {
+            counts_[i] += other.counts_[i];
+        }
+        total_ += other.total_;
+        sum_ += other.sum_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    void reset() {
+        std::fill(counts_.begin(), counts_.end(), 0);
+        total_ = sum_ = max_ = 0;
+        min_ = UINT64_MAX;
+    }
+
+    uint64_t percentile(double p) const {
+        if(total_ == 0) return 0;
+        uint64_t target = static_cast<uint64_t>(p / 100.0 * total_ + 0.5);
+        target = std::clamp<uint64_t>(target, 1, total_);
+        uint64_t seen = 0;
+        for(size_t i = 0; i < kBuckets; ++i) {
+            seen += counts_[i];
+            if(seen >= target) return std::min(highest_equivalent(i), max_);
+        }
+        return max_;
+    }
+
+    uint64_t count() const { return total_; }
+    uint64_t sum() const { return sum_; }
+    uint64_t min() const { return total_ ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    double mean() const { return total_ ? static_cast<double>(sum_) / total_ : 0.0; }
+
+    uint64_t bucket_count(size_t index) const { return counts_[index]; }
+
+private:
+    std::vector<uint64_t> counts_;
+    uint64_t total_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t min_ = UINT64_MAX;
+    uint64_t max_ = 0;
+};
@@ -0,0 +1,206 @@
+#include "metrics.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+#include <stdexcept>
+
+#include "../buffer/chainbuffer.h"
+
+static thread_local LoopMetrics* t_loop_metrics = nullptr;
+
+LoopMetrics& LoopMetrics::local() {
+    if(!t_loop_metrics) {
+        t_loop_metrics = Metrics::instance()->register_loop();
+    }
+    return *t_loop_metrics;
+}
+
+void LoopMetrics::bind(LoopMetrics* metrics) {
+    t_loop_metrics = metrics;
+    metrics->thread = pthread_self();
+    metrics->has_thread = true;
+}
+
+const char* trace_stage_name(TraceStage stage) {
+    static const char* const names[] = {
+        "idle", "event", "functor", "timer", "accept", "read", "parse", "respond", "write", "close",
+    };
+    size_t idx = static_cast<size_t>(stage);
+    return idx < sizeof(names) / sizeof(names[0]) ? names[idx] : "unknown";
+}
+
+Metrics* Metrics::instance() {
+    static Metrics inst;
+    return &inst;
+}
+
+LoopMetrics* Metrics::register_loop() {
+    std::lock_guard<std::mutex> lck(mtx_);
+    int id = count_.load(std::memory_order_relaxed);
+    if(id >= kMaxLoops) {
+        throw std::length_error("too many metrics slots");
+    }
+    // 槽位随进程存活，EventLoop 析构后其计数仍可被抓取
+    auto* metrics = new LoopMetrics(id);
+    loops_[id].store(metrics, std::memory_order_release);
+    count_.store(id + 1, std::memory_order_release);
+    return metrics;
+}
+
+int64_t Metrics::connections() const {
+    int64_t res = 0;
+    const int n = count_.load(std::memory_order_acquire);
+    for(int i = 0; i < n; ++i) {
+        const LoopMetrics* m = loops_[i].load(std::memory_order_acquire);
+        res += static_cast<int64_t>(m->conns_opened.get()) - static_cast<int64_t>(m->conns_closed.get());
+    }
+    return res;
+}
+
+namespace {
+
+void append_fmt(std::string& out, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+void append_fmt(std::string& out, const char* fmt, ...) {
+    char line[256];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if(n > 0) out.append(line, std::min<size_t>(n, sizeof(line) - 1));
+}
+
+void append_header(std::string& out, const char* name, const char* type, const char* help) {
+    append_fmt(out, "# HELP webserver_%s %s\n# TYPE webserver_%s %s\n", name, help, name, type);
+}
+
+}
+
+std::string Metrics::scrape() const {
+    const int n = count_.load(std::memory_order_acquire);
+    const LoopMetrics* loops[kMaxLoops];
+    for(int i = 0; i < n; ++i) {
+        loops[i] = loops_[i].load(std::memory_order_acquire);
+    }
+
+    std::string out;
+    out.reserve(8192);
+
+    struct CounterDesc {
+        const char* name;
+        const char* type;
+        const char* help;
+        const Counter LoopMetrics::* member;
+    };
+    static const CounterDesc counters[] = {
+        { "accepts_total",           "counter", "Accepted connections.",                  &LoopMetrics::accepts },
+        { "connections_opened_total","counter", "Connections handed to HttpConn.",        &LoopMetrics::conns_opened },
+        { "connections_closed_total","counter", "Connections closed.",                    &LoopMetrics::conns_closed },
+        { "requests_total",          "counter", "Requests parsed.",                       &LoopMetrics::requests },
+        { "parse_errors_total",      "counter", "Requests rejected by the parser.",       &LoopMetrics::parse_errors },
+        { "bytes_in_total",          "counter", "Bytes read from clients.",               &LoopMetrics::bytes_in },
+        { "bytes_out_total",         "counter", "Bytes written to clients.",              &LoopMetrics::bytes_out },
+        { "timer_expiries_total",    "counter", "Timer callbacks fired.",                 &LoopMetrics::timer_expiries },
+        { "loop_wakeups_total",      "counter", "Returns from epoll_wait.",               &LoopMetrics::wakeups },
+        { "epoll_events_total",      "counter", "Events returned by epoll_wait.",         &LoopMetrics::epoll_events },
+        { "loop_requeued_total",     "counter", "Dispatches queued on the ready list.",   &LoopMetrics::requeued },
+        { "pending_functors_total",  "counter", "Functors run from the pending queue.",   &LoopMetrics::functors },
+        { "pending_functors_depth",  "gauge",   "Size of the last pending functor batch.",&LoopMetrics::functor_depth },
+        { "shed_total",              "counter", "Requests rejected by admission control.",&LoopMetrics::shed },
+        { "rate_limited_total",      "counter", "Rejected by per-client limits.",         &LoopMetrics::rate_limited },
+        { "concurrency_limit",       "gauge",   "Adaptive concurrency limit.",            &LoopMetrics::concurrency_limit },
+        { "inflight_requests",       "gauge",   "Admitted requests not yet answered.",    &LoopMetrics::inflight },
+        { "tls_handshakes_total",    "counter", "Completed TLS handshakes.",              &LoopMetrics::tls_handshakes },
+        { "tls_resumed_total",       "counter", "TLS handshakes resumed from a ticket.",  &LoopMetrics::tls_resumed },
+        { "ktls_total",              "counter", "TLS connections with kernel TLS send.",  &LoopMetrics::ktls },
+        { "slow_client_evictions_total", "counter", "Stalled readers closed over the output budget.", &LoopMetrics::evicted },
+        { "file_cache_hits_total",   "counter", "Static files served from the file cache.", &LoopMetrics::file_cache_hits },
+        { "file_cache_misses_total", "counter", "Static file lookups that missed the cache.", &LoopMetrics::file_cache_misses },
+        { "loop_poll_ns_total",      "counter", "Nanoseconds spent in epoll_wait.",       &LoopMetrics::poll_ns },
+        { "loop_callback_ns_total",  "counter", "Nanoseconds spent in channel callbacks.",&LoopMetrics::callback_ns },
+        { "loop_functor_ns_total",   "counter", "Nanoseconds spent in pending functors.", &LoopMetrics::functor_ns },
+        { "loop_timer_ns_total",     "counter", "Nanoseconds spent in timer callbacks.",  &LoopMetrics::timer_ns },
+        { "loop_stalls_total",       "counter", "Iterations that exceeded the watchdog threshold.", &LoopMetrics::stalls },
+    };
+    for(const auto& desc : counters) {
+        append_header(out, desc.name, desc.type, desc.help);
+        for(int i = 0; i < n; ++i) {
+            append_fmt(out, "webserver_%s{loop=\"%d\"} %" PRIu64 "\n",
+                       desc.name, loops[i]->id, (loops[i]->*desc.member).get());
+        }
+    }
+
+    append_header(out, "loop_busy_seconds", "summary", "Time per loop iteration outside epoll_wait.");
+    for(int i = 0; i < n; ++i) {
+        Histogram busy;
+        loops[i]->busy.merge_into(busy);
+        for(double q : {0.5, 0.99, 0.999}) {
+            append_fmt(out, "webserver_loop_busy_seconds{loop=\"%d\",quantile=\"%g\"} %.9f\n",
+                       loops[i]->id, q, busy.percentile(q * 100) / 1e9);
+        }
+        append_fmt(out, "webserver_loop_busy_seconds_count{loop=\"%d\"} %" PRIu64 "\n", loops[i]->id, busy.count());
+    }
+
+    append_header(out, "loop_slowest_callback_seconds", "gauge", "Slowest callback in the last watchdog interval.");
+    for(int i = 0; i < n; ++i) {
+        uint64_t s = loops[i]->last_slowest.load(std::memory_order_relaxed);
+        uint32_t where = LoopMetrics::slow_stage(s);
+        append_fmt(out, "webserver_loop_slowest_callback_seconds{loop=\"%d\",stage=\"%s\",fd=\"%d\"} %.6f\n",
+                   loops[i]->id, trace_stage_name(stage_of(where)), fd_of(where), LoopMetrics::slow_us(s) / 1e6);
+    }
+
+    append_header(out, "responses_total", "counter", "Responses by status code.");
+    for(int i = 0; i < n; ++i) {
+        for(size_t s = 0; s <= STATUS_TABLE.size(); ++s) {
+            uint64_t v = loops[i]->status[s].get();
+            if(v == 0) continue;
+            if(s < STATUS_TABLE.size()) {
+                append_fmt(out, "webserver_responses_total{loop=\"%d\",code=\"%d\"} %" PRIu64 "\n",
+                           loops[i]->id, STATUS_TABLE[s].key, v);
+            } else {
+                append_fmt(out, "webserver_responses_total{loop=\"%d\",code=\"other\"} %" PRIu64 "\n",
+                           loops[i]->id, v);
+            }
+        }
+    }
+
+    append_header(out, "connections", "gauge", "Open client connections.");
+    append_fmt(out, "webserver_connections %" PRId64 "\n", connections());
+
+    append_header(out, "output_buffer_bytes", "gauge", "Pooled memory held by unsent responses.");
+    append_fmt(out, "webserver_output_buffer_bytes %zu\n", BlockPool::in_use());
+
+    // 延迟直方图在抓取时合并，热路径上只有单写者的桶计数
+    Histogram merged;
+    uint64_t sum_ns = 0;
+    for(int i = 0; i < n; ++i) {
+        loops[i]->latency.merge_into(merged);
+        sum_ns += loops[i]->latency.sum();
+    }
+    static const double bounds[] = {
+        0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025,
+        0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10,
+    };
+    append_header(out, "request_duration_seconds", "histogram", "Time from first request byte to last response byte.");
+    uint64_t cumulative = 0;
+    size_t bucket = 0;
+    for(double le : bounds) {
+        const uint64_t limit = static_cast<uint64_t>(le * 1e9);
+        for(; bucket < Histogram::kBuckets && Histogram::highest_equivalent(bucket) <= limit; ++bucket) {
+            cumulative += merged.bucket_count(bucket);
+        }
+        append_fmt(out, "webserver_request_duration_seconds_bucket{le=\"%g\"} %" PRIu64 "\n", le, cumulative);
+    }
+    append_fmt(out, "webserver_request_duration_seconds_bucket{le=\"+Inf\"} %" PRIu64 "\n", merged.count());
+    append_fmt(out, "webserver_request_duration_seconds_sum %.9f\n", sum_ns / 1e9);
+    append_fmt(out, "webserver_request_duration_seconds_count %" PRIu64 "\n", merged.count());
+
+    append_header(out, "request_latency_seconds", "summary", "Request latency quantiles from the merged HDR histogram.");
+    for(double q : {0.5, 0.9, 0.99, 0.999}) {
+        append_fmt(out, "webserver_request_latency_seconds{quantile=\"%g\"} %.9f\n", q, merged.percentile(q * 100) / 1e9);
+    }
+    append_fmt(out, "webserver_request_latency_seconds_sum %.9f\n", sum_ns / 1e9);
+    append_fmt(out, "webserver_request_latency_seconds_count %" PRIu64 "\n", merged.count());
+    return out;
+}
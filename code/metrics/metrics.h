@@ -0,0 +1,189 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <ctime>
+#include <pthread.h>
+
+#include "histogram.h"
+#include "../http/httptables.h"
+
+inline uint64_t metrics_now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// 单写者计数器：只由所属线程递增，不需要带 lock 前缀的原子加；抓取线程以 relaxed 读取
+class Counter {
+public:
+    void add(uint64_t n = 1) noexcept {
+        value_.store(value_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    void set(uint64_t v) noexcept { value_.store(v, std::memory_order_relaxed); }
+    uint64_t get() const noexcept { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value_{0};
+};
+
+// 单写者无锁直方图，桶划分与 Histogram 相同，抓取时合并
+class ConcurrentHistogram {
+public:
+    ConcurrentHistogram() : counts_(new std::atomic<uint64_t>[Histogram::kBuckets]) {
+        for(size_t i = 0; i < Histogram::kBuckets; ++i) counts_[i].store(0, std::memory_order_relaxed);
+    }
+
+    void record(uint64_t value) noexcept {
+        auto& c = counts_[Histogram::index_of(value)];
+        c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        sum_.add(value);
+    }
+
+    void merge_into(Histogram& out) const {
+        for(size_t i = 0; i < Histogram::kBuckets; ++i) {
+            uint64_t n = counts_[i].load(std::memory_order_relaxed);
+            if(n) out.record(Histogram::highest_equivalent(i), n);
+        }
+    }
+
+    uint64_t sum() const noexcept { return sum_.get(); }
+
+private:
+    std::unique_ptr<std::atomic<uint64_t>[]> counts_;
+    Counter sum_;
+};
+
+// 回调所处阶段，由 trace.h 中的打点更新，用于慢回调和卡顿报告
+enum class TraceStage : uint8_t {
+    idle, event, functor, timer, accept, read, parse, respond, write, close,
+};
+const char* trace_stage_name(TraceStage stage);
+
+// 阶段与 fd 打包进一个 32 位原子量，watchdog 读取时不会读到撕裂的值
+inline uint32_t pack_stage(TraceStage stage, int fd) {
+    return static_cast<uint32_t>(stage) << 16 | (static_cast<uint32_t>(fd) & 0xFFFF);
+}
+inline TraceStage stage_of(uint32_t packed) { return static_cast<TraceStage>(packed >> 16); }
+inline int fd_of(uint32_t packed) {
+    int fd = packed & 0xFFFF;
+    return fd == 0xFFFF ? -1 : fd;
+}
+
+// 每个 EventLoop 一份的指标，按缓存行对齐，不同线程的计数器不会伪共享
+struct alignas(64) LoopMetrics {
+    explicit LoopMetrics(int id) : id(id) {}
+
+    const int id;
+
+    Counter accepts;
+    Counter conns_opened;
+    Counter conns_closed;
+    Counter requests;
+    Counter parse_errors;
+    Counter bytes_in;
+    Counter bytes_out;
+    Counter timer_expiries;
+    Counter wakeups;
+    Counter epoll_events;
+    Counter requeued;                               // 放进就绪队列的次数
+    Counter functors;
+    Counter functor_depth;                          // 最近一轮待处理任务队列长度
+    Counter shed;                                   // 过载时直接返回 503 的请求
+    Counter rate_limited;                           // 超过单个地址限额被拒绝的请求和连接
+    Counter concurrency_limit;                      // 当前自适应并发上限
+    Counter inflight;                               // 已准入、尚未写完响应的请求
+    Counter tls_handshakes;                         // 完成的 TLS 握手
+    Counter tls_resumed;                            // 其中通过会话票据恢复的
+    Counter ktls;                                   // 其中由内核接管加密发送的
+    Counter evicted;                                // 写缓冲超出 output_budget 时断开的不读的客户端
+    Counter file_cache_hits;                        // 静态文件内容取自缓存
+    Counter file_cache_misses;                      // 需要 stat 后重新读取或映射
+    Counter status[STATUS_TABLE.size() + 1];        // 按 STATUS_TABLE 下标，最后一个为其他
+    ConcurrentHistogram latency;                    // 请求延迟，单位 ns
+
+    // 一轮循环的耗时分布：epoll_wait 等待 / 就绪回调 / 待处理任务 / 定时器
+    Counter poll_ns;
+    Counter callback_ns;
+    Counter functor_ns;
+    Counter timer_ns;
+    ConcurrentHistogram busy;                       // 每轮除等待外的耗时，单位 ns
+
+    // 以下由 watchdog 读取
+    std::atomic<uint64_t> busy_since{0};            // 本轮开始处理的时刻，等待中为 0
+    std::atomic<uint32_t> current{0};               // 正在执行的阶段和 fd
+    std::atomic<uint64_t> slowest{0};               // 本周期最慢回调，见 pack_slow
+    pthread_t thread{};
+    bool has_thread = false;
+
+    Counter stalls;                                 // 仅由 watchdog 写
+    std::atomic<uint64_t> last_slowest{0};          // 上一周期最慢回调，仅由 watchdog 写
+
+    // 慢回调周期号，watchdog 每个周期加一
+    static inline std::atomic<uint32_t> interval{0};
+
+    // [周期号:16][阶段|fd:20][耗时 us:28]
+    static uint64_t pack_slow(uint32_t epoch, uint32_t stage, uint64_t us) {
+        us = std::min<uint64_t>(us, (1u << 28) - 1);
+        return static_cast<uint64_t>(epoch & 0xFFFF) << 48
+             | static_cast<uint64_t>(stage & 0xFFFFF) << 28 | us;
+    }
+    static uint32_t slow_epoch(uint64_t s) { return s >> 48; }
+    static uint32_t slow_stage(uint64_t s) { return (s >> 28) & 0xFFFFF; }
+    static uint64_t slow_us(uint64_t s) { return s & ((1u << 28) - 1); }
+
+    void count_status(int code) noexcept {
+        int idx = table_index(STATUS_TABLE, code);
+        status[idx < 0 ? STATUS_TABLE.size() : idx].add();
+    }
+
+    void mark(TraceStage stage, int fd) noexcept {
+        current.store(pack_stage(stage, fd), std::memory_order_relaxed);
+    }
+
+    // 记录一次回调耗时，保留本周期内最慢的一次
+    void note_callback(uint64_t ns) noexcept {
+        const uint32_t epoch = interval.load(std::memory_order_relaxed) & 0xFFFF;
+        const uint64_t us = ns / 1000;
+        const uint64_t prev = slowest.load(std::memory_order_relaxed);
+        if(slow_epoch(prev) != epoch || us > slow_us(prev)) {
+            slowest.store(pack_slow(epoch, current.load(std::memory_order_relaxed), us),
+                          std::memory_order_relaxed);
+        }
+    }
+
+    // 当前线程所属 EventLoop 的指标；没有 EventLoop 的线程首次调用时单独注册一份
+    static LoopMetrics& local();
+    static void bind(LoopMetrics* metrics);
+};
+
+class Metrics {
+public:
+    static constexpr int kMaxLoops = 256;
+
+    static Metrics* instance();
+
+    LoopMetrics* register_loop();
+
+    int loop_count() const { return count_.load(std::memory_order_acquire); }
+    LoopMetrics* loop(int i) const { return loops_[i].load(std::memory_order_acquire); }
+
+    // 当前连接数：各线程打开数与关闭数之差
+    int64_t connections() const;
+
+    // 以 Prometheus 文本格式导出，合并各 EventLoop 的直方图
+    std::string scrape() const;
+
+private:
+    Metrics() = default;
+
+    // 注册时加锁，读取端无锁遍历
+    std::mutex mtx_;
+    std::array<std::atomic<LoopMetrics*>, kMaxLoops> loops_{};
+    std::atomic<int> count_{0};
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+/*
+ * 热路径打点：accept / read / parse / respond / write / close
+ * 总是更新本线程 LoopMetrics 的当前阶段（一次 relaxed store），供慢回调与卡顿报告使用；
+ * 编译时定义 WEBSERVER_USDT 且系统提供 <sys/sdt.h> 时，同时生成 USDT 探针，
+ * 可用 bpftrace -e 'usdt:./bin/server:webserver:parse { ... }' 挂载，未挂载时只是一条 nop
+ */
+#include "metrics.h"
+
+#if defined(WEBSERVER_USDT) && __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define WS_USDT(name, fd) DTRACE_PROBE1(webserver, name, fd)
+#else
+#define WS_USDT(name, fd) do {} while(0)
+#endif
+
+#define WS_TRACE(name, fd) do { \
+        LoopMetrics::local().mark(TraceStage::name, (fd)); \
+        WS_USDT(name, (fd)); \
+    } while(0)
@@ -0,0 +1,103 @@
+#include "watchdog.h"
+#include <csignal>
+#include <execinfo.h>
+#include <unistd.h>
+#include <condition_variable>
+#include <mutex>
+#include "../log/log.h"
+
+static constexpr uint64_t kIntervalNs = 1000000000ull;
+
+static void dump_stack_handler(int) {
+    // 只用 write/backtrace，避免在信号处理函数里分配内存
+    static const char head[] = "==== EventLoop stall, stack of the stalled thread ====\n";
+    void* frames[64];
+    int n = backtrace(frames, 64);
+    ssize_t ret = write(STDERR_FILENO, head, sizeof(head) - 1);
+    (void)ret;
+    backtrace_symbols_fd(frames, n, STDERR_FILENO);
+}
+
+void Watchdog::install_handler_() {
+    // backtrace 首次调用会加载 libgcc，提前做一次，信号处理函数里不再触发 dlopen
+    void* frame;
+    backtrace(&frame, 1);
+
+    // SA_RESTART 让被打断的 read/write 等自动重启；nanosleep 之类仍会提前返回 EINTR
+    struct sigaction sa = {};
+    sa.sa_handler = dump_stack_handler;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGRTMIN, &sa, nullptr);
+}
+
+Watchdog::Watchdog(int stall_ms)
+    : stall_ns_(static_cast<uint64_t>(stall_ms) * 1000000ull),
+      reported_(Metrics::kMaxLoops, 0) {
+    install_handler_();
+    thread_ = std::jthread([this](std::stop_token st) { run_(st); });
+}
+
+Watchdog::~Watchdog() {
+    thread_.request_stop();
+}
+
+void Watchdog::run_(std::stop_token st) {
+    // 检查间隔取阈值的 1/4，卡顿最多晚 25% 被发现
+    const auto period = std::chrono::nanoseconds(std::max<uint64_t>(stall_ns_ / 4, 5000000ull));
+    std::mutex mtx;
+    std::condition_variable_any cond;
+    uint64_t next_roll = metrics_now_ns() + kIntervalNs;
+
+    std::unique_lock<std::mutex> lck(mtx);
+    while(!st.stop_requested()) {
+        cond.wait_for(lck, st, period, [] { return false; });
+        const uint64_t now = metrics_now_ns();
+        check_stalls_(now);
+        if(now >= next_roll) {
+            roll_interval_();
+            next_roll = now + kIntervalNs;
+        }
+    }
+}
+
+void Watchdog::check_stalls_(uint64_t now) {
+    Metrics* metrics = Metrics::instance();
+    const int n = metrics->loop_count();
+    for(int i = 0; i < n; ++i) {
+        LoopMetrics* loop = metrics->loop(i);
+        const uint64_t since = loop->busy_since.load(std::memory_order_relaxed);
+        if(since == 0 || now <= since || now - since < stall_ns_ || reported_[i] == since) {
+            continue;
+        }
+        reported_[i] = since;
+        loop->stalls.add();
+        const uint32_t where = loop->current.load(std::memory_order_relaxed);
+        LOG_WARN("EventLoop %d stalled for %lu ms in %s, fd %d", loop->id,
+                 (unsigned long)((now - since) / 1000000), trace_stage_name(stage_of(where)), fd_of(where));
+        if(loop->has_thread) {
+            pthread_kill(loop->thread, SIGRTMIN);
+        }
+    }
+}
+
+void Watchdog::roll_interval_() {
+    const uint32_t epoch = LoopMetrics::interval.load(std::memory_order_relaxed);
+    LoopMetrics::interval.store(epoch + 1, std::memory_order_relaxed);
+
+    Metrics* metrics = Metrics::instance();
+    const int n = metrics->loop_count();
+    for(int i = 0; i < n; ++i) {
+        LoopMetrics* loop = metrics->loop(i);
+        uint64_t s = loop->slowest.load(std::memory_order_relaxed);
+        if(LoopMetrics::slow_epoch(s) != (epoch & 0xFFFF)) {
+            s = 0;                                // 本周期没有回调
+        }
+        loop->last_slowest.store(s, std::memory_order_relaxed);
+        if(s && LoopMetrics::slow_us(s) * 1000 * 4 >= stall_ns_) {
+            const uint32_t where = LoopMetrics::slow_stage(s);
+            LOG_WARN("EventLoop %d slowest callback %lu us in %s, fd %d", loop->id,
+                     (unsigned long)LoopMetrics::slow_us(s), trace_stage_name(stage_of(where)), fd_of(where));
+        }
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <thread>
+#include <vector>
+
+#include "metrics.h"
+
+// 事件循环看门狗：独立线程周期性检查各 EventLoop
+// 单轮处理超过 stall_ms 时记一次卡顿、写日志，并向该线程发信号把调用栈打印到 stderr；
+// 每秒汇总一次各循环最慢的回调（阶段和 fd），超过 stall_ms/4 时写警告日志
+class Watchdog {
+public:
+    explicit Watchdog(int stall_ms);
+    ~Watchdog();
+
+    Watchdog(const Watchdog&) = delete;
+    Watchdog& operator=(const Watchdog&) = delete;
+
+private:
+    void run_(std::stop_token st);
+    void check_stalls_(uint64_t now);
+    void roll_interval_();
+
+    static void install_handler_();
+
+    const uint64_t stall_ns_;
+    std::vector<uint64_t> reported_;              // 每个循环已报告过的 busy_since，同一轮只报一次
+    std::jthread thread_;
+};
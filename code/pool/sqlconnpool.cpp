@@ -1,4 +1,5 @@
 #include "sqlconnpool.h"
+#include <fcntl.h>
 
 SqlConnPool* SqlConnPool::instance() {
     static SqlConnPool connPool;
@@ -20,6 +21,9 @@ void SqlConnPool::init(const char* host, int port,
                                  dbName, port, nullptr, 0);
         if (!sql) {
             LOG_ERROR("MySql Connect error!");
+        } else {
+            // 热重启 exec 的新进程不继承数据库连接
+            fcntl(sql->net.fd, F_SETFD, FD_CLOEXEC);
         }
         conn_que_.push(sql);
     }
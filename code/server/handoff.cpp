@@ -0,0 +1,119 @@
+#include "handoff.h"
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static socklen_t handoff_address(int port, sockaddr_un* addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    // sun_path[0] 为 0 表示抽象命名空间，进程退出后地址自动释放，不留 socket 文件
+    int n = snprintf(addr->sun_path + 1, sizeof(addr->sun_path) - 1, "webserver-%d", port);
+    return offsetof(sockaddr_un, sun_path) + 1 + n;
+}
+
+int handoff_listen(int port) {
+    sockaddr_un addr;
+    socklen_t len = handoff_address(port, &addr);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(fd < 0) return -1;
+    if(bind(fd, reinterpret_cast<sockaddr*>(&addr), len) < 0 || listen(fd, 1) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool handoff_peer_allowed(int conn_fd, pid_t expected_pid) {
+    ucred cred = {};
+    socklen_t len = sizeof(cred);
+    if(getsockopt(conn_fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0) return false;
+    return cred.uid == geteuid() && (expected_pid == 0 || cred.pid == expected_pid);
+}
+
+bool handoff_send_listen_fd(int conn_fd, int listen_fd) {
+    char tag = 'L';
+    iovec iov = { &tag, 1 };
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &listen_fd, sizeof(int));
+    return sendmsg(conn_fd, &msg, MSG_NOSIGNAL) == 1;
+}
+
+// 收到的必须是本端口上处于监听状态的 TCP socket
+static bool handoff_listen_fd_valid(int listen_fd, int port) {
+    int value = 0;
+    socklen_t len = sizeof(value);
+    if(getsockopt(listen_fd, SOL_SOCKET, SO_ACCEPTCONN, &value, &len) < 0 || !value) return false;
+    len = sizeof(value);
+    if(getsockopt(listen_fd, SOL_SOCKET, SO_TYPE, &value, &len) < 0 || value != SOCK_STREAM) return false;
+    sockaddr_storage addr = {};
+    len = sizeof(addr);
+    if(getsockname(listen_fd, reinterpret_cast<sockaddr*>(&addr), &len) < 0) return false;
+    if(addr.ss_family == AF_INET) {
+        return ntohs(reinterpret_cast<sockaddr_in*>(&addr)->sin_port) == port;
+    }
+    if(addr.ss_family == AF_INET6) {
+        return ntohs(reinterpret_cast<sockaddr_in6*>(&addr)->sin6_port) == port;
+    }
+    return false;
+}
+
+int handoff_take_listen_fd(int port, int* conn_fd) {
+    sockaddr_un addr;
+    socklen_t len = handoff_address(port, &addr);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(fd < 0) return -1;
+    // 抽象地址谁都能占用，只接受同一用户的进程发来的 fd
+    if(connect(fd, reinterpret_cast<sockaddr*>(&addr), len) < 0 || !handoff_peer_allowed(fd, 0)) {
+        close(fd);
+        return -1;
+    }
+    // 旧进程卡住时不要无限等
+    timeval tv = { 2, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    char tag = 0;
+    iovec iov = { &tag, 1 };
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    const ssize_t n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+    int listen_fd = -1;
+    cmsghdr* cmsg = n > 0 ? CMSG_FIRSTHDR(&msg) : nullptr;
+    if(cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS
+       && cmsg->cmsg_len == CMSG_LEN(sizeof(int))) {
+        memcpy(&listen_fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+    // 任何一项不符都关掉收到的 fd，由调用方照常 bind
+    if(n != 1 || tag != 'L' || (msg.msg_flags & MSG_CTRUNC) || listen_fd < 0
+       || !handoff_listen_fd_valid(listen_fd, port)) {
+        if(listen_fd >= 0) close(listen_fd);
+        close(fd);
+        return -1;
+    }
+    *conn_fd = fd;
+    return listen_fd;
+}
+
+bool handoff_send_ready(int conn_fd) {
+    char tag = HANDOFF_READY;
+    bool ok = send(conn_fd, &tag, 1, MSG_NOSIGNAL) == 1;
+    close(conn_fd);
+    return ok;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <sys/types.h>
+
+/*
+ * 热重启时新旧进程交接监听 socket：
+ * 1. 旧进程在抽象命名空间的 Unix socket "@webserver-<端口>" 上等待
+ * 2. 新进程启动时先连过去，旧进程用 SCM_RIGHTS 发来监听 fd 并关闭交接地址，
+ *    此后两个进程共用同一个监听 socket，积压队列中的连接不会丢
+ * 3. 新进程初始化完成后接管交接地址并回复就绪，旧进程停止 accept 并开始排空
+ * 新进程在就绪前退出时，旧进程读到 EOF，重新监听交接地址，继续正常服务
+ * 抽象命名空间的地址没有文件权限，旧进程按 SO_PEERCRED 只把监听 fd 交给同一用户的进程
+ */
+
+// 旧进程：监听交接地址，失败返回 -1
+int handoff_listen(int port);
+
+// 旧进程：对端须与本进程的有效用户相同；expected_pid 非 0 时（SIGUSR2 拉起的子进程）还须是该进程
+bool handoff_peer_allowed(int conn_fd, pid_t expected_pid);
+
+// 旧进程：把监听 fd 发给已连接的新进程
+bool handoff_send_listen_fd(int conn_fd, int listen_fd);
+
+// 新进程：连接旧进程并取回监听 fd；没有旧进程、对端不是同一用户或收到的不是本端口的监听 socket 时返回 -1
+// 成功时 *conn_fd 保存连接，用于回复就绪
+int handoff_take_listen_fd(int port, int* conn_fd);
+
+// 新进程：回复就绪并关闭连接
+bool handoff_send_ready(int conn_fd);
+
+static constexpr char HANDOFF_READY = 'R';
@@ -1,30 +1,32 @@
 // webserver.cpp
 #include "webserver.h"
 #include <cassert>
+#include <csignal>
 #include <cstring>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include "handoff.h"
 
-WebServer::WebServer(
-        int port, int trig_mode, int timeout_ms, bool opt_linger,
-        int sql_port, const char* sql_user, const char* sql_pwd,
-        const char* db_name, int conn_pool_num, int thread_num,
-        bool open_log, int log_level, int log_que_size)
-    : port_(port), open_linger_(opt_linger), timeout_ms_(timeout_ms), is_close_(false),
-      listen_fd_(-1), main_loop_(new EventLoop()), timer_(new HeapTimer()) {
-    
-    // 获取资源目录
-    src_dir_ = getcwd(nullptr, 256);
-    assert(src_dir_);
-    strncat(src_dir_, "/resources/", 16);
-    
-    // 初始化HTTP静态成员
-    HttpConn::user_count = 0;
-    HttpConn::src_dir = src_dir_;
+WebServer::WebServer(const ServerConfig& config)
+    : port_(config.port), open_linger_(config.linger), is_close_(false),
+      incoming_cpu_(config.incoming_cpu && !config.io_cpus.empty()),
+      listen_fd_(-1), main_loop_(new EventLoop()), config_(config) {
+
+    init_routes();
+    if(!init_config()) {
+        is_close_ = true;
+        return;
+    }
     
     // 初始化数据库连接池
-    SqlConnPool::instance()->init("localhost", sql_port, sql_user, sql_pwd, db_name, conn_pool_num);
+    SqlConnPool::instance()->init(config.sql_host.c_str(), config.sql_port, config.sql_user.c_str(),
+                                  config.sql_password.c_str(), config.sql_database.c_str(), config.sql_pool);
     
     // 初始化事件模式
-    init_event_mode(trig_mode);
+    init_event_mode(config.trig_mode);
+
+    // 在创建其他线程之前屏蔽退出信号，之后创建的线程都继承这一屏蔽字
+    init_signals();
 
     // 初始化Socket
     if(!init_socket()) { 
@@ -33,38 +35,81 @@ WebServer::WebServer(
     }
     
     // 初始化主从Reactor模式的线程池
-    thread_pool_.reset(new EventLoopThreadPool(main_loop_.get(), thread_num));
+    CpuPlacement placement;
+    placement.main_cpus = parse_cpu_list(config.main_cpus);
+    placement.io_cpus = parse_cpu_list(config.io_cpus);
+    placement.log_cpus = parse_cpu_list(config.log_cpus);
+    placement.incoming_cpu = config.incoming_cpu;
+    thread_pool_.reset(new EventLoopThreadPool(main_loop_.get(), config.threads, placement.io_cpus, config.dispatch));
     thread_pool_->start();
+    init_ws_ping();
+    init_output_check();
     
     // 初始化日志
-    if(open_log) {
-        Log::instance()->init(log_level, "./log", ".log", log_que_size);
+    if(config.log_enable) {
+        Log::instance()->init(config.runtime.log_level, config.log_dir, ".log", config.log_queue);
         if(is_close_) { 
             LOG_ERROR("========== Server init error!=========="); 
         }
         else {
             LOG_INFO("========== Server init ==========");
-            LOG_INFO("Port:%d, OpenLinger: %s", port_, opt_linger ? "true":"false");
+            LOG_INFO("Config: %s", config.file.empty() ? "(defaults)" : config.file.c_str());
+            LOG_INFO("Port:%d, OpenLinger: %s", port_, config.linger ? "true":"false");
             LOG_INFO("Listen Mode: %s, Connection Mode: %s",
                         (listen_event_ & EPOLLET ? "ET": "LT"),
                         (conn_event_ & EPOLLET ? "ET": "LT"));
-            LOG_INFO("LogSys level: %d", log_level);
-            LOG_INFO("srcDir: %s", HttpConn::src_dir);
-            LOG_INFO("SqlConnPool num: %d, ThreadPool num: %d", conn_pool_num, thread_num);
+            LOG_INFO("LogSys level: %d", config.runtime.log_level);
+            const VhostTable* vhosts = VhostTable::instance();
+            LOG_INFO("srcDir: %s", vhosts->default_host().root().c_str());
+            for(const auto& host : vhosts->hosts()) {
+                LOG_INFO("vhost %s: %s", host->name().c_str(), host->root().c_str());
+            }
+            LOG_INFO("SqlConnPool num: %d, ThreadPool num: %d", config.sql_pool, config.threads);
+            LOG_INFO("TLS: %s", TlsContext::instance()->enabled() ? "on" : "off");
+            if(!openat2_available()) {
+                LOG_WARN("openat2 unavailable, static files are opened with openat: "
+                         "symlinks may escape the document root");
+            }
         }
     }
+
+    if(config.stall_ms > 0) {
+        watchdog_.reset(new Watchdog(config.stall_ms));
+    }
+
+    // 主线程最后绑核，之前创建的线程不会继承它的亲和性
+    if(config.log_enable && Log::instance()->writer_thread()) {
+        pin_thread(Log::instance()->writer_thread()->native_handle(), placement.log_cpus);
+    }
+    pin_thread(pthread_self(), placement.main_cpus);
+    if(config.log_enable) {
+        LOG_INFO("CPU main: %s, io: %s, log: %s, incoming cpu: %s",
+                 format_cpu_list(placement.main_cpus).c_str(), format_cpu_list(placement.io_cpus).c_str(),
+                 format_cpu_list(placement.log_cpus).c_str(), incoming_cpu_ ? "on" : "off");
+        LOG_INFO("Dispatch policy: %s", dispatch_policy_name(config.dispatch));
+    }
+
+    init_handoff();
 }
 
 WebServer::~WebServer() {
-    close(listen_fd_);
+    // 先停掉 IO 线程，它们的回调还引用着 users_ 等成员
+    thread_pool_.reset();
+    if(listen_fd_ >= 0) close(listen_fd_);
+    stop_handoff();
+    if(handoff_conn_ >= 0) close(handoff_conn_);
+    if(signal_fd_ >= 0) close(signal_fd_);
+    if(drain_timer_fd_ >= 0) close(drain_timer_fd_);
+    for(int fd : ws_ping_fds_) close(fd);
+    for(int fd : output_check_fds_) close(fd);
     is_close_ = true;
-    free(src_dir_);
     SqlConnPool::instance()->close_pool();
 }
 
 void WebServer::init_event_mode(int trig_mode) {
     listen_event_ = EPOLLRDHUP;
-    conn_event_ = EPOLLONESHOT | EPOLLRDHUP;
+    // 每个连接只归一个 IO 循环处理，不会有两个线程同时拿到它的事件，不需要 EPOLLONESHOT 每次重新注册
+    conn_event_ = EPOLLRDHUP;
     if(trig_mode & 1) conn_event_ |= EPOLLET;
     if(trig_mode & 2) listen_event_ |= EPOLLET;
 
@@ -76,8 +121,122 @@ void WebServer::start() {
         return; 
     }
     
+    // 之后路由表只读，各 IO 线程无锁匹配
+    Router::instance()->freeze();
     LOG_INFO("========== Server start ==========");
-    main_loop_->loop(timer_.get(), timeout_ms_);
+    main_loop_->loop();
+}
+
+bool WebServer::init_config() {
+    // 限流表只在启动时分配，之后 SIGHUP 只替换规则
+    RateLimiter::instance()->init(rate_limits(config_.runtime, config_.limit_capacity));
+
+    ConcurrencyLimiter::Options concurrency;
+    concurrency.algorithm = config_.concurrency;
+    concurrency.min_limit = config_.min_concurrency;
+    concurrency.max_limit = config_.max_concurrency;
+    concurrency.initial_limit = config_.initial_concurrency;
+    ConcurrencyLimiter::set_options(concurrency);
+
+    if(!config_.upload_prefix.empty()) {
+        HttpRequest::body_handler = HttpRequest::upload_handler(config_.upload_prefix, config_.upload_dir,
+                                                                config_.upload_limit);
+    }
+    RuntimeConfig::publish(std::make_shared<const RuntimeConfig>(config_.runtime));
+
+    // 日志系统此时尚未初始化
+    std::string error;
+    if(!VhostTable::instance()->init(config_.default_host, config_.vhosts, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return false;
+    }
+
+    TlsContext::Options tls;
+    tls.cert_file = config_.tls_cert;
+    tls.key_file = config_.tls_key;
+    tls.ticket_key_file = config_.tls_ticket_key;
+    if(!tls.cert_file.empty() && !TlsContext::instance()->init(tls)) {
+        fprintf(stderr, "TLS init failed: cert %s, key %s\n", tls.cert_file.c_str(), tls.key_file.c_str());
+        return false;
+    }
+    return true;
+}
+
+RateLimiter::Options WebServer::rate_limits(const RuntimeConfig& runtime, size_t capacity) {
+    RateLimiter::Options limits;
+    limits.capacity = capacity;
+    limits.max_conns = runtime.max_conns;
+    limits.rules[static_cast<size_t>(RateLimiter::RouteClass::static_file)] = { runtime.static_rate, runtime.static_burst };
+    limits.rules[static_cast<size_t>(RateLimiter::RouteClass::dynamic)] = { runtime.dynamic_rate, runtime.dynamic_burst };
+    return limits;
+}
+
+void WebServer::reload_config() {
+    ServerConfig next = config_;
+    std::string error;
+    if(!load_config(next, error)) {
+        LOG_ERROR("Reload failed, keep the current config: %s", error.c_str());
+        return;
+    }
+    // 不能在运行中开关的两项：已有连接没有定时器 / 没有计入连接数
+    RuntimeConfig& runtime = next.runtime;
+    if(runtime.timed() != config_.runtime.timed()) {
+        LOG_WARN("Reload: enabling or disabling all connection timeouts needs a restart");
+        runtime.timeout_ms = config_.runtime.timeout_ms;
+        runtime.first_byte_timeout_ms = config_.runtime.first_byte_timeout_ms;
+        runtime.header_timeout_ms = config_.runtime.header_timeout_ms;
+        runtime.body_timeout_ms = config_.runtime.body_timeout_ms;
+    }
+    if((runtime.max_conns == 0) != (config_.runtime.max_conns == 0)) {
+        LOG_WARN("Reload: enabling or disabling limit.max_conns needs a restart");
+        runtime.max_conns = config_.runtime.max_conns;
+    }
+    const std::vector<ConfigChange> changes = diff_config(config_, next);
+    for(const ConfigChange& change : changes) {
+        if(change.reloadable) {
+            LOG_INFO("Reload: %s %s -> %s", change.key.c_str(), change.from.c_str(), change.to.c_str());
+        } else {
+            LOG_WARN("Reload: %s %s -> %s takes effect after a restart (SIGUSR2)",
+                     change.key.c_str(), change.from.c_str(), change.to.c_str());
+        }
+    }
+
+    // 只有可重新加载的部分生效；其余保持当前值，直到热重启
+    config_.runtime = runtime;
+    Log::instance()->set_level(runtime.log_level);
+    RateLimiter::instance()->update(rate_limits(runtime, config_.limit_capacity));
+    RuntimeConfig::publish(std::make_shared<const RuntimeConfig>(runtime));
+    LOG_INFO("Config reloaded from %s, %zu change(s)", config_.file.empty() ? "(defaults)" : config_.file.c_str(),
+             changes.size());
+}
+
+void WebServer::init_routes() {
+    Router* router = Router::instance();
+    router->add("GET", "/", Router::rewrite("/index.html"));
+    for(std::string_view page : DEFAULT_HTML) {
+        router->add("GET", page, Router::rewrite(std::string(page) + ".html"));
+    }
+    // 注册和登录表单：校验后改写为结果页
+    for(const PathTagEntry& entry : DEFAULT_HTML_TAG) {
+        const bool is_login = entry.tag == 1;
+        auto handler = [is_login](HttpRequest& request, const RouteParams&) -> std::unique_ptr<ResponseStream> {
+            if(request.header("content-type") == "application/x-www-form-urlencoded") {
+                const bool ok = HttpRequest::verify_user(request.get_post("username"),
+                                                         request.get_post("password"), is_login);
+                request.path() = ok ? "/welcome.html" : "/error.html";
+            }
+            return nullptr;
+        };
+        std::string_view path = entry.key;
+        router->add("POST", path, handler, true);
+        // 页面里的表单提交到不带 .html 的地址
+        if(path.ends_with(".html")) {
+            path.remove_suffix(5);
+            router->add("POST", path, handler, true);
+        }
+    }
+    // 静态文件取自请求所属站点的文档根目录
+    router->mount("/", "");
 }
 
 bool WebServer::init_socket() {
@@ -99,7 +258,20 @@ bool WebServer::init_socket() {
         opt_linger.l_onoff = 1;
     }
 
-    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    // 热重启：已有旧进程在运行时直接接过它的监听 socket，不重新 bind
+    listen_fd_ = handoff_take_listen_fd(port_, &handoff_conn_);
+    if(listen_fd_ >= 0) {
+        set_fd_nonblock(listen_fd_);
+        accept_channel_.reset(new Channel(main_loop_.get(), listen_fd_));
+        accept_channel_->set_read_callback(std::bind(&WebServer::handle_listen, this));
+        accept_channel_->set_update_callback(std::bind(&WebServer::handle_cur, this));
+        main_loop_->run_in_loop([this]() {
+            accept_channel_->enable_reading();
+        });
+        return true;
+    }
+
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
     if(listen_fd_ < 0) {
         LOG_ERROR("Create socket error!");
         return false;
@@ -127,7 +299,7 @@ bool WebServer::init_socket() {
         return false;
     }
 
-    ret = listen(listen_fd_, 6);
+    ret = listen(listen_fd_, config_.backlog);
     if(ret < 0) {
         LOG_ERROR("Listen port:%d error!", port_);
         close(listen_fd_);
@@ -155,37 +327,47 @@ void WebServer::handle_listen() {
     socklen_t len = sizeof(addr);
     
     do {
-        int fd = accept(listen_fd_, (struct sockaddr *)&addr, &len);
+        // 热重启 fork/exec 新进程时，客户端连接不能带过去
+        int fd = accept4(listen_fd_, (struct sockaddr *)&addr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
         if(fd <= 0) { return; }
+        LoopMetrics::local().accepts.add();
+        WS_TRACE(accept, fd);
         
-        if(HttpConn::user_count >= MAX_FD) {
-            send_error(fd, "Server busy!");
+        if(HttpConn::user_count() >= MAX_FD) {
+            send_error(fd, HttpResponse::reject_response(503));
             LOG_WARN("Clients is full!");
             return;
         }
+        bool conn_counted = false;
+        if(!RateLimiter::instance()->acquire_conn(addr.sin_addr.s_addr, &conn_counted)) {
+            LoopMetrics::local().rate_limited.add();
+            send_error(fd, HttpResponse::reject_response(429));
+            LOG_WARN("Client(%s) has too many connections!", inet_ntoa(addr.sin_addr));
+            continue;
+        }
         
-        add_client(fd, addr);
+        add_client(fd, addr, conn_counted);
     } while(listen_event_ & EPOLLET);
 }
 
-void WebServer::add_client(int fd, sockaddr_in addr) {
+void WebServer::add_client(int fd, sockaddr_in addr, bool conn_counted) {
     assert(fd > 0);
     
     // 选择一个IO线程
-    EventLoop* io_loop = thread_pool_->get_next_loop();
+    EventLoop* io_loop = incoming_cpu_ ? thread_pool_->get_loop_for_cpu(incoming_cpu(fd))
+                                       : thread_pool_->get_loop(addr.sin_addr.s_addr);
+    io_loop->load().connections.fetch_add(1, std::memory_order_relaxed);
     client_loops_[fd] = io_loop;
     
     // 初始化HTTP连接
-    users_[fd].init(fd, addr);
-    
-    // 设置定时器
-    if(timeout_ms_ > 0) {
-        timer_->add(fd, timeout_ms_, std::bind(&WebServer::close_conn, this, &users_[fd]));
-    }
+    users_[fd].init(fd, addr, conn_counted);
+    const uint64_t generation = users_[fd].generation();
     
     // 创建客户端Channel并设置到IO线程
     Channel* client_channel = new Channel(io_loop, fd);
     client_channels_[fd] = client_channel;
+    // ET 下读写两个方向注册一次，之后不再 epoll_ctl；没读完、没写完的由就绪队列接着处理
+    client_channel->set_events(conn_event_ | (HttpConn::is_et ? EPOLLOUT : 0));
     
     client_channel->set_read_callback([this, fd]() {
         handle_read(&users_[fd]);
@@ -203,18 +385,23 @@ void WebServer::add_client(int fd, sockaddr_in addr) {
         close_conn(&users_[fd]);
     });
     
-    // 注册到IO线程
-    io_loop->run_in_loop([client_channel, this]() {
+    // 注册到IO线程，超时由该线程自己的定时器处理，到期时不需要唤醒其他线程
+    io_loop->run_in_loop([client_channel, this, io_loop, fd, generation]() {
+        HttpConn* client = &users_[fd];
+        loop_conns().insert(client);
+        // 计在连接所属的 IO 线程上，与关闭时的计数同一线程，各线程的打开、关闭数相减即在线连接数
+        LoopMetrics::local().conns_opened.add();
+        if(RuntimeConfig::local().timed()) {
+            io_loop->timer().add(fd, client->timeout_ms(metrics_now_ns()),
+                                 std::bind(&WebServer::on_timeout, this, client, generation));
+        }
         client_channel->enable_reading();
     });
-    
-    set_fd_nonblock(fd);
     LOG_INFO("Client[%d] in!", users_[fd].get_fd());
 }
 
 void WebServer::handle_read(HttpConn* client) {
     assert(client);
-    extend_time(client);
     
     // 将读取任务放入IO线程执行
     EventLoop* io_loop = nullptr;
@@ -237,6 +424,7 @@ void WebServer::handle_write(HttpConn* client) {
 }
 
 void WebServer::on_read(HttpConn* client) {
+    WS_TRACE(read, client->get_fd());
     int read_errno = 0;
     ssize_t ret = client->read(&read_errno);
     
@@ -255,64 +443,313 @@ void WebServer::on_process(HttpConn* client) {
     auto it = client_channels_.find(fd);
     if(it == client_channels_.end()) return;
     channel = it->second;
-    if (client->process()) channel->enable_writing();
-    else channel->enable_reading();
-    
+    const size_t before = client->get_write_bytes();
+    const bool ready = client->process();
+    // 请求之间空闲的连接按 keepalive_timeout_ms 计时，其余按 timeout_ms
+    extend_time(client);
+    if (ready) {
+        // HTTP/2 连接在上一批帧写完前就可能追加新帧，只计增量
+        add_pending(static_cast<int64_t>(client->get_write_bytes()) - static_cast<int64_t>(before));
+        if (client->is_websocket()) {
+            publish(client);
+            // 发送者自己也是订阅者，积压过多时会在分发中被关闭
+            if (client->is_closed()) return;
+        }
+        if (client->wants_metrics()) {
+            auto loop_it = client_loops_.find(fd);
+            if (loop_it != client_loops_.end()) serve_metrics(client, loop_it->second);
+            return;
+        }
+        want_write(channel);
+    }
+    if (HttpConn::is_et) {
+        update_reading(client, channel);
+        return;
+    }
+    if (!ready) {
+        if (client->tls_wants_write()) channel->enable_writing();
+        else if (client->is_parked()) {
+            // 空闲的长连接只等 EPOLLIN，留着 EPOLLOUT 会被可写事件反复唤醒
+            if (channel->events() & EPOLLOUT) channel->disable_writing();
+        }
+        else if (!client->read_paused()) channel->enable_reading();
+    }
+
+    // 读缓冲区或写缓冲区积压到高水位时停止读取；响应写完后 on_write 回到这里消费积压，降下来后恢复
+    update_reading(client, channel);
+}
+
+void WebServer::update_reading(HttpConn* client, Channel* channel) {
+    const bool paused = client->read_paused();
+    if (HttpConn::is_et) {
+        // 没读到 EAGAIN 就停下的（预算用完、高水位已经降下来）不会再有可读边沿，排进就绪队列接着读
+        if (!paused && client->read_pending()) channel->queue_ready(EPOLLIN);
+        return;
+    }
+    if (paused == channel->is_reading()) {
+        paused ? channel->disable_reading() : channel->enable_reading();
+    }
+    // TLS 连接的数据可能缓存在 OpenSSL 中，水平触发也等不到通知
+    if (!paused && client->read_pending()) channel->queue_ready(EPOLLIN);
+}
+
+void WebServer::serve_metrics(HttpConn* client, EventLoop* io_loop) {
+    // 在主循环中抓取，IO线程只负责把结果写回；连接在此期间被关闭则丢弃
+    const int fd = client->get_fd();
+    const uint64_t generation = client->generation();
+    main_loop_->queue_in_loop([this, client, io_loop, fd, generation]() {
+        auto body = std::make_shared<std::string>(Metrics::instance()->scrape());
+        io_loop->queue_in_loop([this, client, fd, generation, body]() {
+            if (client->is_closed() || client->generation() != generation) return;
+            auto it = client_channels_.find(fd);
+            if (it == client_channels_.end()) return;
+            client->write_metrics(*body);
+            add_pending(client->get_write_bytes());
+            want_write(it->second);
+        });
+    });
+}
+
+void WebServer::broadcast(const std::string& topic, WebSocket::Opcode opcode, std::string_view payload) {
+    // 帧只组一次，各循环的订阅者共享同一块内存
+    auto frame = std::make_shared<const std::string>(WebSocket::frame(opcode, payload));
+    ChainBuffer::SharedBlock block(frame, frame->data());
+    const size_t len = frame->size();
+    for(EventLoop* loop : thread_pool_->loops()) {
+        loop->run_in_loop([this, topic, block, len]() { fan_out(topic, block, len); });
+    }
+}
+
+void WebServer::publish(HttpConn* client) {
+    // 收到的消息转发给同一路径上的所有订阅者（包括发送者自己）
+    std::vector<WebSocket::Message> messages;
+    client->take_ws_messages(messages);
+    for(const auto& message : messages) {
+        broadcast(client->ws_topic(), message.opcode, message.data);
+    }
+}
+
+void WebServer::fan_out(const std::string& topic, const ChainBuffer::SharedBlock& frame, size_t len) {
+    std::vector<WsHub::Subscriber>* subs = WsHub::local().find(topic);
+    if(!subs) return;
+    std::vector<HttpConn*> slow;
+    for(size_t i = 0; i < subs->size();) {
+        HttpConn* client = (*subs)[i].conn;
+        if(client->is_closed() || client->generation() != (*subs)[i].generation) {
+            (*subs)[i] = subs->back();
+            subs->pop_back();
+            continue;
+        }
+        ++i;
+        auto it = client_channels_.find(client->get_fd());
+        if(it == client_channels_.end()) continue;
+        if(client->get_write_bytes() > WS_MAX_BACKLOG) {
+            slow.push_back(client);
+            continue;
+        }
+        if(!client->send_ws(frame, len)) continue;
+        add_pending(len);
+        want_write(it->second);
+    }
+    // 关闭会修改订阅表，遍历结束后再关
+    for(HttpConn* client : slow) {
+        LOG_WARN("WebSocket client[%d] too slow, closing", client->get_fd());
+        close_conn(client);
+    }
+}
+
+void WebServer::init_ws_ping() {
+    // 每个 IO 循环一个周期定时器，心跳帧只组一次，整个循环的订阅者一起检查
+    for(EventLoop* loop : thread_pool_->loops()) {
+        int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if(fd < 0) continue;
+        itimerspec period = { { WS_PING_MS / 1000, 0 }, { WS_PING_MS / 1000, 0 } };
+        timerfd_settime(fd, 0, &period, nullptr);
+        auto channel = std::make_unique<Channel>(loop, fd);
+        channel->set_read_callback(std::bind(&WebServer::on_ws_ping, this, fd));
+        loop->run_in_loop([ch = channel.get()]() { ch->enable_reading(); });
+        ws_ping_fds_.push_back(fd);
+        ws_ping_channels_.push_back(std::move(channel));
+    }
+}
+
+void WebServer::on_ws_ping(int timer_fd) {
+    uint64_t expirations;
+    ssize_t ret = read(timer_fd, &expirations, sizeof(expirations));
+    (void)ret;
+    static const std::string ping = WebSocket::frame(WebSocket::PING, {});
+    static const ChainBuffer::SharedBlock block(ChainBuffer::SharedBlock(), ping.data());
+
+    std::vector<HttpConn*> dead;
+    auto& topics = WsHub::local().topics();
+    for(auto topic = topics.begin(); topic != topics.end();) {
+        auto& subs = topic->second;
+        for(size_t i = 0; i < subs.size();) {
+            HttpConn* client = subs[i].conn;
+            if(client->is_closed() || client->generation() != subs[i].generation) {
+                subs[i] = subs.back();
+                subs.pop_back();
+                continue;
+            }
+            ++i;
+            auto it = client_channels_.find(client->get_fd());
+            if(it == client_channels_.end()) continue;
+            if(!client->ws_check_alive()) {
+                dead.push_back(client);
+                continue;
+            }
+            if(!client->send_ws(block, ping.size())) continue;
+            add_pending(ping.size());
+            want_write(it->second);
+        }
+        topic = subs.empty() ? topics.erase(topic) : std::next(topic);
+    }
+    for(HttpConn* client : dead) {
+        LOG_INFO("WebSocket client[%d] missed heartbeat, closing", client->get_fd());
+        close_conn(client);
+    }
+}
+
+void WebServer::init_output_check() {
+    // 与心跳一样每个 IO 循环一个周期定时器，只看本循环登记的积压连接；
+    // 各循环错开检查，后检查的能看到前面关闭后的合计，不会一起超额断开
+    const auto& loops = thread_pool_->loops();
+    for(size_t i = 0; i < loops.size(); ++i) {
+        EventLoop* loop = loops[i];
+        int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if(fd < 0) continue;
+        const long first_ms = OUTPUT_CHECK_MS + OUTPUT_CHECK_MS * static_cast<long>(i) / static_cast<long>(loops.size());
+        itimerspec period = { { OUTPUT_CHECK_MS / 1000, 0 }, { first_ms / 1000, first_ms % 1000 * 1000000 } };
+        timerfd_settime(fd, 0, &period, nullptr);
+        auto channel = std::make_unique<Channel>(loop, fd);
+        channel->set_read_callback(std::bind(&WebServer::on_output_check, this, fd));
+        loop->run_in_loop([ch = channel.get()]() { ch->enable_reading(); });
+        output_check_fds_.push_back(fd);
+        output_check_channels_.push_back(std::move(channel));
+    }
+}
+
+void WebServer::on_output_check(int timer_fd) {
+    uint64_t expirations;
+    ssize_t ret = read(timer_fd, &expirations, sizeof(expirations));
+    (void)ret;
+    // 每次都要收集，刷新各连接的进度快照
+    std::vector<HttpConn*> stalled;
+    HttpConn::collect_stalled(stalled);
+    const size_t budget = RuntimeConfig::local().output_budget;
+    if(budget == 0) return;
+    // 各循环分别检查，每个只关掉自己积压最多的几个，直到合计回到预算以内
+    for(HttpConn* client : stalled) {
+        if(BlockPool::in_use() <= budget) break;
+        LOG_WARN("Client[%d] stalled with %zu bytes unsent over output budget, closing",
+                 client->get_fd(), client->get_buffered_bytes());
+        LoopMetrics::local().evicted.add();
+        close_conn(client);
+    }
 }
 
 void WebServer::on_write(HttpConn* client) {
     int fd = client->get_fd();
+    WS_TRACE(write, fd);
+    if (client->tls_pending()) {
+        on_read(client);
+        return;
+    }
+    Channel* channel = nullptr;
+    auto it = client_channels_.find(fd);
+    if(it == client_channels_.end()) return;
+    channel = it->second;
+    if (client->get_write_bytes() == 0) {
+        // ET 下可写常随可读一起报告，就绪队列里也可能有已经写完的项
+        if (!HttpConn::is_et && (channel->events() & EPOLLOUT)) channel->disable_writing();
+        return;
+    }
     int write_errno = 0;
+    const size_t before = client->get_write_bytes();
     ssize_t ret = client->write(&write_errno);
+    add_pending(static_cast<int64_t>(client->get_write_bytes()) - static_cast<int64_t>(before));
     
     if (client->get_write_bytes() == 0) {
         // 传输完成
+        client->finish_request();
         if (client->is_keep_alive()) {
+            // LT 下写完就不再关注可写，on_process 生成了新的响应时再注册
+            if (!HttpConn::is_et) channel->disable_writing();
             on_process(client);
             return;
         }
-    } else if (ret < 0) {
-        if (write_errno == EAGAIN) {
-            // 继续传输
-            Channel* channel = nullptr;
-            auto it = client_channels_.find(fd);
-            if(it == client_channels_.end()) return;
-            channel = it->second;
-            channel->enable_writing();
-            return;
-        }
+    } else if (ret > 0) {
+        // 用完本轮预算：LT 下可写事件还会再报告，ET 下排到其他连接之后接着写
+        if (HttpConn::is_et) channel->queue_ready(EPOLLOUT);
+        update_reading(client, channel);
+        return;
+    } else if (write_errno == EAGAIN) {
+        // 发送缓冲区满，等可写事件；这一轮降到了低水位的恢复读取
+        if (!HttpConn::is_et && !(channel->events() & EPOLLOUT)) channel->enable_writing();
+        update_reading(client, channel);
+        return;
     }
     
     close_conn(client);
 }
 
+void WebServer::want_write(Channel* channel) {
+    if (HttpConn::is_et) channel->queue_ready(EPOLLOUT);
+    else channel->enable_writing();
+}
+
 void WebServer::extend_time(HttpConn* client) {
     assert(client);
-    if (timeout_ms_ > 0) {
-        timer_->adjust(client->get_fd(), timeout_ms_);
+    // 在连接所属的 IO 线程中调用；头部等有总时限的阶段重新算出的仍是原来的到期时刻
+    EventLoop* loop = EventLoop::current();
+    if(loop && RuntimeConfig::local().timed()) {
+        loop->timer().adjust(client->get_fd(), client->timeout_ms(metrics_now_ns()));
     }
 }
 
+void WebServer::on_timeout(HttpConn* client, uint64_t generation) {
+    // 已经关闭，或 fd 已被另一个 IO 线程上的新连接复用
+    if(client->is_closed() || client->generation() != generation) return;
+    // 当前阶段不限时，到期的只是占位的定时器，重新挂上
+    if(client->timeout_ms(metrics_now_ns()) == HttpConn::kNoTimeout) {
+        EventLoop::current()->timer().add(client->get_fd(), HttpConn::kNoTimeout,
+                                          std::bind(&WebServer::on_timeout, this, client, generation));
+        return;
+    }
+    const HttpConn::Phase phase = client->phase();
+    if(phase == HttpConn::Phase::header || phase == HttpConn::Phase::body) {
+        LOG_INFO("Client[%d] timed out reading the request %s", client->get_fd(),
+                 phase == HttpConn::Phase::header ? "header" : "body");
+        client->send_timeout();
+    }
+    close_conn(client);
+}
+
 void WebServer::close_conn(HttpConn* client) {
     assert(client);
     int fd = client->get_fd();
+    WS_TRACE(close, fd);
     LOG_INFO("Client[%d] quit!", fd);
+    loop_conns().erase(client);
 
     auto loop_it = client_loops_.find(fd);
     EventLoop* loop = nullptr;
     if(loop_it != client_loops_.end()) {
         loop = loop_it->second;
         client_loops_.erase(loop_it);
+        loop->load().connections.fetch_sub(1, std::memory_order_relaxed);
+        loop->load().pending_bytes.fetch_sub(client->get_write_bytes(), std::memory_order_relaxed);
     }
     
     // 释放Channel
     auto it = client_channels_.find(fd);
     if (it != client_channels_.end()) {
         if(loop) {
-            loop->run_in_loop([channel = it->second]() {
+            // close_conn 常在该 Channel 自己的回调里被调用，注销后延迟到本轮事件处理完再释放
+            loop->run_in_loop([loop, channel = it->second]() {
                 channel->disable_all();
                 channel->remove();
-                delete channel;
+                loop->queue_in_loop([channel]() { delete channel; });
             });
         }
         
@@ -323,16 +760,259 @@ void WebServer::close_conn(HttpConn* client) {
     client->close();
 }
 
-void WebServer::send_error(int fd, const char* info) {
+void WebServer::add_pending(int64_t delta) {
+    EventLoop* loop = EventLoop::current();
+    if (loop && delta != 0) loop->load().pending_bytes.fetch_add(delta, std::memory_order_relaxed);
+}
+
+void WebServer::send_error(int fd, std::string_view info) {
     assert(fd > 0);
-    send(fd, info, strlen(info), 0);
+    // 新连接的发送缓冲区是空的，非阻塞发送一次即可，发不完也不等；TLS 端口上明文响应无意义，直接关闭
+    if(!TlsContext::instance()->enabled()) send(fd, info.data(), info.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
     close(fd);
 }
 
 int WebServer::set_fd_nonblock(int fd) {
-    return fcntl(fd, F_SETFL, fcntl(fd, F_GETFD, 0) | O_NONBLOCK);
+    return fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
 }
 
 void WebServer::handle_cur() {
     main_loop_->modify_channel(accept_channel_.get());
-}
\ No newline at end of file
+}
+void WebServer::init_signals() {
+    // 对端关闭后继续写会收到 SIGPIPE，默认处理会直接终止进程
+    signal(SIGPIPE, SIG_IGN);
+    // 热重启 fork 出的子进程不需要回收
+    struct sigaction sa = {};
+    sa.sa_handler = SIG_DFL;
+    sa.sa_flags = SA_NOCLDWAIT;
+    sigaction(SIGCHLD, &sa, nullptr);
+
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGUSR2);
+    sigaddset(&mask, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+    signal_fd_ = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if(signal_fd_ < 0) return;
+
+    signal_channel_.reset(new Channel(main_loop_.get(), signal_fd_));
+    signal_channel_->set_read_callback(std::bind(&WebServer::handle_signal, this));
+    main_loop_->run_in_loop([this]() {
+        signal_channel_->enable_reading();
+    });
+
+    char path[PATH_MAX];
+    ssize_t n = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if(n > 0) {
+        exe_path_.assign(path, n);
+        // 可执行文件被新版本替换后，链接目标会带上这个后缀
+        static constexpr std::string_view kDeleted = " (deleted)";
+        if(exe_path_.ends_with(kDeleted)) exe_path_.resize(exe_path_.size() - kDeleted.size());
+    }
+}
+
+void WebServer::init_handoff() {
+    if(is_close_) return;
+    if(handoff_conn_ >= 0) {
+        // 旧进程发出监听 fd 后随即关闭交接地址，这里稍等它释放
+        for(int i = 0; i < 50 && handoff_fd_ < 0; ++i) {
+            handoff_fd_ = handoff_listen(port_);
+            if(handoff_fd_ < 0) usleep(20000);
+        }
+        handoff_send_ready(handoff_conn_);
+        handoff_conn_ = -1;
+        LOG_INFO("Took over listening socket from the previous process");
+    } else {
+        handoff_fd_ = handoff_listen(port_);
+    }
+    if(handoff_fd_ < 0) {
+        LOG_WARN("Handoff address for port %d unavailable, hot restart disabled", port_);
+        return;
+    }
+    handoff_channel_.reset(new Channel(main_loop_.get(), handoff_fd_));
+    handoff_channel_->set_read_callback(std::bind(&WebServer::handle_handoff_accept, this));
+    main_loop_->run_in_loop([this]() {
+        handoff_channel_->enable_reading();
+    });
+}
+
+void WebServer::handle_signal() {
+    signalfd_siginfo info;
+    while(read(signal_fd_, &info, sizeof(info)) == sizeof(info)) {
+        switch(info.ssi_signo) {
+            case SIGTERM:
+            case SIGINT:
+                LOG_INFO("Received signal %d, draining", info.ssi_signo);
+                begin_drain();
+                break;
+            case SIGUSR2:
+                spawn_successor();
+                break;
+            case SIGHUP:
+                reload_config();
+                break;
+        }
+    }
+}
+
+void WebServer::spawn_successor() {
+    if(draining_ || handoff_conn_ >= 0 || exe_path_.empty()) {
+        LOG_WARN("Hot restart ignored: %s", draining_ ? "draining" : "handoff in progress");
+        return;
+    }
+    // 新进程用同样的命令行（配置文件和覆盖项），fork 与 exec 之间不分配内存
+    std::vector<char*> argv;
+    argv.push_back(exe_path_.data());
+    for(size_t i = 1; i < config_.args.size(); ++i) {
+        argv.push_back(config_.args[i].data());
+    }
+    argv.push_back(nullptr);
+    pid_t pid = fork();
+    if(pid == 0) {
+        sigset_t empty;
+        sigemptyset(&empty);
+        pthread_sigmask(SIG_SETMASK, &empty, nullptr);
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+    if(pid < 0) {
+        LOG_ERROR("Hot restart fork failed: %s", strerror(errno));
+        return;
+    }
+    successor_pid_ = pid;
+    LOG_INFO("Hot restart: started %s as pid %d", exe_path_.c_str(), pid);
+}
+
+void WebServer::handle_handoff_accept() {
+    int conn = accept4(handoff_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if(conn < 0) return;
+    // 拉起的子进程已经退出（没能连上来）时，接受手工启动的新进程
+    if(successor_pid_ > 0 && kill(successor_pid_, 0) < 0 && errno == ESRCH) {
+        successor_pid_ = 0;
+    }
+    if(!handoff_peer_allowed(conn, successor_pid_)) {
+        LOG_WARN("Handoff refused: peer is not %s", successor_pid_ ? "the spawned process" : "the same user");
+        close(conn);
+        return;
+    }
+    if(draining_ || handoff_conn_ >= 0 || listen_fd_ < 0 || !handoff_send_listen_fd(conn, listen_fd_)) {
+        close(conn);
+        return;
+    }
+    // 交接地址让给新进程，自己继续 accept，直到新进程回复就绪
+    stop_handoff();
+    handoff_conn_ = conn;
+    handoff_conn_channel_.reset(new Channel(main_loop_.get(), conn));
+    handoff_conn_channel_->set_read_callback(std::bind(&WebServer::handle_handoff_conn, this));
+    handoff_conn_channel_->enable_reading();
+    LOG_INFO("Listening socket sent to the new process, waiting for it to be ready");
+}
+
+void WebServer::handle_handoff_conn() {
+    char tag = 0;
+    ssize_t n = read(handoff_conn_, &tag, 1);
+    if(n < 0 && errno == EAGAIN) return;
+
+    handoff_conn_channel_->disable_all();
+    handoff_conn_channel_->remove();
+    close(handoff_conn_);
+    handoff_conn_ = -1;
+    if(n == 1 && tag == HANDOFF_READY) {
+        LOG_INFO("New process is ready, draining");
+        begin_drain();
+        return;
+    }
+    // 新进程没能启动，收回交接地址继续服务
+    successor_pid_ = 0;
+    LOG_WARN("New process exited before it was ready, keep serving");
+    init_handoff();
+}
+
+void WebServer::stop_handoff() {
+    if(handoff_fd_ < 0) return;
+    if(handoff_channel_) {
+        handoff_channel_->disable_all();
+        handoff_channel_->remove();
+    }
+    close(handoff_fd_);
+    handoff_fd_ = -1;
+}
+
+void WebServer::begin_drain() {
+    if(draining_) return;
+    draining_ = true;
+    HttpConn::is_draining = true;
+
+    // 停止 accept；热重启时监听 socket 仍由新进程持有
+    if(accept_channel_ && listen_fd_ >= 0) {
+        accept_channel_->disable_all();
+        accept_channel_->remove();
+        close(listen_fd_);
+        listen_fd_ = -1;
+    }
+    stop_handoff();
+    close_idle();
+
+    drain_deadline_ns_ = metrics_now_ns() + DRAIN_TIMEOUT_MS * 1000000ull;
+    drain_timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    itimerspec period = { { 0, 100000000 }, { 0, 100000000 } };
+    timerfd_settime(drain_timer_fd_, 0, &period, nullptr);
+    drain_channel_.reset(new Channel(main_loop_.get(), drain_timer_fd_));
+    drain_channel_->set_read_callback(std::bind(&WebServer::check_drain, this));
+    drain_channel_->enable_reading();
+    LOG_INFO("Draining %d connections, deadline %d ms", HttpConn::user_count(), DRAIN_TIMEOUT_MS);
+}
+
+void WebServer::close_idle() {
+    // 空闲的 keep-alive 连接直接关闭；正在处理的请求写完后因 is_draining 而关闭
+    for(EventLoop* loop : thread_pool_->loops()) {
+        loop->queue_in_loop([this]() { close_loop_conns(true); });
+    }
+}
+
+void WebServer::close_loop_conns(bool idle_only) {
+    // close_conn 会从集合中删除，先取一份
+    const std::vector<HttpConn*> conns(loop_conns().begin(), loop_conns().end());
+    for(HttpConn* client : conns) {
+        if(!client->is_closed() && (!idle_only || client->is_idle())) close_conn(client);
+    }
+}
+
+std::unordered_set<HttpConn*>& WebServer::loop_conns() {
+    thread_local std::unordered_set<HttpConn*> conns;
+    return conns;
+}
+
+void WebServer::check_drain() {
+    uint64_t expirations;
+    ssize_t ret = read(drain_timer_fd_, &expirations, sizeof(expirations));
+    (void)ret;
+    const int remaining = HttpConn::user_count();
+    if(remaining > 0 && metrics_now_ns() < drain_deadline_ns_) {
+        return;
+    }
+    drain_channel_->disable_all();
+    drain_channel_->remove();
+    if(remaining == 0) {
+        LOG_INFO("Drain finished, exiting");
+        main_loop_->quit();
+        return;
+    }
+    // 各 IO 线程关闭自己的连接，都做完后才退出主循环
+    LOG_WARN("Drain deadline reached, closing %d connections", remaining);
+    const std::vector<EventLoop*>& loops = thread_pool_->loops();
+    forced_closes_ = loops.size();
+    for(EventLoop* loop : loops) {
+        loop->queue_in_loop([this]() {
+            close_loop_conns(false);
+            main_loop_->queue_in_loop([this]() {
+                if(--forced_closes_ > 0) return;
+                LOG_INFO("Drain finished, exiting");
+                main_loop_->quit();
+            });
+        });
+    }
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <unordered_map>
+#include <unordered_set>
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/socket.h>
@@ -9,51 +10,96 @@
 #include <memory>
 
 #include "../event/eventloopthreadpool.h"      // 新增
+#include "../event/affinity.h"
 #include "../log/log.h"
-#include "../timer/heaptimer.h"
 #include "../pool/sqlconnpool.h"
 #include "../http/httpconn.h"
+#include "../http/router.h"
+#include "../config/config.h"
+#include "../metrics/watchdog.h"
 
 class WebServer {
 public:
-    WebServer(
-        int port, int trig_mode, int timeout_ms, bool opt_linger, 
-        int sql_port, const char* sql_user, const char* sql_pwd, 
-        const char* db_name, int conn_pool_num, int thread_num,
-        bool open_log, int log_level, int log_que_size);
+    explicit WebServer(const ServerConfig& config);
 
     ~WebServer();
     void start();
 
+    // 向订阅了 topic 的所有 WebSocket 连接推送一条消息：只组帧一次，各 IO 循环追加同一个共享块
+    // 可在任意线程调用
+    void broadcast(const std::string& topic, WebSocket::Opcode opcode, std::string_view payload);
+
 private:
     bool init_socket(); 
+    bool init_config();
+    void init_routes();
     void init_event_mode(int trig_mode);
-    void add_client(int fd, sockaddr_in addr);
+    void add_client(int fd, sockaddr_in addr, bool conn_counted);
     
     void handle_listen();
     void handle_write(HttpConn* client);
     void handle_read(HttpConn* client);
     
-    void send_error(int fd, const char* info);
+    void send_error(int fd, std::string_view info);
+    // 按连接当前的阶段重设它在所属 IO 循环定时器中的到期时刻
     void extend_time(HttpConn* client);
+    void on_timeout(HttpConn* client, uint64_t generation);
     void close_conn(HttpConn* client);
     
     void on_connection(int fd);
     void on_read(HttpConn* client);
     void on_write(HttpConn* client);
     void on_process(HttpConn* client);
+    // 有数据要发送：LT 下注册可写事件，ET 下可写事件一直注册着，放进就绪队列在本轮发送
+    static void want_write(Channel* channel);
+    void serve_metrics(HttpConn* client, EventLoop* io_loop);
+
+    // WebSocket：广播收到的消息、在本循环内分发、按循环的定时器发心跳
+    void publish(HttpConn* client);
+    void fan_out(const std::string& topic, const ChainBuffer::SharedBlock& frame, size_t len);
+    void init_ws_ping();
+    void on_ws_ping(int timer_fd);
+    // 写缓冲合计超过 output_budget 时，按循环的定时器断开持续不读的客户端
+    void init_output_check();
+    void on_output_check(int timer_fd);
+    // 按 read_paused 暂停或恢复读取：LT 下增删 EPOLLIN，ET 下把积压的可读排进就绪队列
+    static void update_reading(HttpConn* client, Channel* channel);
+    // 调整当前 IO 循环发布的待发送字节数
+    static void add_pending(int64_t delta);
 
     void handle_cur();
 
+    // 优雅退出与热重启
+    void init_signals();
+    void init_handoff();
+    void handle_signal();
+    // SIGHUP：重新读取配置，只有可重新加载的设置生效
+    void reload_config();
+    static RateLimiter::Options rate_limits(const RuntimeConfig& runtime, size_t capacity);
+    void handle_handoff_accept();
+    void handle_handoff_conn();
+    void spawn_successor();
+    void begin_drain();
+    void close_idle();
+    void check_drain();
+    // 在 IO 线程中调用：关闭本线程上的连接，idle_only 时只关空闲的
+    void close_loop_conns(bool idle_only);
+    // 本 IO 线程上的连接，只在所属线程中增删和遍历；排空时各线程处理自己的，不碰其他线程也在修改的映射表
+    static std::unordered_set<HttpConn*>& loop_conns();
+    void stop_handoff();
+
     static const int MAX_FD = 65536;
+    static const int DRAIN_TIMEOUT_MS = 30000;           // 排空期限，超时后强制关闭剩余连接
+    static const int WS_PING_MS = 30000;                 // WebSocket 心跳间隔，两个间隔内没有收到任何帧则断开
+    static const size_t WS_MAX_BACKLOG = 4 << 20;        // 订阅者待发送字节超过该值视为过慢，断开
+    static const int OUTPUT_CHECK_MS = 1000;             // 两次检查之间一个字节都没发出去的积压连接可被断开
     static int set_fd_nonblock(int fd);
 
     int port_;
     bool open_linger_;
-    int timeout_ms_;
     bool is_close_;
+    bool incoming_cpu_;
     int listen_fd_;
-    char* src_dir_;
     
     uint32_t listen_event_;
     uint32_t conn_event_;
@@ -63,9 +109,29 @@ private:
     std::unique_ptr<EventLoopThreadPool> thread_pool_;   // 事件循环线程池
     std::unique_ptr<Channel> accept_channel_;            // 接受连接的通道
     
-    // HTTP连接相关
-    std::unique_ptr<HeapTimer> timer_;
+    std::unique_ptr<Watchdog> watchdog_;                 // 事件循环卡顿检测
+
+    // 信号、排空与热重启，均只在主循环中访问
+    std::string exe_path_;
+    int signal_fd_ = -1;
+    std::unique_ptr<Channel> signal_channel_;
+    int handoff_fd_ = -1;                                // 交接地址上的监听 socket
+    std::unique_ptr<Channel> handoff_channel_;
+    pid_t successor_pid_ = 0;                            // SIGUSR2 拉起的新进程，交接只认它
+    int handoff_conn_ = -1;                              // 与新进程的连接，等待其就绪
+    std::unique_ptr<Channel> handoff_conn_channel_;
+    bool draining_ = false;
+    uint64_t drain_deadline_ns_ = 0;
+    int drain_timer_fd_ = -1;
+    std::unique_ptr<Channel> drain_channel_;
+    size_t forced_closes_ = 0;                           // 排空期限到后强制关闭、还没做完的 IO 循环数
+    std::vector<int> ws_ping_fds_;                       // 每个 IO 循环一个心跳 timerfd
+    std::vector<std::unique_ptr<Channel>> ws_ping_channels_;
+    std::vector<int> output_check_fds_;                  // 每个 IO 循环一个写缓冲检查 timerfd
+    std::vector<std::unique_ptr<Channel>> output_check_channels_;
     std::unordered_map<int, HttpConn> users_;            // 连接映射表
     std::unordered_map<int, Channel*> client_channels_;  // 客户端通道
     std::unordered_map<int, EventLoop*> client_loops_;
+
+    ServerConfig config_;                                // 启动时的配置，SIGHUP 后更新其中的 runtime
 };
@@ -1,13 +1,13 @@
 #include "heaptimer.h"
+#include "../metrics/metrics.h"
 
 void HeapTimer::siftup_(size_t i) {
     assert(i >= 0 && i < heap_.size());
-    size_t j = (i - 1) / 2;
-    while(j >= 0) {
+    while(i > 0) {
+        size_t j = (i - 1) / 2;
         if(heap_[j] < heap_[i]) { break; }
         swap_node_(i, j);
         i = j;
-        j = (i - 1) / 2;
     }
 }
 
@@ -57,10 +57,10 @@ void HeapTimer::do_work(int id) {
     if(heap_.empty() || ref_.count(id) == 0) {
         return;
     }
-    size_t i = ref_[id];
-    TimerNode node = heap_[i];
+    // 先删除再回调，回调中可以重新添加同一个 id
+    TimerNode node = std::move(heap_[ref_[id]]);
+    del_(ref_[id]);
     node.cb();
-    del_(i);
 }
 
 void HeapTimer::del_(size_t index) {
@@ -78,10 +78,19 @@ void HeapTimer::del_(size_t index) {
     heap_.pop_back();
 }
 
-void HeapTimer::adjust(int id, int timeout) {
-    assert(!heap_.empty() && ref_.count(id) > 0);
-    heap_[ref_[id]].expires = Clock::now() + MS(timeout);;
-    siftdown_(ref_[id], heap_.size());
+bool HeapTimer::adjust(int id, int timeout) {
+    auto it = ref_.find(id);
+    if(it == ref_.end()) {
+        return false;
+    }
+    const size_t i = it->second;
+    const TimeStamp expires = Clock::now() + MS(timeout);
+    const bool earlier = expires < heap_[i].expires;
+    heap_[i].expires = expires;
+    if(!siftdown_(i, heap_.size())) {
+        siftup_(i);
+    }
+    return earlier && ref_[id] == 0;
 }
 
 void HeapTimer::tick() {
@@ -89,13 +98,13 @@ void HeapTimer::tick() {
         return;
     }
     while(!heap_.empty()) {
-        std::lock_guard<std::mutex> lck(mtx_);
-        TimerNode node = heap_.front();
-        if(std::chrono::duration_cast<MS>(node.expires - Clock::now()).count() > 0) { 
+        if(std::chrono::duration_cast<MS>(heap_.front().expires - Clock::now()).count() > 0) { 
             break; 
         }
-        node.cb();
+        TimerNode node = std::move(heap_.front());
         pop();
+        node.cb();
+        LoopMetrics::local().timer_expiries.add();
     }
 }
 
@@ -22,6 +22,7 @@ struct TimerNode {
         return expires < t.expires;
     }
 };
+// 每个 EventLoop 一个，只在所属线程中访问，不加锁
 class HeapTimer {
 public:
     HeapTimer() { heap_.reserve(64); }
@@ -29,7 +30,8 @@ public:
     HeapTimer(const HeapTimer&) = delete;
     HeapTimer& operator=(const HeapTimer&) = delete;
     
-    void adjust(int id, int new_timeout);
+    // 可以延长也可以缩短；id 不存在时忽略。返回 true 表示提前后成了最早到期的定时器
+    bool adjust(int id, int new_timeout);
     void add(int id, int timeout, const TimeoutCallBack& cb);
 
     void do_work(int id);
@@ -53,6 +55,4 @@ private:
     std::vector<TimerNode> heap_;
 
     std::unordered_map<int, size_t> ref_;
-
-    std::mutex mtx_;
 };
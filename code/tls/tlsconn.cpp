@@ -0,0 +1,237 @@
+#include "tlsconn.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <openssl/core_names.h>
+#include <openssl/err.h>
+#include <openssl/rand.h>
+
+#include "../metrics/metrics.h"
+
+namespace {
+
+// 客户端提供 h2 时优先选择；HTTP/2 连接前言的检测与明文相同
+int select_alpn(SSL*, const unsigned char** out, unsigned char* outlen,
+                const unsigned char* in, unsigned int inlen, void*) {
+    static const unsigned char kProtocols[] = "\x02h2\x08http/1.1";
+    unsigned char* selected = nullptr;
+    if(SSL_select_next_proto(&selected, outlen, kProtocols, sizeof(kProtocols) - 1, in, inlen)
+       != OPENSSL_NPN_NEGOTIATED) {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+    *out = selected;
+    return SSL_TLSEXT_ERR_OK;
+}
+
+}  // namespace
+
+TlsContext* TlsContext::instance() {
+    static TlsContext context;
+    return &context;
+}
+
+TlsContext::~TlsContext() {
+    SSL_CTX_free(ctx_);
+}
+
+bool TlsContext::init(const Options& options) {
+    if(options.cert_file.empty()) return false;
+
+    SSL_CTX* ctx = SSL_CTX_new(TLS_server_method());
+    if(!ctx) return false;
+    SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+    uint64_t opts = SSL_OP_NO_RENEGOTIATION | SSL_OP_CIPHER_SERVER_PREFERENCE | SSL_OP_IGNORE_UNEXPECTED_EOF;
+    if(options.ktls) opts |= SSL_OP_ENABLE_KTLS;
+    SSL_CTX_set_options(ctx, opts);
+    // 非阻塞写：允许部分写入，重试时缓冲区地址可以变化（写缓冲区是分段链表）
+    SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER |
+                          SSL_MODE_RELEASE_BUFFERS);
+
+    if(SSL_CTX_use_certificate_chain_file(ctx, options.cert_file.c_str()) != 1 ||
+       SSL_CTX_use_PrivateKey_file(ctx, options.key_file.c_str(), SSL_FILETYPE_PEM) != 1 ||
+       SSL_CTX_check_private_key(ctx) != 1) {
+        // 日志系统此时尚未初始化
+        fprintf(stderr, "TLS: failed to load %s / %s\n", options.cert_file.c_str(), options.key_file.c_str());
+        ERR_print_errors_fp(stderr);
+        SSL_CTX_free(ctx);
+        return false;
+    }
+
+    // 会话恢复只用票据：状态在客户端，不需要跨 IO 线程加锁的服务端缓存
+    static const unsigned char kSessionContext[] = "webserver";
+    SSL_CTX_set_session_id_context(ctx, kSessionContext, sizeof(kSessionContext) - 1);
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+    SSL_CTX_set_num_tickets(ctx, 1);
+    if(!options.ticket_key_file.empty()) {
+        if(!load_ticket_key_(options.ticket_key_file)) {
+            fprintf(stderr, "TLS: ticket key %s must be 80 bytes\n", options.ticket_key_file.c_str());
+            SSL_CTX_free(ctx);
+            return false;
+        }
+        SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, &TlsContext::ticket_key_cb_);
+    }
+
+    SSL_CTX_set_alpn_select_cb(ctx, select_alpn, nullptr);
+    ctx_ = ctx;
+    return true;
+}
+
+bool TlsContext::load_ticket_key_(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    const std::string key((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if(key.size() != 80) return false;
+    memcpy(ticket_name_, key.data(), 16);
+    memcpy(ticket_hmac_, key.data() + 16, 32);
+    memcpy(ticket_aes_, key.data() + 48, 32);
+    return true;
+}
+
+int TlsContext::ticket_key_cb_(SSL*, unsigned char* key_name, unsigned char* iv,
+                               EVP_CIPHER_CTX* cipher, EVP_MAC_CTX* mac, int enc) {
+    // 密钥来自文件，热重启后的新进程仍能解开旧进程签发的票据
+    TlsContext* self = instance();
+    if(enc) {
+        memcpy(key_name, self->ticket_name_, 16);
+        if(RAND_bytes(iv, EVP_MAX_IV_LENGTH) != 1 ||
+           EVP_EncryptInit_ex(cipher, EVP_aes_256_cbc(), nullptr, self->ticket_aes_, iv) != 1) {
+            return -1;
+        }
+    } else {
+        // 未知的密钥名：回退到完整握手
+        if(memcmp(key_name, self->ticket_name_, 16) != 0) return 0;
+        if(EVP_DecryptInit_ex(cipher, EVP_aes_256_cbc(), nullptr, self->ticket_aes_, iv) != 1) {
+            return -1;
+        }
+    }
+    char digest[] = "SHA256";
+    OSSL_PARAM params[] = {
+        OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, self->ticket_hmac_, sizeof(self->ticket_hmac_)),
+        OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest, 0),
+        OSSL_PARAM_construct_end(),
+    };
+    return EVP_MAC_CTX_set_params(mac, params) == 1 ? 1 : -1;
+}
+
+TlsConn::TlsConn(int fd) : ssl_(SSL_new(TlsContext::instance()->get())), fd_(fd) {
+    SSL_set_fd(ssl_, fd_);
+    SSL_set_accept_state(ssl_);
+}
+
+TlsConn::~TlsConn() {
+    SSL_free(ssl_);
+}
+
+void TlsConn::shutdown() {
+    // 出错后的连接不能再发 close_notify
+    if(established_) {
+        ERR_clear_error();
+        SSL_shutdown(ssl_);
+        established_ = false;
+    }
+}
+
+ssize_t TlsConn::fail_(int ret, int* saved_errno) {
+    const int err = SSL_get_error(ssl_, ret);
+    wants_write_ = err == SSL_ERROR_WANT_WRITE;
+    switch(err) {
+        case SSL_ERROR_WANT_READ:
+        case SSL_ERROR_WANT_WRITE:
+            *saved_errno = EAGAIN;
+            return -1;
+        case SSL_ERROR_ZERO_RETURN:
+            return 0;
+        case SSL_ERROR_SYSCALL:
+            *saved_errno = errno ? errno : ECONNRESET;
+            break;
+        default:
+            *saved_errno = EPROTO;
+            break;
+    }
+    established_ = false;
+    ERR_clear_error();
+    return -1;
+}
+
+ssize_t TlsConn::handshake_(int* saved_errno) {
+    ERR_clear_error();
+    const int ret = SSL_do_handshake(ssl_);
+    if(ret != 1) {
+        return fail_(ret, saved_errno);
+    }
+    established_ = true;
+    wants_write_ = false;
+    // 内核接管发送后，明文直接 writev 到 socket，由内核分段加密
+    ktls_send_ = BIO_get_ktls_send(SSL_get_wbio(ssl_));
+
+    LoopMetrics& metrics = LoopMetrics::local();
+    metrics.tls_handshakes.add();
+    if(SSL_session_reused(ssl_)) metrics.tls_resumed.add();
+    if(ktls_send_) metrics.ktls.add();
+    return 1;
+}
+
+ssize_t TlsConn::read(Buffer& buffer, int* saved_errno, size_t max_bytes) {
+    if(!established_) {
+        const ssize_t ret = handshake_(saved_errno);
+        if(ret <= 0) return ret;
+    }
+    // 读到 WANT_READ 或 max_bytes 为止；提前停下时 OpenSSL 中可能还缓存着记录，调用方据 has_pending 接着读
+    char buf[16384];
+    size_t total = 0;
+    while(total < max_bytes) {
+        size_t n = 0;
+        ERR_clear_error();
+        const int ret = SSL_read_ex(ssl_, buf, std::min(sizeof(buf), max_bytes - total), &n);
+        if(ret == 1) {
+            buffer.append(buf, n);
+            total += n;
+            continue;
+        }
+        const ssize_t res = fail_(ret, saved_errno);
+        if(total > 0 && res < 0 && *saved_errno == EAGAIN) return total;
+        return res;
+    }
+    return total;
+}
+
+ssize_t TlsConn::write(ChainBuffer& buffer, int* saved_errno, size_t max_bytes) {
+    if(ktls_send_) {
+        return buffer.write_fd(fd_, saved_errno, max_bytes);
+    }
+    iovec vec[ChainBuffer::kMaxIovecs];
+    const int count = buffer.as_iovecs(vec, ChainBuffer::kMaxIovecs);
+    // 小片段（响应头、HTTP/2 帧头）合并成一条记录，大块（文件内容）直接交给 SSL_write
+    char stage[16384];
+    ssize_t total = 0;
+    for(int i = 0; i < count && static_cast<size_t>(total) < max_bytes;) {
+        const char* data = stage;
+        size_t len = 0;
+        if(vec[i].iov_len >= sizeof(stage)) {
+            // 截短不小于一条记录，写阻塞后重试时长度不会比挂起的记录短
+            data = static_cast<const char*>(vec[i].iov_base);
+            len = std::min(vec[i].iov_len, std::max(max_bytes - total, sizeof(stage)));
+            ++i;
+        } else {
+            while(i < count && len + vec[i].iov_len <= sizeof(stage)) {
+                memcpy(stage + len, vec[i].iov_base, vec[i].iov_len);
+                len += vec[i].iov_len;
+                ++i;
+            }
+        }
+        size_t n = 0;
+        ERR_clear_error();
+        if(SSL_write_ex(ssl_, data, len, &n) != 1) {
+            const ssize_t res = fail_(0, saved_errno);
+            // 写阻塞由调用方注册可写事件重试，不走握手的读路径
+            wants_write_ = false;
+            return total > 0 ? total : res;
+        }
+        buffer.retrieve(n);
+        total += n;
+        if(n < len) break;
+    }
+    return total;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+#include <openssl/ssl.h>
+
+#include "../buffer/buffer.h"
+#include "../buffer/chainbuffer.h"
+
+// 全局 TLS 配置：证书、会话票据和 ALPN，所有 IO 线程共用一个 SSL_CTX
+// 未调用 init 或初始化失败时不启用，监听端口仍为明文
+class TlsContext {
+public:
+    struct Options {
+        std::string cert_file;          // PEM 证书链，为空表示不启用 TLS
+        std::string key_file;           // PEM 私钥
+        std::string ticket_key_file;    // 会话票据密钥（80 字节，同 nginx 格式），为空时进程内随机生成
+        bool ktls = true;               // 握手后尝试把加密交给内核
+    };
+
+    static TlsContext* instance();
+
+    // 在启动服务之前调用
+    bool init(const Options& options);
+
+    bool enabled() const { return ctx_ != nullptr; }
+    SSL_CTX* get() const { return ctx_; }
+
+private:
+    TlsContext() = default;
+    ~TlsContext();
+
+    bool load_ticket_key_(const std::string& path);
+    static int ticket_key_cb_(SSL* ssl, unsigned char* key_name, unsigned char* iv,
+                              EVP_CIPHER_CTX* cipher, EVP_MAC_CTX* mac, int enc);
+
+    SSL_CTX* ctx_ = nullptr;
+    unsigned char ticket_name_[16];
+    unsigned char ticket_hmac_[32];
+    unsigned char ticket_aes_[32];
+};
+
+// 单个连接的非阻塞 TLS 状态；握手由读事件推进
+// 握手后内核接管发送（kTLS）时，写缓冲区照常用 writev 直接写 socket，mmap 的文件块不经过用户态加密
+class TlsConn {
+public:
+    explicit TlsConn(int fd);
+    ~TlsConn();
+
+    TlsConn(const TlsConn&) = delete;
+    TlsConn& operator=(const TlsConn&) = delete;
+
+    bool is_established() const { return established_; }
+    // 握手卡在等待 socket 可写
+    bool wants_write() const { return wants_write_; }
+    // OpenSSL 中还有已收到、没读出的数据（解密好的或尚未处理的记录），socket 不会再为它通知
+    bool has_pending() const { return SSL_has_pending(ssl_); }
+
+    // 返回值同 read_fd/write_fd：>0 为字节数，0 为对端关闭，-1 时 errno 为 EAGAIN 表示需要等待
+    // read 读到 max_bytes 即停，OpenSSL 中剩下的数据由 has_pending 报告
+    ssize_t read(Buffer& buffer, int* saved_errno, size_t max_bytes = SIZE_MAX);
+    ssize_t write(ChainBuffer& buffer, int* saved_errno, size_t max_bytes = SIZE_MAX);
+
+    // 发送 close_notify，不等待对端回应
+    void shutdown();
+
+private:
+    ssize_t handshake_(int* saved_errno);
+    ssize_t fail_(int ret, int* saved_errno);
+
+    SSL* ssl_;
+    const int fd_;
+    bool established_ = false;
+    bool wants_write_ = false;
+    bool ktls_send_ = false;
+};
@@ -0,0 +1,170 @@
+/*
+ * HPACK 解码器测试：RFC 7541 附录 C 的示例，以及头部列表放大攻击
+ */
+#include "../code/http/hpack.h"
+#include <cassert>
+#include <cstdio>
+#include <string>
+
+using Result = HpackDecoder::Result;
+
+static std::string from_hex(const char* hex) {
+    std::string out;
+    int hi = -1;
+    for(const char* p = hex; *p; ++p) {
+        int v;
+        if(*p >= '0' && *p <= '9') v = *p - '0';
+        else if(*p >= 'a' && *p <= 'f') v = *p - 'a' + 10;
+        else continue;
+        if(hi < 0) {
+            hi = v;
+        } else {
+            out.push_back(static_cast<char>(hi << 4 | v));
+            hi = -1;
+        }
+    }
+    assert(hi < 0);
+    return out;
+}
+
+static void expect(HpackDecoder& decoder, const char* hex, const HeaderList& want) {
+    HeaderList got;
+    assert(decoder.decode(from_hex(hex), got) == Result::ok);
+    assert(got == want);
+}
+
+// C.2：单个字面量字段，各自使用新的解码器
+void TestLiteral() {
+    {
+        HpackDecoder decoder;
+        expect(decoder, "400a 6375 7374 6f6d 2d6b 6579 0d63 7573 746f 6d2d 6865 6164 6572",
+               {{"custom-key", "custom-header"}});
+        // 已加入动态表，索引 62 可以取回
+        expect(decoder, "be", {{"custom-key", "custom-header"}});
+    }
+    {
+        HpackDecoder decoder;
+        expect(decoder, "040c 2f73 616d 706c 652f 7061 7468", {{":path", "/sample/path"}});
+        // 不索引的字面量不进动态表
+        HeaderList got;
+        assert(decoder.decode(from_hex("be"), got) == Result::error);
+    }
+    {
+        HpackDecoder decoder;
+        expect(decoder, "1008 7061 7373 776f 7264 0673 6563 7265 74", {{"password", "secret"}});
+        HeaderList got;
+        assert(decoder.decode(from_hex("be"), got) == Result::error);
+    }
+    {
+        HpackDecoder decoder;
+        expect(decoder, "82", {{":method", "GET"}});
+    }
+}
+
+// C.3 / C.4：同一连接上的三个请求，分别不用和使用 Huffman 编码
+void TestRequests() {
+    const HeaderList first = {{":method", "GET"}, {":scheme", "http"}, {":path", "/"},
+                              {":authority", "www.example.com"}};
+    const HeaderList second = {{":method", "GET"}, {":scheme", "http"}, {":path", "/"},
+                               {":authority", "www.example.com"}, {"cache-control", "no-cache"}};
+    const HeaderList third = {{":method", "GET"}, {":scheme", "https"}, {":path", "/index.html"},
+                              {":authority", "www.example.com"}, {"custom-key", "custom-value"}};
+    {
+        HpackDecoder decoder;
+        expect(decoder, "8286 8441 0f77 7777 2e65 7861 6d70 6c65 2e63 6f6d", first);
+        expect(decoder, "8286 84be 5808 6e6f 2d63 6163 6865", second);
+        expect(decoder, "8287 85bf 400a 6375 7374 6f6d 2d6b 6579 0c63 7573 746f 6d2d 7661 6c75 65", third);
+    }
+    {
+        HpackDecoder decoder;
+        expect(decoder, "8286 8441 8cf1 e3c2 e5f2 3a6b a0ab 90f4 ff", first);
+        expect(decoder, "8286 84be 5886 a8eb 1064 9cbf", second);
+        expect(decoder, "8287 85bf 4088 25a8 49e9 5ba9 7d7f 8925 a849 e95b b8e8 b4bf", third);
+    }
+}
+
+// C.5 / C.6：三个响应，动态表 256 字节，会发生淘汰
+// 附录中的表大小来自 SETTINGS，这里在第一个块前加一个表大小更新（3fe101 = 256）得到相同的状态
+void TestResponses() {
+    const HeaderList first = {{":status", "302"}, {"cache-control", "private"},
+                              {"date", "Mon, 21 Oct 2013 20:13:21 GMT"}, {"location", "https://www.example.com"}};
+    const HeaderList second = {{":status", "307"}, {"cache-control", "private"},
+                               {"date", "Mon, 21 Oct 2013 20:13:21 GMT"}, {"location", "https://www.example.com"}};
+    const HeaderList third = {{":status", "200"}, {"cache-control", "private"},
+                              {"date", "Mon, 21 Oct 2013 20:13:22 GMT"}, {"location", "https://www.example.com"},
+                              {"content-encoding", "gzip"},
+                              {"set-cookie", "foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; version=1"}};
+    {
+        HpackDecoder decoder;
+        expect(decoder,
+               "3fe101"
+               "4803 3330 3258 0770 7269 7661 7465 611d 4d6f 6e2c 2032 3120 4f63 7420 3230 3133"
+               "2032 303a 3133 3a32 3120 474d 546e 1768 7474 7073 3a2f 2f77 7777 2e65 7861 6d70"
+               "6c65 2e63 6f6d", first);
+        expect(decoder, "4803 3330 37c1 c0bf", second);
+        expect(decoder,
+               "88c1 611d 4d6f 6e2c 2032 3120 4f63 7420 3230 3133 2032 303a 3133 3a32 3220 474d"
+               "54c0 5a04 677a 6970 7738 666f 6f3d 4153 444a 4b48 514b 425a 584f 5157 454f 5049"
+               "5541 5851 5745 4f49 553b 206d 6178 2d61 6765 3d33 3630 303b 2076 6572 7369 6f6e"
+               "3d31", third);
+    }
+    {
+        HpackDecoder decoder;
+        expect(decoder,
+               "3fe101"
+               "4882 6402 5885 aec3 771a 4b61 96d0 7abe 9410 54d4 44a8 2005 9504 0b81 66e0 82a6"
+               "2d1b ff6e 919d 29ad 1718 63c7 8f0b 97c8 e9ae 82ae 43d3", first);
+        expect(decoder, "4883 640e ffc1 c0bf", second);
+        expect(decoder,
+               "88c1 6196 d07a be94 1054 d444 a820 0595 040b 8166 e084 a62d 1bff c05a 839b d9ab"
+               "77ad 94e7 821d d7f2 e6c7 b335 dfdf cd5b 3960 d5af 2708 7f36 72c1 ab27 0fb5 291f"
+               "9587 3160 65c0 03ed 4ee5 b106 3d50 07", third);
+    }
+}
+
+// 列表大小按 名字 + 值 + 32 计，恰好等于上限时接受
+void TestBudget() {
+    const std::string block = from_hex("400a 6375 7374 6f6d 2d6b 6579 0d63 7573 746f 6d2d 6865 6164 6572");
+    {
+        HpackDecoder decoder;
+        HeaderList got;
+        assert(decoder.decode(block, got, 55) == Result::ok);
+        assert(got.size() == 1);
+    }
+    {
+        HpackDecoder decoder;
+        HeaderList got;
+        assert(decoder.decode(block, got, 54) == Result::too_large);
+        assert(got.empty());
+    }
+}
+
+// 放大攻击：一个 4000 字节的表项加上若干个 0xbe，16KB 的块可以解出近 50MB 的列表
+void TestAmplification() {
+    const size_t kValueLen = 4000;
+    const size_t kMaxList = 64 * 1024;
+    std::string block;
+    block += '\x40';                        // 带增量索引的字面量，新名字
+    block += '\x01';
+    block += 'x';
+    block += '\x7f';                        // 值长度 4000 = 127 + 3873
+    block += static_cast<char>(0x80 | (3873 & 0x7f));
+    block += static_cast<char>(3873 >> 7);
+    block.append(kValueLen, 'a');
+    block.append(16384 - block.size(), '\xbe');
+
+    HpackDecoder decoder;
+    HeaderList got;
+    assert(decoder.decode(block, got, kMaxList) == Result::too_large);
+    // 超过上限的字段在复制之前就被拒绝
+    assert(got.size() <= kMaxList / (1 + kValueLen + HpackTable::kEntryOverhead));
+}
+
+int main() {
+    TestLiteral();
+    TestRequests();
+    TestResponses();
+    TestBudget();
+    TestAmplification();
+    printf("hpack: all tests passed\n");
+}